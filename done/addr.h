@@ -36,10 +36,27 @@
 #define BYTE_SEL_MASK 3 // = 0b11
 #define BYTE_SEL_BITS 2
 
+/* the page-size bit of a page directory entry: a PUD or PMD entry with it set
+* maps a large page (1 GiB or 2 MiB, aligned on its size) instead of pointing
+* to a page directory
+*/
+#define PTE_LARGE_PAGE  0x80
+
 typedef uint32_t word_t;
 typedef uint8_t byte_t;
 typedef uint32_t pte_t;
 
+/* the sizes of the pages mapped by a PTE entry, a PMD entry and a PUD entry
+* (each is PD_ENTRIES times the one before)
+*/
+typedef enum {
+	PAGE_4K,
+	PAGE_2M,
+	PAGE_1G
+} page_size_t;
+
+#define PAGE_SIZE_BITS(size) (PAGE_OFFSET + PTE_ENTRY * (size)) // = log_2 of the size in bytes
+
 typedef struct {
 	uint16_t reserved	: VIRT_ADDR_RES;
 	uint16_t pgd_entry	: PGD_ENTRY;
@@ -49,6 +66,11 @@ typedef struct {
 	uint16_t page_offset: PAGE_OFFSET;
 } virt_addr_t;
 
+/* a virtual address packed as its 64-bit pattern: its fields are extracted with
+* shifts (see addr_mng.h), instead of being reassembled from a virt_addr_t
+*/
+typedef uint64_t virt_addr64_t;
+
 typedef struct {
 	uint32_t phy_page_num 	: PHY_PAGE_NUM;
 	uint16_t page_offset	: PAGE_OFFSET;
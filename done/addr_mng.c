@@ -78,7 +78,7 @@ int init_phy_addr(phy_addr_t* paddr, uint32_t page_begin, uint32_t page_offset){
 
 uint64_t virt_addr_t_to_uint64_t(const virt_addr_t * vaddr){
 	M_REQUIRE_NON_NULL(vaddr);
-	return (virt_addr_t_to_virtual_page_number(vaddr) << PAGE_OFFSET) | vaddr->page_offset;
+	return virt_addr64_pack(vaddr);
 }
 
 uint32_t phy_addr_t_to_uint32_t(const phy_addr_t* paddr){
@@ -88,16 +88,7 @@ uint32_t phy_addr_t_to_uint32_t(const phy_addr_t* paddr){
 
 uint64_t virt_addr_t_to_virtual_page_number(const virt_addr_t * vaddr){
 	M_REQUIRE_NON_NULL(vaddr);
-
-	uint64_t vp_number = 0;
-
-	//Packs x_entries fields into vp_number
-	vp_number = vp_number | vaddr->pgd_entry;
-	vp_number = (vp_number << PUD_ENTRY) | vaddr->pud_entry;
-	vp_number = (vp_number << PMD_ENTRY) | vaddr->pmd_entry;
-	vp_number = (vp_number << PTE_ENTRY) | vaddr->pte_entry;
-
-	return vp_number;
+	return virt_addr64_virtual_page_number(virt_addr64_pack(vaddr));
 }
 
 int print_virtual_address(FILE* where, const virt_addr_t* vaddr){
@@ -15,6 +15,46 @@
 #define MAX_9BIT_VALUE 0x1FF
 #define MAX_12BIT_VALUE 0xFFF
 
+/**
+ * @brief Fields of a packed virtual address (reserved bits are ignored, as by
+ * init_virt_addr64()). Inline, so that hot paths pay a shift and a mask per field.
+ */
+static inline uint16_t virt_addr64_pgd_entry(virt_addr64_t vaddr){
+	return (uint16_t) ((vaddr >> (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY)) & MAX_9BIT_VALUE);
+}
+
+static inline uint16_t virt_addr64_pud_entry(virt_addr64_t vaddr){
+	return (uint16_t) ((vaddr >> (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY)) & MAX_9BIT_VALUE);
+}
+
+static inline uint16_t virt_addr64_pmd_entry(virt_addr64_t vaddr){
+	return (uint16_t) ((vaddr >> (PAGE_OFFSET + PTE_ENTRY)) & MAX_9BIT_VALUE);
+}
+
+static inline uint16_t virt_addr64_pte_entry(virt_addr64_t vaddr){
+	return (uint16_t) ((vaddr >> PAGE_OFFSET) & MAX_9BIT_VALUE);
+}
+
+static inline uint16_t virt_addr64_page_offset(virt_addr64_t vaddr){
+	return (uint16_t) (vaddr & MAX_12BIT_VALUE);
+}
+
+static inline uint64_t virt_addr64_virtual_page_number(virt_addr64_t vaddr){
+	return (vaddr >> PAGE_OFFSET) & ((UINT64_C(1) << VIRT_PAGE_NUM) - 1);
+}
+
+/**
+ * @brief Pack a virt_addr_t structure (same value as virt_addr_t_to_uint64_t(), without
+ * the NULL check): to be done once, before the packed forms of the hot paths.
+ */
+static inline virt_addr64_t virt_addr64_pack(const virt_addr_t * vaddr){
+	return (virt_addr64_t) vaddr->pgd_entry << (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY)
+	       | (virt_addr64_t) vaddr->pud_entry << (PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY)
+	       | (virt_addr64_t) vaddr->pmd_entry << (PAGE_OFFSET + PTE_ENTRY)
+	       | (virt_addr64_t) vaddr->pte_entry << PAGE_OFFSET
+	       | vaddr->page_offset;
+}
+
 /**
  * @brief Initialize virt_addr_t structure. Reserved bits are zeroed.
  * @param vaddr (modified) the virtual address structure to be initialized
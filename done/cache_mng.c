@@ -12,6 +12,7 @@
 #include "addr_mng.h"
 #include "lru.h"
 #include "cache.h"
+#include "memory.h" // for mem_written()
 
 
 #include <inttypes.h> // for PRIx macros
@@ -176,6 +177,58 @@ int cache_hit (const void * mem_space,
 
 //=========================================================================
 
+#define PROBE(cache_entry_type, CACHE_LINE, CACHE_LINES, CACHE_WAYS, CACHE_TAG_REMAINING_BITS)\
+    do{\
+        uint32_t paddr_32b = phy_addr_t_to_uint32_t(paddr);\
+        uint16_t line_index = index_from_paddr_32b(paddr_32b, CACHE_LINE, CACHE_LINES);\
+        uint32_t tag = tag_from_paddr_32b(paddr_32b, CACHE_TAG_REMAINING_BITS);\
+        \
+        foreach_way(way, CACHE_WAYS){\
+            const cache_entry_type* entry = cache_entry(const cache_entry_type, CACHE_WAYS, line_index, way);\
+            /*Same search as cache_hit: valid entries are packed at the beginning of the line*/\
+            if(entry->v == INVALID){\
+                break;\
+            }else if(entry->tag == tag){\
+                *hit_way = way;\
+                *hit_index = line_index;\
+                return ERR_NONE;\
+            }\
+        }\
+    } while(0)
+
+int cache_probe(const void * cache,
+                const phy_addr_t * paddr,
+                uint8_t *hit_way,
+                uint16_t *hit_index,
+                cache_t cache_type){
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(paddr);
+    M_REQUIRE_NON_NULL(hit_way);
+    M_REQUIRE_NON_NULL(hit_index);
+
+    *hit_way = HIT_WAY_MISS;
+    *hit_index = HIT_INDEX_MISS;
+
+    switch(cache_type){
+        case L1_ICACHE:
+            PROBE(l1_icache_entry_t, L1_ICACHE_LINE, L1_ICACHE_LINES, L1_ICACHE_WAYS, L1_ICACHE_TAG_REMAINING_BITS);
+            break;
+        case L1_DCACHE:
+            PROBE(l1_dcache_entry_t, L1_DCACHE_LINE, L1_DCACHE_LINES, L1_DCACHE_WAYS, L1_DCACHE_TAG_REMAINING_BITS);
+            break;
+        case L2_CACHE:
+            PROBE(l2_cache_entry_t, L2_CACHE_LINE, L2_CACHE_LINES, L2_CACHE_WAYS, L2_CACHE_TAG_REMAINING_BITS);
+            break;
+        default:
+            M_EXIT_ERR(ERR_BAD_PARAMETER, "%s", "Unrecognized cache type");
+    }
+    return ERR_NONE;
+}
+
+#undef PROBE
+
+//=========================================================================
+
 #define INSERT(cache_entry_type, CACHE_LINES, CACHE_WAYS) \
     do{ \
         M_REQUIRE(cache_line_index < CACHE_LINES, ERR_BAD_PARAMETER, "%s", "line doesn't exist in this cache"); \
@@ -413,6 +466,80 @@ static int update_eviction_policy(void * const cache, cache_t cache_type,
   return ERR_NONE;
 }
 
+//=========================================================================
+
+int cache_insert_victim(void * l2_cache,
+                        uint32_t line_addr,
+                        const word_t * line,
+                        cache_replace_t replace){
+    M_REQUIRE_NON_NULL(l2_cache);
+    M_REQUIRE_NON_NULL(line);
+
+    l2_cache_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.v = VALID;
+    entry.age = 0;
+    entry.tag = tag_from_paddr_32b(line_addr, L2_CACHE_TAG_REMAINING_BITS);
+    memcpy(entry.line, line, L2_CACHE_LINE);
+
+    /* L2 space? Otherwise, the oldest line is overwritten (write-through: nothing to save) */
+    const uint16_t line_index = index_from_paddr_32b(line_addr, L2_CACHE_LINE, L2_CACHE_LINES);
+    int empty = 0;
+    const int way = find_oldest_way(l2_cache, L2_CACHE, line_index, &empty);
+
+    M_EXIT_IF_ERR(cache_insert(line_index, (uint8_t) way, &entry, l2_cache, L2_CACHE), "Error inserting in l2 cache");
+    return update_eviction_policy(l2_cache, L2_CACHE, line_index, way, replace);
+}
+
+//=========================================================================
+
+int cache_victim(const void * cache,
+                 const phy_addr_t * paddr,
+                 cache_t cache_type,
+                 uint32_t * victim_addr,
+                 int * evicts){
+    M_REQUIRE_NON_NULL(cache);
+    M_REQUIRE_NON_NULL(paddr);
+    M_REQUIRE_NON_NULL(victim_addr);
+    M_REQUIRE_NON_NULL(evicts);
+
+    uint16_t line_index;
+    switch(cache_type){
+        case L1_ICACHE:
+            line_index = index_from_paddr_32b(phy_addr_t_to_uint32_t(paddr), L1_ICACHE_LINE, L1_ICACHE_LINES);
+            break;
+        case L1_DCACHE:
+            line_index = index_from_paddr_32b(phy_addr_t_to_uint32_t(paddr), L1_DCACHE_LINE, L1_DCACHE_LINES);
+            break;
+        case L2_CACHE:
+            line_index = index_from_paddr_32b(phy_addr_t_to_uint32_t(paddr), L2_CACHE_LINE, L2_CACHE_LINES);
+            break;
+        default:
+            M_EXIT_ERR(ERR_BAD_PARAMETER, "%s", "Unrecognized cache type");
+    }
+
+    int empty = 0;
+    const int way = find_oldest_way(cache, cache_type, line_index, &empty);
+    *evicts = !empty;
+    *victim_addr = 0;
+    if(!empty){
+        const void* entry = NULL;
+        switch(cache_type){
+            case L1_ICACHE:
+                entry = cache_entry(const l1_icache_entry_t, L1_ICACHE_WAYS, line_index, way);
+                break;
+            case L1_DCACHE:
+                entry = cache_entry(const l1_dcache_entry_t, L1_DCACHE_WAYS, line_index, way);
+                break;
+            default:
+                entry = cache_entry(const l2_cache_entry_t, L2_CACHE_WAYS, line_index, way);
+                break;
+        }
+        *victim_addr = recover_addr((void*) entry, cache_type, line_index);
+    }
+    return ERR_NONE;
+}
+
 // FIXME: mallocs require free... but it messes things up here
 
 #define L1_INSERT(L1_TYPE, L1_CACHE) \
@@ -427,41 +554,15 @@ static int update_eviction_policy(void * const cache, cache_t cache_type,
       update_eviction_policy(l1_cache, L1_CACHE, line_index, way, replace); \
     } \
     else { \
-      /* evict (but save) with replacement policy */ \
+      /* evict with replacement policy: the evicted line goes to L2 */ \
       L1_TYPE* evicted = evict(l1_cache, L1_CACHE, line_index, way); \
       uint32_t evicted_addr = recover_addr(evicted, L1_CACHE, line_index); \
-      l2_cache_entry_t* l2_evicted_entry =  malloc(sizeof(l2_cache_entry_t)); \
-      M_EXIT_IF_NULL(l2_evicted_entry, sizeof(l2_cache_entry_t)); \
-      l2_evicted_entry->v = VALID; \
-      l2_evicted_entry->age = 0; \
-      l2_evicted_entry->tag = tag_from_paddr_32b(evicted_addr, L2_CACHE_TAG_REMAINING_BITS); \
-      memcpy(l2_evicted_entry->line, evicted->line, L2_CACHE_LINE); \
-      /* free(evicted); ... */ \
+      M_EXIT_IF_ERR(cache_insert_victim(l2_cache, evicted_addr, evicted->line, replace), "Error inserting L1 victim in L2"); \
       \
       /* insert at this index */ \
       cache_insert(line_index, way, l1_entry, l1_cache, L1_CACHE); \
       /* update age */ \
       update_eviction_policy(l1_cache, L1_CACHE, line_index, way, replace); \
-      \
-      /* ========================================== update L2 after eviction*/ \
-      /* L2 space? */ \
-      line_index = index_from_paddr_32b(evicted_addr, L2_CACHE_LINE, L2_CACHE_LINES); \
-      empty = 0; \
-      way = find_oldest_way(l2_cache, L2_CACHE, line_index, &empty);\
-      \
-      if(empty){ \
-        cache_insert(line_index, way, l2_evicted_entry, l2_cache, L2_CACHE); \
-        update_eviction_policy(l2_cache, L2_CACHE, line_index, way, replace); \
-      } \
-      else { \
-        /* evict with replacement policy */ \
-        void* tmp = evict(l2_cache, L2_CACHE, line_index, way); \
-        /* free(tmp); .... */\
-        /* insert at free space */ \
-        cache_insert(line_index, way, l2_evicted_entry, l2_cache, L2_CACHE); \
-        /* update L2 age */ \
-        update_eviction_policy(l2_cache, L2_CACHE, line_index, way, replace); \
-      } \
     } \
   } while(0)
 
@@ -629,7 +730,10 @@ int cache_read_byte(const void * mem_space,
 //=========================================================================
 
 #define WRITE_LINE_IN_MEM(CACHE_LINE) \
-    memcpy(&(((word_t*)mem_space)[line_addr>>BYTE_SEL_BITS]), p_line, CACHE_LINE)
+do{\
+    memcpy(&(((word_t*)mem_space)[line_addr>>BYTE_SEL_BITS]), p_line, CACHE_LINE);\
+    mem_written(mem_space, line_addr, CACHE_LINE);\
+} while(0)
 
 #define MODIFY_AND_REINSERT(l_cache, cache_entry_type, CACHE_WAYS, CACHE_LINE) \
 do{\
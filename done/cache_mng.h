@@ -64,6 +64,24 @@ int cache_hit (const void * mem_space,
                uint16_t *hit_index,
                cache_t cache_type);
 
+//=========================================================================
+/**
+ * @brief Check if a physical address is present in a cache, without any side effect
+ *        (contrary to cache_hit, the ages of the entries are left untouched).
+ *
+ * @param cache pointer to the beginning of the cache
+ * @param paddr pointer to physical address
+ * @param hit_way (modified) cache way where hit was detected, HIT_WAY_MISS on miss
+ * @param hit_index (modified) cache line index where hit was detected, HIT_INDEX_MISS on miss
+ * @param cache_type to distinguish between different caches
+ * @return error code
+ */
+int cache_probe(const void * cache,
+                const phy_addr_t * paddr,
+                uint8_t *hit_way,
+                uint16_t *hit_index,
+                cache_t cache_type);
+
 //=========================================================================
 /**
  * @brief Insert an entry to a cache.
@@ -81,6 +99,40 @@ int cache_insert(uint16_t cache_line_index,
                  void * cache,
                  cache_t cache_type);
 
+//=========================================================================
+/**
+ * @brief Insert a line evicted from a L1 cache into the L2 cache (the only way L2
+ *        gets populated, see cache_read), overwriting the oldest L2 line if needed.
+ *
+ * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param line_addr physical address of the (beginning of the) evicted line
+ * @param line the L2_CACHE_WORDS_PER_LINE words of the evicted line
+ * @param replace replacement policy
+ * @return error code
+ */
+int cache_insert_victim(void * l2_cache,
+                        uint32_t line_addr,
+                        const word_t * line,
+                        cache_replace_t replace);
+
+//=========================================================================
+/**
+ * @brief Tell which line would be evicted from a cache to make room for the line of
+ *        a physical address (which is supposed to miss), without any side effect.
+ *
+ * @param cache pointer to the beginning of the cache
+ * @param paddr pointer to the physical address to be inserted
+ * @param cache_type to distinguish between different caches
+ * @param victim_addr (modified) physical address of the line that would be evicted, if any
+ * @param evicts (modified) 0 if a free way would be used, 1 if a line would be evicted
+ * @return error code
+ */
+int cache_victim(const void * cache,
+                 const phy_addr_t * paddr,
+                 cache_t cache_type,
+                 uint32_t * victim_addr,
+                 int * evicts);
+
 //=========================================================================
 /**
  * @brief Initialize a cache entry (write to the cache entry for the first time)
@@ -0,0 +1,57 @@
+/**
+ * @file coalesce.c
+ * @brief Merging of consecutive reads of the same cache line, in front of the cache hierarchy
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "coalesce.h"
+#include "addr_mng.h" // virt_addr64_pack()
+#include "cache.h" // for L1_ICACHE_LINE, L1_DCACHE_LINE
+#include "error.h"
+
+int coalescer_init(coalescer_t* coalescer, command_stream_t* stream, int enabled){
+	M_REQUIRE_NON_NULL(coalescer);
+	M_REQUIRE_NON_NULL(stream);
+
+	coalescer->stream = stream;
+	coalescer->enabled = enabled;
+	coalescer->has_next = 0;
+	coalescer->nb_merged = 0;
+	return ERR_NONE;
+}
+
+int command_coalescable(const command_t* head, const command_t* command){
+	if(head->order != READ || command->order != READ || head->type != command->type) return 0;
+
+	const uint64_t line_size = head->type == INSTRUCTION ? L1_ICACHE_LINE : L1_DCACHE_LINE;
+	return virt_addr64_pack(&head->vaddr) / line_size
+	       == virt_addr64_pack(&command->vaddr) / line_size;
+}
+
+int coalescer_next(coalescer_t* coalescer, access_group_t* group){
+	M_REQUIRE_NON_NULL(coalescer);
+	M_REQUIRE_NON_NULL(group);
+
+	if(coalescer->has_next){
+		group->command = coalescer->next;
+		coalescer->has_next = 0;
+	}else{
+		const int err = command_stream_next(coalescer->stream, &group->command);
+		if(err != ERR_NONE) return err;
+	}
+	group->repeat = 0;
+
+	if(!coalescer->enabled) return ERR_NONE;
+
+	while(command_stream_next(coalescer->stream, &coalescer->next) == ERR_NONE){
+		if(!command_coalescable(&group->command, &coalescer->next)){
+			coalescer->has_next = 1;
+			break;
+		}
+		++group->repeat;
+	}
+	coalescer->nb_merged += group->repeat;
+	return ERR_NONE;
+}
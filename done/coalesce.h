@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * @file coalesce.h
+ * @brief Merging of consecutive reads of the same cache line, in front of the cache hierarchy
+ *
+ * A read of the same kind (instruction or data) and of the same cache line as the
+ * read just before it cannot change the TLB nor the cache state: its translation is
+ * in the L1 TLB, its line is in the L1 cache with age 0 (so that LRU_age_update()
+ * leaves every age as is), and the caches are write-through. Such reads are thus
+ * merged into the first one of the run as a repeat count; each repeat is a hit
+ * at every level. Writes are never merged.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+
+#include "commands.h" // for command_t
+#include "command_stream.h" // for command_stream_t
+
+typedef struct {
+	command_t command; // first access of the group
+	size_t repeat; // number of accesses to the same line merged after it
+} access_group_t;
+
+typedef struct {
+	command_stream_t* stream;
+	int enabled; // if not, every group is a single command
+	command_t next; // first command of the next group
+	int has_next;
+	size_t nb_merged; // number of commands merged so far
+} coalescer_t;
+
+/**
+ * @brief Initialize a coalescer reading from a command stream.
+ * @param coalescer (modified) the coalescer to be initialized
+ * @param stream the stream to read from; must outlive the coalescer
+ * @param enabled whether to merge commands (0: one group per command)
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int coalescer_init(coalescer_t* coalescer, command_stream_t* stream, int enabled);
+
+/**
+ * @brief Tell whether a command can be merged into a group started by another one.
+ * @param head the first command of the group
+ * @param command the command to be merged
+ * @return 1 if it can, 0 otherwise
+ */
+int command_coalescable(const command_t* head, const command_t* command);
+
+/**
+ * @brief Get the next group of commands.
+ * At the end, command_stream_status() of the stream tells whether all went well.
+ * @param coalescer (modified) the coalescer to read from
+ * @param group (modified) the group read
+ * @return ERR_NONE if ok, ERR_EOF at end of the program, appropriate error code otherwise.
+ */
+int coalescer_next(coalescer_t* coalescer, access_group_t* group);
@@ -0,0 +1,146 @@
+/**
+ * @file command_stream.c
+ * @brief Streaming access to a program file, without loading the whole program in memory
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h>
+#include <stdlib.h> // calloc(), free()
+#include <string.h> // memset(), memmove()
+
+#include "command_stream.h"
+#include "commands.h"
+#include "commands_bin.h"
+#include "commands_packed.h"
+#include "error.h"
+
+int command_stream_open(const char* filename, command_stream_t* stream){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(stream);
+
+	memset(stream, 0, sizeof(*stream));
+
+	if(is_bin_program_file(filename)){
+		stream->format = STREAM_BIN;
+		M_EXIT_IF_ERR(program_bin_map(filename, &stream->bin), "Error mapping binary program");
+	}else if(is_packed_program_file(filename)){
+		stream->format = STREAM_PACKED;
+		M_EXIT_IF_ERR(packed_program_map(filename, &stream->packed), "Error mapping packed program");
+		packed_cursor_init(&stream->cursor, &stream->packed);
+	}else{
+		stream->format = STREAM_TEXT;
+		stream->input = fopen(filename, "r");
+		M_REQUIRE_NON_NULL_CUSTOM_ERR(stream->input, ERR_IO);
+		stream->text = malloc(CMD_STREAM_TEXT_BLOCK);
+		if(stream->text == NULL){
+			command_stream_close(stream);
+			M_EXIT_ERR(ERR_MEM, "cannot allocate %d bytes for the text block", CMD_STREAM_TEXT_BLOCK);
+		}
+	}
+
+	stream->ring = calloc(CMD_STREAM_CAPACITY, sizeof(command_t));
+	if(stream->ring == NULL){
+		command_stream_close(stream);
+		M_EXIT_ERR(ERR_MEM, "cannot allocate %zu bytes for the ring buffer", CMD_STREAM_CAPACITY * sizeof(command_t));
+	}
+
+	stream->status = ERR_NONE;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Parse the next command from the text block, reading more of the file when
+ * the block may not hold a whole line anymore
+ * @param stream the stream to read from
+ * @param command (modified) the command read
+ * @return ERR_NONE if ok, ERR_EOF at end of file, appropriate error code otherwise
+ */
+static int read_text(command_stream_t* stream, command_t* command){
+	size_t remaining = stream->text_size - stream->text_pos;
+	if(remaining <= MAX_COMMAND_LENGTH && !feof(stream->input)){
+		memmove(stream->text, stream->text + stream->text_pos, remaining);
+		remaining += fread(stream->text + remaining, 1, CMD_STREAM_TEXT_BLOCK - remaining, stream->input);
+		M_REQUIRE(!ferror(stream->input), ERR_IO, "%s", "Error reading program input file");
+		stream->text_size = remaining;
+		stream->text_pos = 0;
+	}
+
+	const char* cursor = stream->text + stream->text_pos;
+	const error_code err = command_parse(&cursor, stream->text + stream->text_size, command);
+	stream->text_pos = (size_t) (cursor - stream->text);
+	return err;
+}
+
+/**
+ * @brief Read (and validate) the next command from the underlying file
+ * @param stream the stream to read from
+ * @param command (modified) the command read
+ * @return ERR_NONE if ok, ERR_EOF at end of file, appropriate error code otherwise
+ */
+static int read_one(command_stream_t* stream, command_t* command){
+	error_code err;
+	if(stream->format == STREAM_BIN){
+		if(stream->bin_next >= stream->bin.nb_lines) return ERR_EOF;
+		err = command_bin_decode(&stream->bin.listing[stream->bin_next++], command);
+	}else if(stream->format == STREAM_PACKED){
+		err = packed_cursor_next(&stream->cursor, command);
+	}else{
+		err = read_text(stream, command);
+	}
+	return err == ERR_NONE ? command_validate(command) : err;
+}
+
+/**
+ * @brief Fill the ring buffer with (at most) one chunk of commands read from the file
+ * @param stream the stream to refill
+ */
+static void refill(command_stream_t* stream){
+	size_t nb_read = 0;
+	while(stream->status == ERR_NONE && nb_read < CMD_STREAM_CHUNK
+		&& stream->count < CMD_STREAM_CAPACITY){
+		const size_t tail = (stream->head + stream->count) % CMD_STREAM_CAPACITY;
+		stream->status = read_one(stream, &stream->ring[tail]);
+		if(stream->status == ERR_NONE){
+			++stream->count;
+			++nb_read;
+		}
+	}
+}
+
+int command_stream_next(command_stream_t* stream, command_t* command){
+	M_REQUIRE_NON_NULL(stream);
+	M_REQUIRE_NON_NULL(stream->ring);
+	M_REQUIRE_NON_NULL(command);
+
+	if(stream->count == 0){
+		refill(stream);
+		if(stream->count == 0) return stream->status;
+	}
+
+	*command = stream->ring[stream->head];
+	stream->head = (stream->head + 1) % CMD_STREAM_CAPACITY;
+	--stream->count;
+	++stream->nb_read;
+
+	return ERR_NONE;
+}
+
+int command_stream_status(const command_stream_t* stream){
+	M_REQUIRE_NON_NULL(stream);
+	return stream->status == ERR_EOF ? ERR_NONE : stream->status;
+}
+
+int command_stream_close(command_stream_t* stream){
+	M_REQUIRE_NON_NULL(stream);
+
+	if(stream->input != NULL) fclose(stream->input);
+	free(stream->text);
+	if(stream->bin.map_start != NULL) program_bin_unmap(&stream->bin);
+	if(stream->packed.map_start != NULL) packed_program_free(&stream->packed);
+	free(stream->ring);
+	memset(stream, 0, sizeof(*stream));
+
+	return ERR_NONE;
+}
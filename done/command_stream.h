@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+ * @file command_stream.h
+ * @brief Streaming access to a program file, without loading the whole program in memory
+ *
+ * Commands are read from the file by bounded chunks into a fixed ring buffer,
+ * so that the memory used stays constant whatever the size of the program.
+ * The text, binary (see commands_bin.h) and packed (see commands_packed.h)
+ * formats are supported.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for FILE, size_t
+
+#include "commands.h" // for command_t
+#include "commands_bin.h" // for program_bin_t
+#include "commands_packed.h" // for packed_program_t, packed_cursor_t
+
+#define CMD_STREAM_CAPACITY 4096 // number of commands held by the ring buffer
+#define CMD_STREAM_CHUNK    1024 // number of commands read from the file at once
+#define CMD_STREAM_TEXT_BLOCK (64 * 1024) // size of the blocks read from a text file
+
+typedef enum {
+	STREAM_TEXT,
+	STREAM_BIN,
+	STREAM_PACKED
+} command_stream_format_t;
+
+typedef struct {
+	command_stream_format_t format;
+	FILE* input; // for STREAM_TEXT
+	char* text; // for STREAM_TEXT, CMD_STREAM_TEXT_BLOCK chars read from input
+	size_t text_size; // number of chars in text
+	size_t text_pos; // position of the next line in text
+	program_bin_t bin; // for STREAM_BIN
+	size_t bin_next; // index of the next binary record to read
+	packed_program_t packed; // for STREAM_PACKED
+	packed_cursor_t cursor; // position of the next packed command to decode
+	command_t* ring; // dynamically allocated, CMD_STREAM_CAPACITY commands
+	size_t head; // index of the next command to hand out
+	size_t count; // number of commands available in the ring
+	size_t nb_read; // number of commands handed out so far
+	int status; // ERR_NONE while the file has more to read, ERR_EOF or error code otherwise
+} command_stream_t;
+
+/**
+ * @brief A useful macro to loop over all commands of a stream.
+ * X is the name of the variable to be used for the command (of type `command_t`);
+ * and S is the stream to be read (of type `command_stream_t*`).
+ * At the end of the loop, command_stream_status(S) tells whether all went well.
+ *
+ * Example usage:
+ *    for_all_stream_lines(line, &stream) { do_something_with(&line); }
+ *
+ */
+#define for_all_stream_lines(X, S) \
+    for(command_t X; command_stream_next((S), &X) == ERR_NONE; )
+
+/**
+ * @brief Open a program file for streaming. The format (text, binary or packed) is detected.
+ * @param filename the name of the file to read from.
+ * @param stream (modified) the stream to be initialized.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_stream_open(const char* filename, command_stream_t* stream);
+
+/**
+ * @brief Get the next (validated) command of the stream.
+ * @param stream the stream to read from.
+ * @param command (modified) the command read.
+ * @return ERR_NONE if ok, ERR_EOF at end of the program, appropriate error code otherwise.
+ */
+int command_stream_next(command_stream_t* stream, command_t* command);
+
+/**
+ * @brief Tell whether the stream ended normally.
+ * @param stream the stream to check.
+ * @return ERR_NONE if the whole program was read, appropriate error code otherwise.
+ */
+int command_stream_status(const command_stream_t* stream);
+
+/**
+ * @brief Close a stream and free its content.
+ * @param stream (modified) the stream to close.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_stream_close(command_stream_t* stream);
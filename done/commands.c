@@ -6,11 +6,16 @@
  * @date 2019
  */
 
+#define _POSIX_C_SOURCE 200809L // for mmap()
+
 #include <stdio.h>
-#include <stdlib.h> 	// strtoul(), memory alloc.
+#include <stdlib.h> 	// memory alloc.
 #include <inttypes.h> // PRIX macro
-#include <string.h>		// strlen()
-#include <ctype.h> 		// isspace()
+#include <string.h>		// strlen(), memchr()
+#include <fcntl.h>		// open()
+#include <unistd.h>		// close()
+#include <sys/mman.h>	// mmap()
+#include <sys/stat.h>	// fstat()
 
 #include "commands.h"
 #include "addr_mng.h"
@@ -48,9 +53,7 @@ int program_free(program_t* program){
 	return ERR_NONE;
 }
 
-static int program_enlarge(program_t* program);
-int program_add_command(program_t* program, command_t const * command) {
-	M_REQUIRE_NON_NULL(program);
+int command_validate(command_t const * command) {
 	M_REQUIRE_NON_NULL(command);
 
 	M_REQUIRE(command->order == READ || command->order == WRITE, ERR_BAD_PARAMETER, "%s", "Command order should be either READ or WRITE");
@@ -80,6 +83,14 @@ int program_add_command(program_t* program, command_t const * command) {
 	// Address page offset should be inside a page
 	M_REQUIRE(command->vaddr.page_offset <= MAX_PAGE_OFFSET, ERR_ADDR, "%s", "Page offset should be smaller than the max possible value");
 
+	return ERR_NONE;
+}
+
+static int program_enlarge(program_t* program);
+int program_add_command(program_t* program, command_t const * command) {
+	M_REQUIRE_NON_NULL(program);
+	M_EXIT_IF_ERR(command_validate(command), "Invalid command");
+
 	while(program->nb_lines >= program->allocated){
 		M_EXIT_IF_ERR(program_enlarge(program), "Error trying to reallocate more memory");
 	}
@@ -125,194 +136,143 @@ int program_shrink(program_t* program) {
 	return ERR_NONE;
 }
 
-// program_print helper functions' prototypes
-static void print_order(	FILE* o, command_t const * c);
-static void print_type_size(FILE* o, command_t const * c);
-static void print_data(		FILE* o, command_t const * c);
-static void print_addr(		FILE* o, command_t const * c);
-
-int program_print(FILE* output, program_t const * program) {
-	M_REQUIRE_NON_NULL(output);
-	M_REQUIRE_NON_NULL(program);
-
-	command_t c;
-
-	for(int i = 0; i < program->nb_lines; i++) {
-		c = program->listing[i];
+// ======================================================================
+#define HEX_CHARS "0123456789ABCDEF"
+#define PRINT_BUFFER_SIZE (64 * 1024) // program_print() writes by blocks of (at most) that size
 
-		print_order(output, &c);
-		fflush(output);
-
-		print_type_size(output, &c);
-		fflush(output);
-
-		print_data(output, &c);
-		fflush(output);
-
-		print_addr(output, &c);
-		fflush(output);
-
-		fprintf(output, "\n");
-		fflush(output);
+/**
+ * @brief Writes a value in (uppercase) hex, like printf("%0*X", min_digits, value)
+ * @param out where to write the digits
+ * @param value the value to write
+ * @param min_digits the minimal number of digits (padded with '0')
+ * @return the position right after the last digit written
+ */
+static inline char* put_hex(char* out, uint64_t value, int min_digits){
+	int nb_digits = min_digits;
+	while(nb_digits < 16 && (value >> (4 * nb_digits)) != 0) ++nb_digits;
+	for(int i = nb_digits - 1; i >= 0; --i){
+		*out++ = HEX_CHARS[(value >> (4 * i)) & 0xF];
 	}
-
-	return ERR_NONE;
+	return out;
 }
 
-static void print_order(FILE*  o , command_t const * c) {
-	 if(c->order == READ) fprintf(o, "R ");
-	 else fprintf(o, "W ");
+static inline char* put_chars(char* out, const char* chars, size_t nb_chars){
+	memcpy(out, chars, nb_chars);
+	return out + nb_chars;
 }
 
-static void print_type_size(FILE* o , command_t const * c){
-	if(c->type == INSTRUCTION) fprintf(o, "I  "); // I and two white spaces
-	else {
-		if (c->data_size == sizeof(word_t)) fprintf(o, "DW ");
-		else fprintf(o, "DB ");
-	}
-}
+size_t command_format(char* line, command_t const * c){
+	char* out = line;
 
-static void print_data(FILE* o , command_t const * c) {
-	if(c->order == WRITE) {
-		if(c->data_size == sizeof(byte_t)) fprintf(o, "0x%02" PRIX32 "       ", c->write_data);
-		else fprintf(o, "0x%08" PRIX32 " ", c->write_data);
-	}
-	else fprintf(o, "           "); // 11 whites spaces
-}
+	out = put_chars(out, c->order == READ ? "R " : "W ", 2);
 
-static void print_addr(FILE* o , command_t const * c) {
-	fprintf(o, "@0x%016" PRIX64, virt_addr_t_to_uint64_t( &(c->vaddr)) );
-}
+	if(c->type == INSTRUCTION) out = put_chars(out, "I  ", 3); // I and two white spaces
+	else out = put_chars(out, c->data_size == sizeof(word_t) ? "DW " : "DB ", 3);
 
+	if(c->order == WRITE) {
+		out = put_chars(out, "0x", 2);
+		if(c->data_size == sizeof(byte_t)) out = put_chars(put_hex(out, c->write_data, 2), "       ", 7);
+		else out = put_chars(put_hex(out, c->write_data, 8), " ", 1);
+	}
+	else out = put_chars(out, "           ", 11); // 11 whites spaces
 
+	out = put_chars(out, "@0x", 3);
+	out = put_hex(out, virt_addr_t_to_uint64_t(&c->vaddr), 16);
+	*out++ = '\n';
 
-// helper function prototypes
-static int read_command_line(FILE* input, char* str, const size_t str_len);
-static int next_word(char* str, char* read, const size_t read_len, unsigned int* index);
-static int parse_order(command_t * c, char const * word);
-static int parse_type_and_size(command_t * c, char const * word);
-static int parse_data(command_t * c, char const * word);
-static int parse_address(command_t * c, char const * word);
-#define MAX_COMMAND_LENGTH 36
-#define MAX_COMMAND_WORD_LENGTH 19 // ADDRESS_CHARS
+	return (size_t) (out - line);
+}
 
-int program_read(const char* filename, program_t* program){
-	M_REQUIRE_NON_NULL(filename);
+int program_print(FILE* output, program_t const * program) {
+	M_REQUIRE_NON_NULL(output);
 	M_REQUIRE_NON_NULL(program);
 
-	FILE* input = fopen(filename, "r");
-	M_REQUIRE_NON_NULL_CUSTOM_ERR(input, ERR_IO);
-
-	char command_str[MAX_COMMAND_LENGTH+1];
-
-	program_init(program);
-
-	/* NOTE: the underlying helper-functions only parse the input.
-	 * It doesn't check in any way that the input makes sense
-	 * Only that it has a somewhat "legal" structure (to be parseable)
-	 * Validity checks are performed in program_add_command
-	 */
-
-	while((read_command_line(input, command_str, MAX_COMMAND_LENGTH+1) != 0)
-		&& !feof(input) && !ferror(input)){
-
-		//Make a command_t of the line read
-		command_t c;
-		(void)memset(&c, 0, sizeof(c));
-
-		unsigned int index = 0;
-		char word_read[MAX_COMMAND_WORD_LENGTH+1]; //+1 accounts for '\0' in last position
-
-		M_EXIT_IF_ERR(next_word(command_str, word_read, MAX_COMMAND_WORD_LENGTH+1, &index),
- 									"Error trying to parse instruction");
-		M_EXIT_IF_ERR(parse_order(&c, word_read), "Error trying to parse order");
-
-		M_EXIT_IF_ERR(next_word(command_str, word_read, MAX_COMMAND_WORD_LENGTH+1, &index),
- 									"Error trying to parse instruction");
-		M_EXIT_IF_ERR(parse_type_and_size(&c, word_read),
-									"Error trying to parse type and size");
-
-		if(c.order == WRITE){
-			M_EXIT_IF_ERR(next_word(command_str, word_read, MAX_COMMAND_WORD_LENGTH+1, &index),
-										"Error trying to parse instruction");
-			M_EXIT_IF_ERR(parse_data(&c, word_read), "Error trying to parse data");
+	// lines are rendered in a buffer, written out once (almost) full
+	char buffer[PRINT_BUFFER_SIZE];
+	size_t used = 0;
+	for_all_lines(line, program){
+		used += command_format(buffer + used, line);
+		if(used > PRINT_BUFFER_SIZE - MAX_PRINTED_COMMAND_LENGTH || line + 1 == end_pgm_){
+			M_REQUIRE(fwrite(buffer, 1, used, output) == used, ERR_IO, "%s", "Error writing program");
+			used = 0;
 		}
-
-		M_EXIT_IF_ERR(next_word(command_str, word_read, MAX_COMMAND_WORD_LENGTH+1, &index),
-									"Error trying to parse instruction");
-		M_EXIT_IF_ERR(parse_address(&c, word_read), "Error trying to parse address");
-
-		M_EXIT_IF_ERR(program_add_command(program, &c), "Error adding command to program");
 	}
-
-	fclose(input);
+	M_REQUIRE(fflush(output) == 0, ERR_IO, "%s", "Error writing program");
 
 	return ERR_NONE;
 }
 
-/**
- * @brief Reads one line from the given file input
- * @param input commands file
- * @param str (modified) the string read
- * @param str_len the length of the string (char array)
- * @return the length of the string (command) read
+// ======================================================================
+/* Text format of a program: one command per line, at most MAX_COMMAND_LENGTH
+ * characters (without the '\n'):
+ *     [spaces] ORDER spaces TYPE spaces [DATA spaces] ADDRESS [rest of line ignored]
+ * ORDER is R or W; TYPE is I, DB or DW; DATA (for W only) is "0x" followed by
+ * 1 to 8 hex digits; ADDRESS is "@0x" followed by exactly 16 hex digits.
+ *
+ * Parsing is done in one single pass over the line, without any copy:
+ * words are delimited with a lookup table and hex digits decoded with another one.
+ *
+ * Unlike the former fgets()-based reader, a last line without '\n' is a command
+ * (it used to be silently dropped), and a line longer than MAX_COMMAND_LENGTH is
+ * an error (it used to be split into several "lines").
  */
-static int read_command_line(FILE* input, char* str, size_t str_len){
-	fgets(str, str_len, input);
 
-	int len_read = strlen(str) - 1;
+#define MAX_COMMAND_WORD_LENGTH 19 // ADDRESS_CHARS
+#define ORDER_CHARS 1 	// I or W
+#define TYPE_CHARS 2 	// I or DB or DW
+#define DATA_CHARS 10 	// 0x + 8 hex
+#define ADDRESS_CHARS 19// @0x + 16 hex
+#define HEX_PREFIX_CHARS 2 // 0x
 
-	M_EXIT_IF(len_read < 1, ERR_IO, "%s", "Found line with only a '\n' in program input file");
+// value + 1 of each hex digit; 0 for any other character
+static const uint8_t HEX_DIGIT[256] = {
+	['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+	['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16
+};
 
-	if(len_read >= 0 && str[len_read] == '\n'){  //strip the '\n' off
-		str[len_read] = '\0';
-	}
+// word separators: isspace() in the "C" locale, '\n' excepted (it ends the line)
+static const uint8_t IS_SPACE[256] = {
+	[' '] = 1, ['\t'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1
+};
 
-	return len_read;
+/**
+ * @brief Finds the next word of a line. Drops (leading) spaces.
+ * @param cursor (modified) current position in the line, moved right after the word found
+ * @param eol end of the line
+ * @param word (modified) beginning of the word found
+ * @return the length of the word found (0 if the end of the line was reached)
+ */
+static inline size_t next_word(const char** cursor, const char* eol, const char** word){
+	const char* p = *cursor;
+	while(p < eol && IS_SPACE[(unsigned char) *p]) ++p;
+	*word = p;
+	while(p < eol && !IS_SPACE[(unsigned char) *p]) ++p;
+	*cursor = p;
+	return (size_t) (p - *word);
 }
 
 /**
- * @brief Strips one word from str, starting from index (incl.) Drops (leading) spaces.
- * @param str string to read one word from
- * @param read (modified) word read
- * @param index (modified) start index, modified to index of char directly following word read
- * @return ERR_NONE if ok, appropriate error code otherwise
+ * @brief Decodes a fixed number of hex digits (no prefix)
+ * @param digits the digits to decode
+ * @param nb_digits how many digits to decode (at most 16)
+ * @param value (modified) the decoded value
+ * @return 1 if all characters were hex digits, 0 otherwise
  */
-static int next_word(char* str, char* read, size_t read_len, unsigned int* index){
-	int str_len = strlen(str);
-
-	//"Drop" leading spaces, if any
-	while(*index < str_len && isspace(str[*index])){
-		(*index)++;
+static inline int decode_hex(const char* digits, size_t nb_digits, uint64_t* value){
+	uint64_t v = 0;
+	uint8_t invalid = 0;
+	for(size_t i = 0; i < nb_digits; ++i){
+		const uint8_t d = HEX_DIGIT[(unsigned char) digits[i]];
+		invalid |= (d == 0);
+		v = (v << 4) | (uint8_t) (d - 1);
 	}
-
-	// reads only in cases it needs to. Empty fields are not read -> error
-	M_EXIT_IF(*index == str_len, ERR_BAD_PARAMETER, "%s",
-						"Reached end of string, but expected more (presumably wrong command format)");
-
-	// read until next space
-	size_t read_nb = 0;
-	char nextChar;
-	do{
-		M_EXIT_IF(read_nb == read_len-1, ERR_BAD_PARAMETER, "%s",
- 							"Given 'read' char array is too small to hold next word of instruction");
-
-		nextChar = str[*index];
-		read[read_nb] = nextChar;
-		read_nb++;
-		(*index)++;
-	} while(*index < str_len && !isspace(str[*index]));
-	read[read_nb] = '\0';
-
-	return ERR_NONE;
+	*value = v;
+	return !invalid;
 }
 
-#define ORDER_CHARS 1 	// I or W
-#define TYPE_CHARS 2 	// I or DB or DW
-#define DATA_CHARS 10 	// 0x + 8 hex
-#define ADDRESS_CHARS 19// @0x + 16 hex
-static int parse_order(command_t * c, char const * word) {
-	size_t word_len = strlen(word);
+static int parse_order(command_t * c, const char* word, size_t word_len) {
 	M_EXIT_IF(word_len != ORDER_CHARS, ERR_BAD_PARAMETER, "%s",
  						"Bad instruction format : command order should only be 1 character");
 
@@ -329,8 +289,8 @@ static int parse_order(command_t * c, char const * word) {
 
 	return ERR_NONE;
 }
-static int parse_type_and_size(command_t * c, char const * word) {
-	size_t word_len = strlen(word);
+
+static int parse_type_and_size(command_t * c, const char* word, size_t word_len) {
 	M_EXIT_IF(word_len > TYPE_CHARS, ERR_BAD_PARAMETER, "%s",
  						"Bad instruction format : command type and size should only be at most 2 characters");
 
@@ -359,44 +319,194 @@ static int parse_type_and_size(command_t * c, char const * word) {
 	return ERR_NONE;
 }
 
-/* unsigned long strtoul(const char *restrict str, char **restrict endptr, int base)
- * converts a string to an unsigned long
- * man strtoul for more information
- */
-static int parse_data(command_t * c, char const * word) {
-	size_t word_len = strlen(word);
+static int parse_data(command_t * c, const char* word, size_t word_len) {
 	M_REQUIRE(word_len <= DATA_CHARS, ERR_BAD_PARAMETER, "%s",
 						"Bad instruction format : command data string should be at most 10 characters (\"0x\" + at most 8 HEX digits)");
-	M_REQUIRE(word[0] == '0' && word[1] == 'x', ERR_BAD_PARAMETER, "%s",
+	M_REQUIRE(word_len > HEX_PREFIX_CHARS && word[0] == '0' && word[1] == 'x', ERR_BAD_PARAMETER, "%s",
 						"Bad instruction format : data should start with prefix '0x'");
 
-	char* ptr;
-	word_t w = strtoul(word, &ptr , 0);
-	//After having read the data word, we should find a '\0'. Otherwise we stopped prematurely.
-	M_REQUIRE(*ptr == '\0', ERR_BAD_PARAMETER, "%s",
+	uint64_t w;
+	M_REQUIRE(decode_hex(word + HEX_PREFIX_CHARS, word_len - HEX_PREFIX_CHARS, &w), ERR_BAD_PARAMETER, "%s",
  						"Bad instruction format : data should only contain HEX digits");
 
-	c->write_data = w;
+	c->write_data = (word_t) w;
 
 	return ERR_NONE;
 }
 
-static int parse_address(command_t * c, char const * word) {
-	size_t word_len = strlen(word);
+static int parse_address(command_t * c, const char* word, size_t word_len) {
 	M_REQUIRE(word_len == ADDRESS_CHARS, ERR_BAD_PARAMETER, "%s",
 						"Bad instruction format : command address should take 19 chars (\"@0x\" + 16 HEX digits)");
 	M_REQUIRE(word[0] == '@' && word[1] == '0' && word[2]== 'x', ERR_BAD_PARAMETER, "%s",
  						"Bad instruction format : address should start with prefix '@0x'");
 
-	char* ptr;
-	//drops leading '@'
-	uint64_t a_int = strtoul(&word[1], &ptr, 16); // hex base
-	M_REQUIRE(*ptr == '\0', ERR_ADDR, "%s %c",
-						"Bad instruction format : address should end here but last char was ", *ptr);
+	uint64_t a_int;
+	M_REQUIRE(decode_hex(word + HEX_PREFIX_CHARS + 1, ADDRESS_CHARS - HEX_PREFIX_CHARS - 1, &a_int), ERR_ADDR, "%s",
+						"Bad instruction format : address should only contain HEX digits");
+
+	return init_virt_addr64(&c->vaddr, a_int);
+}
+
+#define NEXT_WORD() \
+	do { \
+		word_len = next_word(&cursor, eol, &word); \
+		M_EXIT_IF(word_len == 0, ERR_BAD_PARAMETER, "%s", \
+							"Reached end of line, but expected more (presumably wrong command format)"); \
+		M_EXIT_IF(word_len > MAX_COMMAND_WORD_LENGTH, ERR_BAD_PARAMETER, "%s", \
+							"Word too long to be part of an instruction"); \
+	} while(0)
+
+/**
+ * @brief Parses one line (without its '\n') into a command
+ * @param line beginning of the line
+ * @param eol end of the line
+ * @param command (modified) the command parsed
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int parse_line(const char* line, const char* eol, command_t* command){
+	M_EXIT_IF(eol == line, ERR_IO, "%s", "Found line with only a '\\n' in program input file");
+	M_EXIT_IF(eol - line > MAX_COMMAND_LENGTH, ERR_BAD_PARAMETER, "%s", "Line too long in program input file");
+
+	command_t c;
+	(void)memset(&c, 0, sizeof(c));
+
+	const char* cursor = line;
+	const char* word = NULL;
+	size_t word_len = 0;
+
+	NEXT_WORD();
+	M_EXIT_IF_ERR(parse_order(&c, word, word_len), "Error trying to parse order");
+
+	NEXT_WORD();
+	M_EXIT_IF_ERR(parse_type_and_size(&c, word, word_len), "Error trying to parse type and size");
+
+	if(c.order == WRITE){
+		NEXT_WORD();
+		M_EXIT_IF_ERR(parse_data(&c, word, word_len), "Error trying to parse data");
+	}
+
+	NEXT_WORD();
+	M_EXIT_IF_ERR(parse_address(&c, word, word_len), "Error trying to parse address");
+
+	*command = c;
+	return ERR_NONE;
+}
+
+#undef NEXT_WORD
+
+int command_parse(const char** cursor, const char* end, command_t* command){
+	M_REQUIRE_NON_NULL(cursor);
+	M_REQUIRE_NON_NULL(command);
+
+	const char* line = *cursor;
+	if(line == NULL || line >= end) return ERR_EOF;
+
+	const char* eol = memchr(line, '\n', (size_t) (end - line));
+	if(eol == NULL){ // last line, without '\n'
+		eol = end;
+		*cursor = end;
+	}else{
+		*cursor = eol + 1;
+	}
+
+	return parse_line(line, eol, command);
+}
+
+#define MIN_COMMAND_LENGTH 24 // "R I @0x" + 16 hex + '\n'
+
+/**
+ * @brief Makes sure the program can hold (at least) nb_lines commands without reallocation
+ * @param program (modified) the program to extend
+ * @param nb_lines the number of commands to make room for
+ * @return ERR_NONE if successful, ERR_MEM otherwise
+ */
+static int program_reserve(program_t* program, size_t nb_lines){
+	if(nb_lines <= program->allocated) return ERR_NONE;
+	M_EXIT_IF(nb_lines > SIZE_MAX / sizeof(command_t), ERR_MEM, "cannot reserve %zu commands", nb_lines);
+
+	command_t* listing = realloc(program->listing, nb_lines * sizeof(command_t));
+	M_EXIT_IF_NULL(listing, nb_lines * sizeof(command_t));
+	program->listing = listing;
+	program->allocated = nb_lines;
+
+	return ERR_NONE;
+}
+
+int program_parse(const char* buffer, size_t size, program_t* program, size_t* line_no){
+	M_REQUIRE_NON_NULL(program);
+	M_REQUIRE_NON_NULL(line_no);
+	M_REQUIRE(buffer != NULL || size == 0, ERR_BAD_PARAMETER, "%s", "parameter buffer is NULL");
+
+	// every line takes at least MIN_COMMAND_LENGTH chars (but the last one may miss its '\n')
+	M_EXIT_IF_ERR(program_reserve(program, program->nb_lines + size / MIN_COMMAND_LENGTH + 1),
+								"Error trying to allocate memory for the program");
 
-	virt_addr_t vaddr;
-	init_virt_addr64(&vaddr, a_int);
-	c->vaddr = vaddr;
+	const char* cursor = buffer;
+	const char* const end = buffer + size;
+	while(cursor < end){
+		++(*line_no);
+		command_t c;
+		error_code err = command_parse(&cursor, end, &c);
+		if(err == ERR_NONE) err = program_add_command(program, &c);
+		if(err != ERR_NONE) return err; // *line_no is reported by the caller, which knows where the buffer starts
+	}
 
 	return ERR_NONE;
 }
+
+int program_read(const char* filename, program_t* program){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0){
+		close(fd);
+		M_EXIT(ERR_IO, "Cannot stat %s", filename);
+	}
+	if(st.st_size == 0){ // empty program
+		close(fd);
+		M_EXIT_IF_ERR(program_init(program), "Error initializing program");
+		return ERR_NONE;
+	}
+
+	// the whole file is parsed in place
+	const size_t size = (size_t) st.st_size;
+	const char* text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	M_REQUIRE(text != MAP_FAILED, ERR_MEM, "Cannot map %s", filename);
+	(void)posix_madvise((void*) text, size, POSIX_MADV_SEQUENTIAL);
+
+	// initialized once nothing can fail but the parsing, as with fopen() before
+	if(program_init(program) != ERR_NONE){
+		munmap((void*) text, size);
+		M_EXIT(ERR_MEM, "%s", "Error initializing program");
+	}
+
+	size_t line_no = 0;
+	error_code err = program_parse(text, size, program, &line_no);
+	munmap((void*) text, size);
+
+	M_EXIT_IF(err != ERR_NONE, err, "%s:%zu: error reading program", filename, line_no);
+	return ERR_NONE;
+}
+
+int command_read(FILE* input, command_t* command){
+	M_REQUIRE_NON_NULL(input);
+	M_REQUIRE_NON_NULL(command);
+
+	char str[MAX_COMMAND_LENGTH+2]; // +2 accounts for '\n' and '\0'
+	if(fgets(str, sizeof(str), input) == NULL){
+		M_REQUIRE(!ferror(input), ERR_IO, "%s", "Error reading program input file");
+		return ERR_EOF;
+	}
+
+	const size_t len_read = strlen(str);
+	M_EXIT_IF(len_read > MAX_COMMAND_LENGTH && str[MAX_COMMAND_LENGTH] != '\n', ERR_BAD_PARAMETER, "%s",
+						"Line too long in program input file");
+
+	const char* cursor = str;
+	return command_parse(&cursor, str + len_read, command);
+}
@@ -14,6 +14,9 @@
 #include "mem_access.h" // for mem_access_t
 #include "addr.h" // for virt_addr_t, word_t
  
+#define MAX_COMMAND_LENGTH 36 // maximal length of a command line in a text program (without '\n')
+#define MAX_PRINTED_COMMAND_LENGTH 48 // upper bound on what command_format() writes ('\n' included)
+
 typedef enum {
 	READ,
 	WRITE
@@ -55,6 +58,13 @@ typedef struct{
  */
 int program_init(program_t* program);
 
+/**
+ * @brief check that a command makes sense (coherent order, type, size, data and address).
+ * @param command the command to be checked.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_validate(const command_t* command);
+
 /**
  * @brief add a command (line) to a program. Reallocate memory if necessary.
  * @param program (modified) the program where to add to.
@@ -78,6 +88,14 @@ int program_shrink(program_t* program);
  */
 int program_print(FILE* output, const program_t* program);
 
+/**
+ * @brief Render one command as a line of text, as printed by program_print().
+ * @param line (modified) where to write the line; room for MAX_PRINTED_COMMAND_LENGTH chars is needed.
+ * @param command the command to be rendered.
+ * @return the number of chars written (final '\n' included, no '\0' added).
+ */
+size_t command_format(char* line, const command_t* command);
+
 /**
  * @brief Read a program (list of commands) from a file.
  * @param filename the name of the file to read from.
@@ -86,6 +104,36 @@ int program_print(FILE* output, const program_t* program);
  */
 int program_read(const char* filename, program_t* program);
 
+/**
+ * @brief Parse text commands from a buffer (one per line) and add them to a program.
+ * Each command is validated through program_add_command().
+ * @param buffer the text to parse (does not need to be '\0'-terminated).
+ * @param size the number of chars in the buffer.
+ * @param program (modified) the program to add the commands to.
+ * @param line_no (modified) incremented for each line parsed; on error, it is the number of the faulty line
+ * (not reported here: the caller knows which line of the file the buffer starts at).
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_parse(const char* buffer, size_t size, program_t* program, size_t* line_no);
+
+/**
+ * @brief Parse (without validating it) the text command starting at *cursor.
+ * @param cursor (modified) position in the text; moved to the beginning of the next line.
+ * @param end end of the text.
+ * @param command (modified) the command parsed.
+ * @return ERR_NONE if ok, ERR_EOF if there is no more text, appropriate error code otherwise.
+ */
+int command_parse(const char** cursor, const char* end, command_t* command);
+
+/**
+ * @brief Read (parse) the next command (line) from a text stream.
+ * The command is only parsed, not validated (see command_validate()).
+ * @param input the stream to read from.
+ * @param command (modified) the command read.
+ * @return ERR_NONE if ok, ERR_EOF at end of stream, appropriate error code otherwise.
+ */
+int command_read(FILE* input, command_t* command);
+
 /**
  * @brief "Destructor" for program_t: free its content.
  * @param program (modified) the program to free
@@ -0,0 +1,199 @@
+/**
+ * @file commands_bin.c
+ * @brief Compact binary encoding of processor commands, and a memory-mapped reader for it
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for mmap(), fileno()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // memcmp(), strncpy()
+#include <fcntl.h> // open()
+#include <unistd.h> // close()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+
+#include "commands_bin.h"
+#include "commands.h"
+#include "addr_mng.h"
+#include "addr.h"
+#include "error.h"
+
+_Static_assert(sizeof(command_bin_header_t) == 24, "unexpected binary header size");
+_Static_assert(sizeof(command_bin_t) == 16, "unexpected binary record size");
+
+int command_bin_encode(const command_t* command, command_bin_t* record){
+	M_REQUIRE_NON_NULL(command);
+	M_REQUIRE_NON_NULL(record);
+
+	record->order = (uint8_t) command->order;
+	record->type = (uint8_t) command->type;
+	record->data_size = (uint8_t) command->data_size;
+	record->reserved = 0;
+	record->write_data = command->write_data;
+	record->vaddr = virt_addr_t_to_uint64_t(&command->vaddr);
+
+	return ERR_NONE;
+}
+
+int command_bin_decode(const command_bin_t* record, command_t* command){
+	M_REQUIRE_NON_NULL(record);
+	M_REQUIRE_NON_NULL(command);
+	M_REQUIRE(record->order <= WRITE, ERR_BAD_PARAMETER, "%s", "binary record has an invalid order");
+	M_REQUIRE(record->type <= DATA, ERR_BAD_PARAMETER, "%s", "binary record has an invalid type");
+
+	command->order = (command_word_t) record->order;
+	command->type = (mem_access_t) record->type;
+	command->data_size = record->data_size;
+	command->write_data = record->write_data;
+
+	return init_virt_addr64(&command->vaddr, record->vaddr);
+}
+
+/**
+ * @brief Check a binary header against the expected magic/version/record size
+ * @param header the header to check
+ * @param payload_size the number of bytes available after the header
+ * @return ERR_NONE if the header is consistent, ERR_IO otherwise
+ */
+static int check_header(const command_bin_header_t* header, size_t payload_size){
+	M_REQUIRE(memcmp(header->magic, CMD_BIN_MAGIC, CMD_BIN_MAGIC_SIZE) == 0, ERR_IO, "%s",
+						"Not a binary program file (bad magic)");
+	M_REQUIRE(header->version == CMD_BIN_VERSION, ERR_IO, "Unsupported binary program version %u",
+						(unsigned) header->version);
+	M_REQUIRE(header->record_size == sizeof(command_bin_t), ERR_IO, "Unexpected record size %u",
+						(unsigned) header->record_size);
+	M_REQUIRE(header->nb_lines <= payload_size / sizeof(command_bin_t), ERR_IO, "%s",
+						"Binary program file is truncated");
+	return ERR_NONE;
+}
+
+int command_bin_header_init(command_bin_header_t* header, uint64_t nb_lines){
+	M_REQUIRE_NON_NULL(header);
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, CMD_BIN_MAGIC, CMD_BIN_MAGIC_SIZE);
+	header->version = CMD_BIN_VERSION;
+	header->record_size = sizeof(command_bin_t);
+	header->nb_lines = nb_lines;
+
+	return ERR_NONE;
+}
+
+#define WRITE_BUFFER_RECORDS 4096
+
+int program_write_bin(const char* filename, const program_t* program){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	FILE* output = fopen(filename, "wb");
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(output, ERR_IO);
+
+	command_bin_header_t header;
+	command_bin_header_init(&header, program->nb_lines);
+	if(fwrite(&header, sizeof(header), 1, output) != 1){
+		fclose(output);
+		M_EXIT(ERR_IO, "Cannot write header to %s", filename);
+	}
+
+	// encode by blocks to keep the number of fwrite() calls low
+	command_bin_t buffer[WRITE_BUFFER_RECORDS];
+	size_t nb_buffered = 0;
+	for_all_lines(line, program){
+		command_bin_encode(line, &buffer[nb_buffered]);
+		if(++nb_buffered == WRITE_BUFFER_RECORDS || line + 1 == end_pgm_){
+			if(fwrite(buffer, sizeof(command_bin_t), nb_buffered, output) != nb_buffered){
+				fclose(output);
+				M_EXIT(ERR_IO, "Cannot write records to %s", filename);
+			}
+			nb_buffered = 0;
+		}
+	}
+
+	M_REQUIRE(fclose(output) == 0, ERR_IO, "Cannot close %s", filename);
+	return ERR_NONE;
+}
+
+int program_bin_map(const char* filename, program_bin_t* program){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	memset(program, 0, sizeof(*program));
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(command_bin_header_t)){
+		close(fd);
+		M_EXIT(ERR_IO, "%s is too small to be a binary program file", filename);
+	}
+
+	const size_t map_size = (size_t) st.st_size;
+	void* map_start = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference on the file
+	M_REQUIRE(map_start != MAP_FAILED, ERR_MEM, "Cannot map %s", filename);
+
+	const command_bin_header_t* header = map_start;
+	error_code err = check_header(header, map_size - sizeof(*header));
+	if(err != ERR_NONE){
+		munmap(map_start, map_size);
+		return err;
+	}
+
+	// records are read sequentially
+	(void)posix_madvise(map_start, map_size, POSIX_MADV_SEQUENTIAL);
+
+	program->listing = (const command_bin_t*) (header + 1);
+	program->nb_lines = header->nb_lines;
+	program->map_start = map_start;
+	program->map_size = map_size;
+
+	return ERR_NONE;
+}
+
+int program_bin_unmap(program_bin_t* program){
+	M_REQUIRE_NON_NULL(program);
+	M_REQUIRE_NON_NULL(program->map_start);
+
+	M_REQUIRE(munmap(program->map_start, program->map_size) == 0, ERR_MEM, "%s", "Cannot unmap binary program");
+	memset(program, 0, sizeof(*program));
+
+	return ERR_NONE;
+}
+
+int program_read_bin(const char* filename, program_t* program){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	program_bin_t mapped;
+	M_EXIT_IF_ERR(program_bin_map(filename, &mapped), "Error mapping binary program");
+
+	error_code err = program_init(program);
+	command_t c;
+	for_all_bin_lines(line, &mapped){
+		if(err != ERR_NONE) break;
+		err = command_bin_decode(line, &c);
+		if(err == ERR_NONE) err = program_add_command(program, &c);
+	}
+
+	program_bin_unmap(&mapped);
+	return err;
+}
+
+int is_bin_program_file(const char* filename){
+	if(filename == NULL) return 0;
+
+	FILE* input = fopen(filename, "rb");
+	if(input == NULL) return 0;
+
+	char magic[CMD_BIN_MAGIC_SIZE];
+	const int is_bin = fread(magic, 1, CMD_BIN_MAGIC_SIZE, input) == CMD_BIN_MAGIC_SIZE
+	                   && memcmp(magic, CMD_BIN_MAGIC, CMD_BIN_MAGIC_SIZE) == 0;
+	fclose(input);
+
+	return is_bin;
+}
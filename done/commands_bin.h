@@ -0,0 +1,118 @@
+#pragma once
+
+/**
+ * @file commands_bin.h
+ * @brief Compact binary encoding of processor commands, and a memory-mapped reader for it
+ *
+ * A binary program file is a fixed-size header followed by nb_lines fixed-width
+ * records (one per command). Fields are stored in host (little-endian) byte order.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "commands.h" // for command_t, program_t
+
+#define CMD_BIN_MAGIC "PPSCMDB"
+#define CMD_BIN_MAGIC_SIZE 8 // including the final '\0'
+#define CMD_BIN_VERSION 1u
+
+typedef struct {
+	char magic[CMD_BIN_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t nb_lines;
+} command_bin_header_t;
+
+typedef struct {
+	uint8_t order; // command_word_t
+	uint8_t type; // mem_access_t
+	uint8_t data_size; // in bytes
+	uint8_t reserved; // always 0
+	uint32_t write_data;
+	uint64_t vaddr; // 64-bit pattern of the virtual address
+} command_bin_t;
+
+typedef struct {
+	const command_bin_t* listing; // points into the mapped file (read-only)
+	size_t nb_lines;
+	void* map_start; // start of the mapping (header included)
+	size_t map_size;
+} program_bin_t;
+
+/**
+ * @brief A useful macro to loop over all lines of a mapped binary program.
+ * X will be of type `const command_bin_t*` and P has to be of type `program_bin_t*`.
+ *
+ * Example usage:
+ *    for_all_bin_lines(line, program) { command_bin_decode(line, &command); }
+ */
+#define for_all_bin_lines(X, P) const command_bin_t* end_bin_pgm_ = (P)->listing + (P)->nb_lines; \
+    for(const command_bin_t* X = (P)->listing; X < end_bin_pgm_; ++X)
+
+/**
+ * @brief Pack a command into its binary record.
+ * @param command the command to encode
+ * @param record (modified) the binary record
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_bin_encode(const command_t* command, command_bin_t* record);
+
+/**
+ * @brief Unpack a binary record into a command. Only the field ranges are checked;
+ * full validation is left to program_add_command().
+ * @param record the binary record to decode
+ * @param command (modified) the decoded command
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_bin_decode(const command_bin_t* record, command_t* command);
+
+/**
+ * @brief Initialize the header of a binary program file.
+ * @param header (modified) the header to initialize
+ * @param nb_lines the number of records that will follow the header
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int command_bin_header_init(command_bin_header_t* header, uint64_t nb_lines);
+
+/**
+ * @brief Write a whole program to a binary program file.
+ * @param filename the name of the file to write to
+ * @param program the program to be written
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_write_bin(const char* filename, const program_t* program);
+
+/**
+ * @brief Map a binary program file in memory (read-only). No line is copied nor parsed.
+ * @param filename the name of the binary file to map
+ * @param program (modified) the mapped program; to be released with program_bin_unmap()
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_bin_map(const char* filename, program_bin_t* program);
+
+/**
+ * @brief Release a program mapped by program_bin_map().
+ * @param program (modified) the program to unmap
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_bin_unmap(program_bin_t* program);
+
+/**
+ * @brief Read a binary program file into a (regular) program.
+ * Every command is validated through program_add_command().
+ * @param filename the name of the binary file to read from
+ * @param program (modified) the program to be filled from file
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_read_bin(const char* filename, program_t* program);
+
+/**
+ * @brief Tell whether a file starts with the binary program magic.
+ * @param filename the name of the file to check
+ * @return 1 if the file is a binary program file, 0 otherwise
+ */
+int is_bin_program_file(const char* filename);
@@ -0,0 +1,322 @@
+/**
+ * @file commands_packed.c
+ * @brief Compressed (delta + varint) encoding of programs, in memory and on disk
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for mmap()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // memcmp(), memcpy()
+#include <fcntl.h> // open()
+#include <unistd.h> // close()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+
+#include "commands_packed.h"
+#include "commands.h"
+#include "addr_mng.h"
+#include "addr.h"
+#include "error.h"
+
+_Static_assert(sizeof(command_packed_header_t) == 32, "unexpected packed header size");
+
+#define PACKED_INIT_SIZE 4096
+#define VARINT_MAX_BYTES 10 // for 64 bits
+#define WORD_MAX_VALUE 0xFFFFFFFFu
+
+// ======================================================================
+static inline uint64_t zigzag(uint64_t delta){
+	return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+static inline uint64_t unzigzag(uint64_t z){
+	return (z >> 1) ^ (0 - (z & 1));
+}
+
+static inline uint8_t* put_varint(uint8_t* p, uint64_t v){
+	while(v >= 0x80){
+		*p++ = (uint8_t) (v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (uint8_t) v;
+	return p;
+}
+
+/**
+ * @brief Decodes one varint
+ * @param p first byte of the varint
+ * @param end end of the encoded bytes
+ * @param v (modified) the decoded value
+ * @return the byte right after the varint, or NULL if it is truncated or too long
+ */
+static inline const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint64_t* v){
+	uint64_t value = 0;
+	for(unsigned shift = 0; p < end && shift < 7 * VARINT_MAX_BYTES; shift += 7){
+		const uint8_t b = *p++;
+		value |= (uint64_t) (b & 0x7F) << shift;
+		if(b < 0x80){
+			*v = value;
+			return p;
+		}
+	}
+	return NULL;
+}
+
+// ======================================================================
+int packed_program_init(packed_program_t* packed){
+	M_REQUIRE_NON_NULL(packed);
+
+	memset(packed, 0, sizeof(*packed));
+	packed->bytes = malloc(PACKED_INIT_SIZE);
+	M_EXIT_IF_NULL(packed->bytes, (size_t) PACKED_INIT_SIZE);
+	packed->allocated = PACKED_INIT_SIZE;
+
+	return ERR_NONE;
+}
+
+int packed_program_free(packed_program_t* packed){
+	M_REQUIRE_NON_NULL(packed);
+
+	if(packed->map_start != NULL){
+		M_REQUIRE(munmap(packed->map_start, packed->map_size) == 0, ERR_MEM, "%s", "Cannot unmap packed program");
+	}else{
+		free(packed->bytes);
+	}
+	memset(packed, 0, sizeof(*packed));
+
+	return ERR_NONE;
+}
+
+/**
+ * @brief Makes sure one more command (of any size) fits in a packed program
+ * @param packed (modified) the packed program to enlarge if needed
+ * @return ERR_NONE if successful, ERR_MEM otherwise
+ */
+static int packed_program_reserve(packed_program_t* packed){
+	if(packed->size + CMD_PACKED_MAX_SIZE <= packed->allocated) return ERR_NONE;
+	M_EXIT_IF(packed->allocated > SIZE_MAX / 2, ERR_MEM, "%s", "packed program too large");
+
+	uint8_t* bytes = realloc(packed->bytes, 2 * packed->allocated);
+	M_EXIT_IF_NULL(bytes, 2 * packed->allocated);
+	packed->bytes = bytes;
+	packed->allocated *= 2;
+
+	return ERR_NONE;
+}
+
+int packed_program_add_command(packed_program_t* packed, const command_t* command){
+	M_REQUIRE_NON_NULL(packed);
+	M_REQUIRE(packed->map_start == NULL, ERR_BAD_PARAMETER, "%s", "cannot add to a mapped packed program");
+	M_EXIT_IF_ERR(command_validate(command), "Invalid command");
+	M_EXIT_IF_ERR(packed_program_reserve(packed), "Error trying to enlarge packed program");
+
+	const uint64_t vaddr = virt_addr_t_to_uint64_t(&command->vaddr);
+	const uint64_t stride = vaddr - packed->last_vaddr;
+
+	uint8_t tag = (command->order == WRITE ? PACKED_TAG_WRITE : 0)
+	              | (command->type == DATA ? PACKED_TAG_DATA : 0)
+	              | (stride == packed->last_stride ? PACKED_TAG_SAME : 0);
+	if(command->data_size == sizeof(byte_t)) tag |= PACKED_SIZE_BYTE;
+	else if(command->data_size != sizeof(word_t)) tag |= PACKED_SIZE_OTHER;
+
+	uint8_t* p = packed->bytes + packed->size;
+	*p++ = tag;
+	if((tag & PACKED_TAG_SIZE) == PACKED_SIZE_OTHER) *p++ = (uint8_t) command->data_size;
+	if(!(tag & PACKED_TAG_SAME)) p = put_varint(p, zigzag(stride));
+	if(tag & PACKED_TAG_WRITE) p = put_varint(p, command->write_data);
+
+	packed->size = (size_t) (p - packed->bytes);
+	packed->last_vaddr = vaddr;
+	packed->last_stride = stride;
+	++packed->nb_lines;
+
+	return ERR_NONE;
+}
+
+int packed_program_pack(const program_t* program, packed_program_t* packed){
+	M_REQUIRE_NON_NULL(program);
+	M_REQUIRE_NON_NULL(packed);
+
+	M_EXIT_IF_ERR(packed_program_init(packed), "Error initializing packed program");
+	for_all_lines(line, program){
+		error_code err = packed_program_add_command(packed, line);
+		if(err != ERR_NONE){
+			packed_program_free(packed);
+			return err;
+		}
+	}
+
+	return ERR_NONE;
+}
+
+int packed_program_unpack(const packed_program_t* packed, program_t* program){
+	M_REQUIRE_NON_NULL(packed);
+	M_REQUIRE_NON_NULL(program);
+
+	M_EXIT_IF_ERR(program_init(program), "Error initializing program");
+
+	packed_cursor_t cursor;
+	command_t c;
+	error_code err = packed_cursor_init(&cursor, packed);
+	while(err == ERR_NONE && (err = packed_cursor_next(&cursor, &c)) == ERR_NONE){
+		err = program_add_command(program, &c);
+	}
+	M_REQUIRE(program->nb_lines == packed->nb_lines || err != ERR_EOF, ERR_IO, "%s",
+	          "packed program holds fewer commands than announced");
+
+	return err == ERR_EOF ? ERR_NONE : err;
+}
+
+// ======================================================================
+int packed_program_write(const char* filename, const packed_program_t* packed){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(packed);
+
+	command_packed_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CMD_PACKED_MAGIC, CMD_PACKED_MAGIC_SIZE);
+	header.version = CMD_PACKED_VERSION;
+	header.nb_lines = packed->nb_lines;
+	header.size = packed->size;
+
+	FILE* output = fopen(filename, "wb");
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(output, ERR_IO);
+
+	if(fwrite(&header, sizeof(header), 1, output) != 1
+	   || fwrite(packed->bytes, 1, packed->size, output) != packed->size){
+		fclose(output);
+		M_EXIT(ERR_IO, "Cannot write packed program to %s", filename);
+	}
+
+	M_REQUIRE(fclose(output) == 0, ERR_IO, "Cannot close %s", filename);
+	return ERR_NONE;
+}
+
+int packed_program_map(const char* filename, packed_program_t* packed){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(packed);
+
+	memset(packed, 0, sizeof(*packed));
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(command_packed_header_t)){
+		close(fd);
+		M_EXIT(ERR_IO, "%s is too small to be a packed program file", filename);
+	}
+
+	const size_t map_size = (size_t) st.st_size;
+	void* map_start = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference on the file
+	M_REQUIRE(map_start != MAP_FAILED, ERR_MEM, "Cannot map %s", filename);
+
+	const command_packed_header_t* header = map_start;
+	if(memcmp(header->magic, CMD_PACKED_MAGIC, CMD_PACKED_MAGIC_SIZE) != 0
+	   || header->version != CMD_PACKED_VERSION
+	   || header->size > map_size - sizeof(*header)){
+		munmap(map_start, map_size);
+		M_EXIT(ERR_IO, "%s is not a valid packed program file", filename);
+	}
+
+	// commands are decoded sequentially
+	(void)posix_madvise(map_start, map_size, POSIX_MADV_SEQUENTIAL);
+
+	packed->bytes = (uint8_t*) (header + 1);
+	packed->size = header->size;
+	packed->nb_lines = header->nb_lines;
+	packed->map_start = map_start;
+	packed->map_size = map_size;
+
+	return ERR_NONE;
+}
+
+int program_read_packed(const char* filename, program_t* program){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	packed_program_t packed;
+	M_EXIT_IF_ERR(packed_program_map(filename, &packed), "Error mapping packed program");
+
+	error_code err = packed_program_unpack(&packed, program);
+	packed_program_free(&packed);
+
+	return err;
+}
+
+int is_packed_program_file(const char* filename){
+	if(filename == NULL) return 0;
+
+	FILE* input = fopen(filename, "rb");
+	if(input == NULL) return 0;
+
+	char magic[CMD_PACKED_MAGIC_SIZE];
+	const int is_packed = fread(magic, 1, CMD_PACKED_MAGIC_SIZE, input) == CMD_PACKED_MAGIC_SIZE
+	                      && memcmp(magic, CMD_PACKED_MAGIC, CMD_PACKED_MAGIC_SIZE) == 0;
+	fclose(input);
+
+	return is_packed;
+}
+
+// ======================================================================
+int packed_cursor_init(packed_cursor_t* cursor, const packed_program_t* packed){
+	M_REQUIRE_NON_NULL(cursor);
+	M_REQUIRE_NON_NULL(packed);
+
+	cursor->pos = packed->bytes;
+	cursor->end = packed->bytes + packed->size;
+	cursor->vaddr = 0;
+	cursor->stride = 0;
+
+	return ERR_NONE;
+}
+
+int packed_cursor_next(packed_cursor_t* cursor, command_t* command){
+	M_REQUIRE_NON_NULL(cursor);
+	M_REQUIRE_NON_NULL(command);
+
+	const uint8_t* p = cursor->pos;
+	if(p >= cursor->end) return ERR_EOF;
+
+	const uint8_t tag = *p++;
+	M_REQUIRE(!(tag & PACKED_TAG_UNUSED) && (tag & PACKED_TAG_SIZE) != PACKED_TAG_SIZE, ERR_IO,
+	          "invalid packed command tag 0x%02X", (unsigned) tag);
+
+	command->order = (tag & PACKED_TAG_WRITE) ? WRITE : READ;
+	command->type = (tag & PACKED_TAG_DATA) ? DATA : INSTRUCTION;
+	switch(tag & PACKED_TAG_SIZE){
+	case PACKED_SIZE_WORD:
+		command->data_size = sizeof(word_t);
+		break;
+	case PACKED_SIZE_BYTE:
+		command->data_size = sizeof(byte_t);
+		break;
+	default:
+		M_REQUIRE(p < cursor->end, ERR_IO, "%s", "truncated packed command");
+		command->data_size = *p++;
+		break;
+	}
+
+	if(!(tag & PACKED_TAG_SAME)){
+		uint64_t z;
+		M_REQUIRE((p = get_varint(p, cursor->end, &z)) != NULL, ERR_IO, "%s", "malformed packed address");
+		cursor->stride = unzigzag(z);
+	}
+	cursor->vaddr += cursor->stride;
+
+	command->write_data = 0;
+	if(tag & PACKED_TAG_WRITE){
+		uint64_t data;
+		M_REQUIRE((p = get_varint(p, cursor->end, &data)) != NULL && data <= WORD_MAX_VALUE, ERR_IO,
+		          "%s", "malformed packed write data");
+		command->write_data = (word_t) data;
+	}
+
+	cursor->pos = p;
+	return init_virt_addr64(&command->vaddr, cursor->vaddr);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+/**
+ * @file commands_packed.h
+ * @brief Compressed (delta + varint) encoding of programs, in memory and on disk
+ *
+ * Each command is encoded as:
+ *  - one tag byte: order, type, data size and whether the address moves by
+ *    the same stride as for the previous command;
+ *  - (only if the data size is neither a word nor a byte) the data size byte;
+ *  - (only if the stride changed) the new stride, i.e. the difference with the
+ *    previous address, zigzag-encoded as a varint;
+ *  - (only for writes) the write data, as a varint.
+ * Varints are LEB128: 7 bits per byte, least significant first, high bit set on all
+ * bytes but the last one. Sequential or strided traces thus take 1 byte per command.
+ *
+ * A packed program file is a fixed-size header followed by the encoded commands.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "commands.h" // for command_t, program_t
+
+#define CMD_PACKED_MAGIC "PPSCMDZ"
+#define CMD_PACKED_MAGIC_SIZE 8 // including the final '\0'
+#define CMD_PACKED_VERSION 1u
+
+#define CMD_PACKED_MAX_SIZE 26 // tag + size + 10-bytes stride + 5-bytes data, rounded up
+
+// tag byte
+#define PACKED_TAG_WRITE   0x01 // order is WRITE (READ otherwise)
+#define PACKED_TAG_DATA    0x02 // type is DATA (INSTRUCTION otherwise)
+#define PACKED_TAG_SIZE    0x0C // data size code
+#define PACKED_TAG_SAME    0x10 // same stride as the previous command: no stride follows
+#define PACKED_TAG_UNUSED  0xE0 // always 0
+
+#define PACKED_SIZE_WORD  0x00 // data size codes
+#define PACKED_SIZE_BYTE  0x04
+#define PACKED_SIZE_OTHER 0x08 // data size byte follows
+
+typedef struct {
+	char magic[CMD_PACKED_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t reserved; // always 0
+	uint64_t nb_lines;
+	uint64_t size; // number of bytes of encoded commands
+} command_packed_header_t;
+
+typedef struct {
+	uint8_t* bytes; // encoded commands; dynamically allocated, or inside map_start
+	size_t size; // number of bytes used
+	size_t allocated; // number of bytes allocated (0 when mapped)
+	size_t nb_lines;
+	uint64_t last_vaddr; // encoder state: address of the last command added
+	uint64_t last_stride; // encoder state: stride of the last command added
+	void* map_start; // non-NULL if read-only mapped from a file (header included)
+	size_t map_size;
+} packed_program_t;
+
+typedef struct {
+	const uint8_t* pos; // next byte to decode
+	const uint8_t* end;
+	uint64_t vaddr; // decoder state, as in packed_program_t
+	uint64_t stride;
+} packed_cursor_t;
+
+/**
+ * @brief "Constructor" for packed_program_t: initialize an empty (writable) packed program.
+ * @param packed (modified) the packed program to be initialized.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_init(packed_program_t* packed);
+
+/**
+ * @brief Release a packed program (allocated or mapped).
+ * @param packed (modified) the packed program to be freed.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_free(packed_program_t* packed);
+
+/**
+ * @brief Validate (see command_validate()) and append a command to a packed program.
+ * @param packed (modified) the packed program where to add to; must not be mapped.
+ * @param command the command to be added.
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_add_command(packed_program_t* packed, const command_t* command);
+
+/**
+ * @brief Pack a whole program.
+ * @param program the program to be packed.
+ * @param packed (modified) the packed program; to be released with packed_program_free().
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_pack(const program_t* program, packed_program_t* packed);
+
+/**
+ * @brief Unpack a whole packed program. Every command is validated through program_add_command().
+ * @param packed the packed program to be unpacked.
+ * @param program (modified) the program; to be released with program_free().
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_unpack(const packed_program_t* packed, program_t* program);
+
+/**
+ * @brief Write a packed program to a packed program file.
+ * @param filename the name of the file to write to
+ * @param packed the packed program to be written
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_write(const char* filename, const packed_program_t* packed);
+
+/**
+ * @brief Map a packed program file in memory (read-only). Nothing is decoded.
+ * @param filename the name of the packed file to map
+ * @param packed (modified) the mapped program; to be released with packed_program_free()
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_program_map(const char* filename, packed_program_t* packed);
+
+/**
+ * @brief Read a packed program file into a (regular) program.
+ * Every command is validated through program_add_command().
+ * @param filename the name of the packed file to read from
+ * @param program (modified) the program to be filled from file
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_read_packed(const char* filename, program_t* program);
+
+/**
+ * @brief Tell whether a file starts with the packed program magic.
+ * @param filename the name of the file to check
+ * @return 1 if the file is a packed program file, 0 otherwise
+ */
+int is_packed_program_file(const char* filename);
+
+/**
+ * @brief Start decoding a packed program from its first command.
+ * @param cursor (modified) the cursor to be initialized
+ * @param packed the packed program to decode; must outlive the cursor
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int packed_cursor_init(packed_cursor_t* cursor, const packed_program_t* packed);
+
+/**
+ * @brief Decode the next command of a packed program. The command is only decoded, not validated.
+ * @param cursor (modified) the cursor to decode from
+ * @param command (modified) the command decoded
+ * @return ERR_NONE if ok, ERR_EOF after the last command, ERR_IO on malformed input.
+ */
+int packed_cursor_next(packed_cursor_t* cursor, command_t* command);
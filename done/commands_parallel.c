@@ -0,0 +1,193 @@
+/**
+ * @file commands_parallel.c
+ * @brief Multi-threaded reading of (large) text program files
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for mmap(), sysconf()
+
+#include <stdio.h>
+#include <stdlib.h> // realloc()
+#include <string.h> // memchr(), memcpy()
+#include <pthread.h>
+#include <fcntl.h> // open()
+#include <unistd.h> // close(), sysconf()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+
+#include "commands_parallel.h"
+#include "commands.h"
+#include "error.h"
+
+typedef struct {
+	const char* start; // first char of the chunk (beginning of a line)
+	size_t size; // number of chars in the chunk (whole lines only)
+	program_t program; // commands parsed from the chunk
+	size_t line_no; // on error, line number (in the chunk) of the faulty line
+	error_code err;
+} parse_job_t;
+
+static void* parse_worker(void* arg){
+	parse_job_t* job = arg;
+	job->err = program_init(&job->program);
+	if(job->err == ERR_NONE){
+		job->err = program_parse(job->start, job->size, &job->program, &job->line_no);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Computes how many threads are worth using for a text of the given size
+ * @param size the number of chars to parse
+ * @param nb_threads the number of threads asked for (0 for one per online processor)
+ * @return the number of chunks to split the text into (at least 1)
+ */
+static size_t nb_chunks(size_t size, size_t nb_threads){
+	if(nb_threads == 0){
+		const long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nb_threads = online > 0 ? (size_t) online : 1;
+	}
+	if(nb_threads > PARSE_MAX_THREADS) nb_threads = PARSE_MAX_THREADS;
+	if(nb_threads > size / PARSE_MIN_CHUNK) nb_threads = size / PARSE_MIN_CHUNK;
+	return nb_threads > 0 ? nb_threads : 1;
+}
+
+/**
+ * @brief Splits a text into chunks of (roughly) the same size, made of whole lines only
+ * @param text the text to split
+ * @param size the number of chars in the text
+ * @param jobs (modified) the nb_jobs jobs to set the chunks of; some chunks may be empty
+ * @param nb_jobs the number of chunks to split the text into
+ */
+static void split_lines(const char* text, size_t size, parse_job_t* jobs, size_t nb_jobs){
+	const char* const end = text + size;
+	const char* start = text;
+	for(size_t i = 0; i < nb_jobs; ++i){
+		const char* stop = end;
+		if(i + 1 < nb_jobs){
+			stop = text + (size / nb_jobs) * (i + 1);
+			if(stop < start) stop = start;
+			const char* eol = memchr(stop, '\n', (size_t) (end - stop));
+			stop = eol == NULL ? end : eol + 1;
+		}
+		jobs[i].start = start;
+		jobs[i].size = (size_t) (stop - start);
+		start = stop;
+	}
+}
+
+/**
+ * @brief Appends the commands of all the jobs, in order, into one program.
+ * The listing of the first job is reused (and the former one of the program freed).
+ * @param jobs the (successful) jobs to stitch
+ * @param nb_jobs the number of jobs
+ * @param program (modified) the resulting program
+ * @return ERR_NONE if successful, ERR_MEM otherwise
+ */
+static int stitch(parse_job_t* jobs, size_t nb_jobs, program_t* program){
+	size_t total = 0;
+	for(size_t i = 0; i < nb_jobs; ++i) total += jobs[i].program.nb_lines;
+
+	program_free(program);
+	*program = jobs[0].program;
+	jobs[0].program.listing = NULL;
+	if(total > program->allocated){
+		command_t* listing = realloc(program->listing, total * sizeof(command_t));
+		M_EXIT_IF_NULL(listing, total * sizeof(command_t));
+		program->listing = listing;
+		program->allocated = total;
+	}
+
+	for(size_t i = 1; i < nb_jobs; ++i){
+		memcpy(program->listing + program->nb_lines, jobs[i].program.listing,
+		       jobs[i].program.nb_lines * sizeof(command_t));
+		program->nb_lines += jobs[i].program.nb_lines;
+	}
+
+	return ERR_NONE;
+}
+
+/**
+ * @brief Parses a whole text on several threads
+ * @param text the text to parse
+ * @param size the number of chars in the text
+ * @param program (modified) the resulting program (left as is on parsing error)
+ * @param nb_threads the number of threads asked for (0 for one per online processor)
+ * @param line_no (modified) on error, the number of the first faulty line
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int parse_parallel(const char* text, size_t size, program_t* program, size_t nb_threads,
+                          size_t* line_no){
+	parse_job_t jobs[PARSE_MAX_THREADS];
+	memset(jobs, 0, sizeof(jobs));
+	pthread_t threads[PARSE_MAX_THREADS];
+	int started[PARSE_MAX_THREADS] = {0};
+
+	const size_t nb_jobs = nb_chunks(size, nb_threads);
+	split_lines(text, size, jobs, nb_jobs);
+
+	// the calling thread takes the last chunk; a chunk whose thread cannot be started is parsed here too
+	for(size_t i = 0; i + 1 < nb_jobs; ++i){
+		started[i] = pthread_create(&threads[i], NULL, parse_worker, &jobs[i]) == 0;
+	}
+	parse_worker(&jobs[nb_jobs - 1]);
+	for(size_t i = 0; i + 1 < nb_jobs; ++i){
+		if(started[i]) pthread_join(threads[i], NULL);
+		else parse_worker(&jobs[i]);
+	}
+
+	// all lines of the chunks before the first faulty one hold exactly one command
+	error_code err = ERR_NONE;
+	*line_no = 0;
+	for(size_t i = 0; i < nb_jobs && err == ERR_NONE; ++i){
+		err = jobs[i].err;
+		*line_no += err == ERR_NONE ? jobs[i].program.nb_lines : jobs[i].line_no;
+	}
+
+	if(err == ERR_NONE) err = stitch(jobs, nb_jobs, program);
+
+	for(size_t i = 0; i < nb_jobs; ++i){
+		if(jobs[i].program.listing != NULL) program_free(&jobs[i].program);
+	}
+	return err;
+}
+
+int program_read_parallel(const char* filename, program_t* program, size_t nb_threads){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(program);
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0){
+		close(fd);
+		M_EXIT(ERR_IO, "Cannot stat %s", filename);
+	}
+	if(st.st_size == 0){ // empty program
+		close(fd);
+		M_EXIT_IF_ERR(program_init(program), "Error initializing program");
+		return ERR_NONE;
+	}
+
+	// the whole file is parsed in place
+	const size_t size = (size_t) st.st_size;
+	const char* text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	M_REQUIRE(text != MAP_FAILED, ERR_MEM, "Cannot map %s", filename);
+
+	if(program_init(program) != ERR_NONE){
+		munmap((void*) text, size);
+		M_EXIT(ERR_MEM, "%s", "Error initializing program");
+	}
+
+	// the workers do not report errors: the faulty line is only known once rebased
+	size_t line_no = 0;
+	error_code err = parse_parallel(text, size, program, nb_threads, &line_no);
+	munmap((void*) text, size);
+
+	M_EXIT_IF(err != ERR_NONE, err, "%s:%zu: error reading program", filename, line_no);
+	return ERR_NONE;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * @file commands_parallel.h
+ * @brief Multi-threaded reading of (large) text program files
+ *
+ * The file is split into chunks at line boundaries; each chunk is parsed
+ * by its own thread and the partial programs are then stitched together
+ * in the original order.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+
+#include "commands.h" // for program_t
+
+#define PARSE_MAX_THREADS 64 // upper bound on the number of parsing threads
+#define PARSE_MIN_CHUNK (64 * 1024) // smaller chunks are not worth a thread
+
+/**
+ * @brief Read a program (list of commands) from a text file, parsing it on several threads.
+ * The resulting program is the same as the one program_read() would return: every
+ * command is validated through program_add_command() and errors are reported with
+ * the number of the first faulty line.
+ * @param filename the name of the file to read from.
+ * @param program the program to be filled from file.
+ * @param nb_threads the number of threads to use (0 for one per online processor).
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int program_read_parallel(const char* filename, program_t* program, size_t nb_threads);
@@ -0,0 +1,40 @@
+/**
+ * @file compile-memory.c
+ * @brief Compiles a memory description and its page files into a single memory image
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s description_filename [image_filename]\n", pgm);
+    fprintf(stderr, "          (description_filename" MEM_IMAGE_SUFFIX " is used if no image filename is given)\n");
+    fprintf(stderr, "examples: %s memory-desc-01.txt\n", pgm);
+    fprintf(stderr, "          %s memory-desc-01.txt memory-01.img\n", pgm);
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3) {
+        error(argv[0], "please provide a description filename:");
+        return 1;
+    }
+
+    if (mem_image_compile(argv[1], argc > 2 ? argv[2] : NULL) != ERR_NONE) {
+        error(argv[0], "cannot compile memory image.");
+        return 1;
+    }
+    return 0;
+}
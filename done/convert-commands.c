@@ -0,0 +1,114 @@
+/**
+ * @file convert-commands.c
+ * @brief Converts a program between the text, binary and packed formats
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "commands.h"
+#include "commands_bin.h"
+#include "commands_packed.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+typedef enum {
+    FORMAT_TXT,
+    FORMAT_BIN,
+    FORMAT_PACK,
+    FORMAT_UNKNOWN
+} format_t;
+
+static const char* const FORMAT_NAMES[] = { "txt", "bin", "pack" };
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s FROM2TO input_filename output_filename\n", pgm);
+    fprintf(stderr, "          where FROM and TO are among txt, bin and pack\n");
+    fprintf(stderr, "examples: %s txt2bin commands01.txt commands01.bin\n", pgm);
+    fprintf(stderr, "          %s pack2txt commands01.pack commands01.txt\n", pgm);
+}
+
+// ======================================================================
+static format_t parse_format(const char* name, size_t length)
+{
+    for (format_t f = FORMAT_TXT; f < FORMAT_UNKNOWN; ++f) {
+        if (strlen(FORMAT_NAMES[f]) == length && !strncmp(name, FORMAT_NAMES[f], length)) return f;
+    }
+    return FORMAT_UNKNOWN;
+}
+
+// ======================================================================
+static int read_program(format_t from, const char* filename, program_t* pgm)
+{
+    switch (from) {
+    case FORMAT_TXT:
+        return program_read(filename, pgm);
+    case FORMAT_BIN:
+        return program_read_bin(filename, pgm);
+    default:
+        return program_read_packed(filename, pgm);
+    }
+}
+
+// ======================================================================
+static int write_program(format_t to, const char* filename, const program_t* pgm)
+{
+    if (to == FORMAT_BIN) return program_write_bin(filename, pgm);
+
+    if (to == FORMAT_PACK) {
+        packed_program_t packed;
+        int err = packed_program_pack(pgm, &packed);
+        if (err == ERR_NONE) {
+            err = packed_program_write(filename, &packed);
+            (void)packed_program_free(&packed);
+        }
+        return err;
+    }
+
+    FILE* output = fopen(filename, "w");
+    if (output == NULL) return ERR_IO;
+    const int err = program_print(output, pgm);
+    fclose(output);
+    return err;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        error(argv[0], "please provide conversion, input and output filenames:");
+        return 1;
+    }
+
+    const char* sep = strchr(argv[1], '2');
+    const format_t from = sep == NULL ? FORMAT_UNKNOWN : parse_format(argv[1], (size_t) (sep - argv[1]));
+    const format_t to = sep == NULL ? FORMAT_UNKNOWN : parse_format(sep + 1, strlen(sep + 1));
+    if (from == FORMAT_UNKNOWN || to == FORMAT_UNKNOWN) {
+        error(argv[0], "unknown conversion.");
+        return 1;
+    }
+
+    program_t pgm;
+    int err = read_program(from, argv[2], &pgm);
+    if (err != ERR_NONE) {
+        error(argv[0], "problem reading program from provided file.");
+        return 2;
+    }
+
+    err = write_program(to, argv[3], &pgm);
+    (void)program_free(&pgm);
+
+    if (err != ERR_NONE) {
+        error(argv[0], "problem writing program to provided file.");
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * @file diff-memory.c
+ * @brief Compares two memories page by page, and tells where they differ
+ *
+ * Both memories are compared page by page with memcmp() (half of the pages in a second
+ * thread), and only the differing pages are compared word by word. The last page may
+ * be partial (when the size of the memories is not a multiple of PAGE_SIZE). Differences
+ * are given by physical address, and by virtual address through the page tables of the
+ * first memory.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "rmap.h"
+#include "addr.h"
+
+#include <stdio.h>
+#include <stdlib.h> // calloc()
+#include <string.h>
+#include <inttypes.h> // for PRIX32, PRIX64
+#include <assert.h>
+#include <pthread.h>
+
+typedef struct {
+    const uint8_t* mem1;
+    const uint8_t* mem2;
+    size_t size; // number of bytes compared (the last page may be partial)
+    size_t first_page;
+    size_t nb_pages;
+    uint8_t* differs; // one flag per page of the memories
+} compare_job_t;
+
+static const char* const level_names[] = { "PGD", "PUD", "PMD", "PTE" };
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-q] (dump|desc|image) mem_filename (dump|desc|image) mem_filename\n", pgm);
+    fprintf(stderr, "          (-q only lists the differing pages, not their words;\n");
+    fprintf(stderr, "           exits with 0 if the memories are the same, 1 if they differ, 2 on error)\n");
+    fprintf(stderr, "examples: %s dump reference.mem dump result.mem\n", pgm);
+    fprintf(stderr, "          %s -q desc memory_description.txt dump result.mem\n", pgm);
+}
+
+// ======================================================================
+static int load(const char* format, const char* filename, void** memory, size_t* size)
+{
+    if (!strcmp(format, "dump")) return mem_init_from_dumpfile_mapped(filename, memory, size);
+    if (!strcmp(format, "desc")) return mem_init_from_description(filename, memory, size);
+    if (!strcmp(format, "image")) return mem_init_from_image(filename, NULL, memory, size);
+    return ERR_BAD_PARAMETER;
+}
+
+// ======================================================================
+/**
+ * @brief Flags the differing pages of a range of pages (may be run in its own thread).
+ */
+static void* compare_pages(void* arg)
+{
+    compare_job_t* job = arg;
+    for (size_t page = job->first_page; page < job->first_page + job->nb_pages; ++page) {
+        const size_t offset = page * PAGE_SIZE;
+        const size_t size = job->size - offset < PAGE_SIZE ? job->size - offset : PAGE_SIZE;
+        job->differs[page] = memcmp(job->mem1 + offset, job->mem2 + offset, size) != 0;
+    }
+    return NULL;
+}
+
+// ======================================================================
+/**
+ * @brief The i-th word of a (possibly partial) page, padded with zeros past its end.
+ */
+static word_t word_at(const uint8_t* page, size_t size, size_t i)
+{
+    word_t word = 0;
+    const size_t offset = i * sizeof(word_t);
+    memcpy(&word, page + offset, size - offset < sizeof(word_t) ? size - offset : sizeof(word_t));
+    return word;
+}
+
+// ======================================================================
+/**
+ * @brief Prints the differing page at paddr, and its differing words unless quiet.
+ * @param size the number of bytes of the page (less than PAGE_SIZE for a last, partial page)
+ * @return the number of differing words
+ */
+static size_t page_report(const rmap_t* rmap, const uint8_t* page1, const uint8_t* page2,
+                          uint32_t paddr, size_t size, int quiet)
+{
+    const size_t nb_page_words = (size + sizeof(word_t) - 1) / sizeof(word_t);
+    size_t nb_words = 0;
+    for (size_t i = 0; i < nb_page_words; ++i) {
+        nb_words += word_at(page1, size, i) != word_at(page2, size, i);
+    }
+
+    const rmap_record_t* first = rmap_first(rmap, paddr);
+    printf("page 0x%08" PRIX32 " (", paddr);
+    if (first == NULL) printf("unmapped");
+    rmap_for_each(rmap, paddr, record) {
+        if (record != first) printf(", ");
+        if (record->level == DATA_LEVEL) printf("0x%016" PRIX64, record->vaddr64);
+        else printf("%s", level_names[record->level]);
+    }
+    printf("): %zu words differ\n", nb_words);
+
+    if (!quiet) {
+        for (size_t i = 0; i < nb_page_words; ++i) {
+            const word_t w1 = word_at(page1, size, i);
+            const word_t w2 = word_at(page2, size, i);
+            if (w1 == w2) continue;
+            const uint32_t offset = (uint32_t) (i * sizeof(word_t));
+            printf("    0x%08" PRIX32, paddr + offset);
+            if (first != NULL && first->level == DATA_LEVEL) printf(" (0x%016" PRIX64 ")", first->vaddr64 + offset);
+            printf(": 0x%08" PRIX32 " 0x%08" PRIX32 "\n", w1, w2);
+        }
+    }
+    return nb_words;
+}
+
+// ======================================================================
+static int compare(const void* mem1, size_t size1, const void* mem2, size_t size2, int quiet, int* differ)
+{
+    const size_t size = size1 < size2 ? size1 : size2;
+    const size_t nb_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint8_t* differs = calloc(nb_pages + 1, sizeof(uint8_t));
+    M_EXIT_IF_NULL(differs, (nb_pages + 1) * sizeof(uint8_t));
+
+    // both halves of the memories are compared at the same time
+    compare_job_t jobs[2] = {
+        { mem1, mem2, size, 0, nb_pages / 2, differs },
+        { mem1, mem2, size, nb_pages / 2, nb_pages - nb_pages / 2, differs }
+    };
+    pthread_t helper;
+    const int threaded = pthread_create(&helper, NULL, compare_pages, &jobs[1]) == 0;
+    compare_pages(&jobs[0]);
+    if (threaded) pthread_join(helper, NULL);
+    else compare_pages(&jobs[1]);
+
+    // the page tables of the first memory give the virtual addresses
+    rmap_t rmap;
+    const int mapped = rmap_init(&rmap, (void*) mem1, size1) == ERR_NONE;
+    if (!mapped) {
+        fprintf(stderr, "WARNING: invalid page tables, virtual addresses are not known\n");
+    }
+
+    size_t nb_differing = 0;
+    size_t nb_words = 0;
+    for (size_t page = 0; page < nb_pages; ++page) {
+        if (!differs[page]) continue;
+        const size_t offset = page * PAGE_SIZE;
+        const uint8_t* page1 = (const uint8_t*) mem1 + offset;
+        const uint8_t* page2 = (const uint8_t*) mem2 + offset;
+        const size_t page_size = size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE;
+        nb_words += page_report(mapped ? &rmap : NULL, page1, page2, (uint32_t) offset, page_size, quiet);
+        ++nb_differing;
+    }
+    if (size1 != size2) {
+        printf("sizes differ: %zu %zu\n", size1, size2);
+    }
+    printf("pages: %zu, differing: %zu, words: %zu\n", nb_pages, nb_differing, nb_words);
+
+    if (mapped) rmap_free(&rmap);
+    free(differs);
+    *differ = nb_differing != 0 || size1 != size2;
+    return ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    const char* pgm_name = argv[0];
+    int quiet = 0;
+    if (argc > 1 && !strcmp(argv[1], "-q")) {
+        quiet = 1;
+        ++argv;
+        --argc;
+    }
+    if (argc != 5) {
+        error(pgm_name, "please provide the format and the file of both memories:");
+        return 2;
+    }
+
+    void* mem1 = NULL;
+    size_t size1 = 0;
+    if (load(argv[1], argv[2], &mem1, &size1) != ERR_NONE) {
+        error(pgm_name, "cannot read first memory.");
+        return 2;
+    }
+    void* mem2 = NULL;
+    size_t size2 = 0;
+    if (load(argv[3], argv[4], &mem2, &size2) != ERR_NONE) {
+        error(pgm_name, "cannot read second memory.");
+        mem_release(mem1, size1);
+        return 2;
+    }
+
+    int differ = 0;
+    const int err = compare(mem1, size1, mem2, size2, quiet, &differ);
+    if (err != ERR_NONE) fprintf(stderr, "ERROR: comparison failed: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+
+    mem_release(mem2, size2);
+    mem_release(mem1, size1);
+    return err != ERR_NONE ? 2 : differ;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file dump-commands.c
+ * @brief Dumps a program of any format (text, binary or packed) in the canonical text format
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "commands.h"
+#include "command_stream.h"
+
+#include <stdio.h>
+#include <assert.h>
+
+#define DUMP_BUFFER_SIZE (256 * 1024)
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s input_filename [output_filename]\n", pgm);
+    fprintf(stderr, "          (standard output is used if no output filename is given)\n");
+    fprintf(stderr, "examples: %s commands01.bin\n", pgm);
+    fprintf(stderr, "          %s commands01.pack commands01.txt\n", pgm);
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        error(argv[0], "please provide an input filename:");
+        return 1;
+    }
+
+    command_stream_t stream;
+    if (command_stream_open(argv[1], &stream) != ERR_NONE) {
+        error(argv[0], "cannot open provided input file.");
+        return 2;
+    }
+
+    FILE* output = argc < 3 ? stdout : fopen(argv[2], "w");
+    if (output == NULL) {
+        (void)command_stream_close(&stream);
+        error(argv[0], "cannot open provided output file.");
+        return 3;
+    }
+
+    // lines are rendered in a buffer, written out once (almost) full
+    static char buffer[DUMP_BUFFER_SIZE];
+    size_t used = 0;
+    int write_ok = 1;
+    for_all_stream_lines(line, &stream) {
+        used += command_format(buffer + used, &line);
+        if (used > DUMP_BUFFER_SIZE - MAX_PRINTED_COMMAND_LENGTH) {
+            write_ok = write_ok && fwrite(buffer, 1, used, output) == used;
+            used = 0;
+        }
+    }
+    write_ok = write_ok && fwrite(buffer, 1, used, output) == used;
+
+    const int read_err = command_stream_status(&stream);
+    const size_t nb_read = stream.nb_read;
+    (void)command_stream_close(&stream);
+    write_ok = (output == stdout ? fflush(output) : fclose(output)) == 0 && write_ok;
+
+    if (read_err != ERR_NONE) {
+        fprintf(stderr, "ERROR: invalid command after line %zu of \"%s\": %s\n",
+                nb_read, argv[1], ERR_MESSAGES[read_err - ERR_NONE]);
+        return 4;
+    }
+    if (!write_ok) {
+        error(argv[0], "problem writing program to provided output.");
+        return 5;
+    }
+    return 0;
+}
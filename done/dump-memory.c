@@ -0,0 +1,99 @@
+/**
+ * @file dump-memory.c
+ * @brief Dumps a whole memory, or some of its virtual pages, in hexadecimal or raw
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+#include "mem_dump.h"
+#include "addr_mng.h"
+
+#include <stdio.h>
+#include <stdlib.h> // malloc()
+#include <string.h>
+#include <inttypes.h> // for SCNx64
+#include <assert.h>
+#include <unistd.h> // STDOUT_FILENO
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-r] (dump|desc|image) mem_filename [vaddr [nb_pages]]\n", pgm);
+    fprintf(stderr, "          (the whole physical memory if no virtual address is given;\n");
+    fprintf(stderr, "           -r writes the bytes as they are instead of in hexadecimal)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin > memory.hex\n", pgm);
+    fprintf(stderr, "          %s -r desc memory_description.txt 0x7f000 16 > pages.bin\n", pgm);
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    const char* pgm_name = argv[0];
+    mem_dump_mode_t mode = MEM_DUMP_HEX;
+    if (argc > 1 && !strcmp(argv[1], "-r")) {
+        mode = MEM_DUMP_RAW;
+        ++argv;
+        --argc;
+    }
+
+    if (argc < 3 || argc > 5) {
+        error(pgm_name, "please provide memory format and memory file:");
+        return 1;
+    }
+    enum { DUMP, DESC, IMAGE } format = DUMP;
+    if (!strcmp(argv[1], "desc")) {
+        format = DESC;
+    } else if (!strcmp(argv[1], "image")) {
+        format = IMAGE;
+    } else if (strcmp(argv[1], "dump")) {
+        error(pgm_name, "unknown command.");
+        return 1;
+    }
+
+    virt_addr_t vaddr;
+    size_t nb_pages = 1;
+    if (argc > 3) {
+        uint64_t vaddr64 = 0;
+        if (sscanf(argv[3], "%" SCNx64, &vaddr64) != 1 || init_virt_addr64(&vaddr, vaddr64) != ERR_NONE) {
+            error(pgm_name, "invalid virtual address.");
+            return 1;
+        }
+        if (argc > 4 && (sscanf(argv[4], "%zu", &nb_pages) != 1 || argv[4][0] == '-')) {
+            error(pgm_name, "invalid number of pages.");
+            return 1;
+        }
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = format == DUMP ? mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size)
+              : format == DESC ? mem_init_from_description(argv[2], &mem_space, &mem_size)
+              : mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(pgm_name, "cannot read memory.");
+        return 1;
+    }
+
+    mem_dumper_t* dumper = malloc(sizeof(mem_dumper_t));
+    if (dumper == NULL) {
+        error(pgm_name, "cannot allocate dumper.");
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+    err = mem_dumper_init_fd(dumper, STDOUT_FILENO, mem_space, mem_size, mode, OFFSET, 16, " ");
+    if (err == ERR_NONE) {
+        err = argc > 3 ? mem_dump_vpages(dumper, &vaddr, nb_pages) : mem_dump_physical(dumper, 0, mem_size);
+    }
+    if (err == ERR_NONE) err = mem_dumper_flush(dumper);
+    if (err != ERR_NONE) fprintf(stderr, "ERROR: dump failed: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+
+    free(dumper);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file filter-l1.c
+ * @brief Shrinks a program to what reaches the L2 cache, and replays it on a L2 cache
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "commands.h"
+#include "command_stream.h"
+#include "memory.h"
+#include "cache_mng.h"
+#include "l1_filter.h"
+
+#include <stdio.h>
+#include <stdlib.h> // calloc()
+#include <string.h>
+#include <inttypes.h> // for PRIu64
+#include <assert.h>
+
+#define EVENT_BUFFER_SIZE 4096 // number of events written at once
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (dump|desc) mem_filename command_filename events_filename\n", pgm);
+    fprintf(stderr, "          %s replay events_filename\n", pgm);
+    fprintf(stderr, "examples: %s dump memory_dump.bin commands01.txt commands01.l1ev\n", pgm);
+    fprintf(stderr, "          %s replay commands01.l1ev\n", pgm);
+}
+
+// ======================================================================
+/**
+ * @brief Runs a whole program through the L1 caches and writes the events to a file.
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int filter(l1_filter_t* filter, command_stream_t* stream, FILE* output)
+{
+    l1_events_header_t header;
+    l1_events_header_init(&header, filter, 0); // rewritten at the end
+    M_REQUIRE(fwrite(&header, sizeof(header), 1, output) == 1, ERR_IO, "%s", "Cannot write header");
+
+    l1_event_t buffer[EVENT_BUFFER_SIZE];
+    size_t nb_buffered = 0;
+    uint64_t nb_events = 0;
+    for_all_stream_lines(line, stream) {
+        int missed = 0;
+        M_EXIT_IF_ERR(l1_filter_command(filter, &line, &buffer[nb_buffered], &missed), "Error filtering command");
+        if (missed && ++nb_buffered == EVENT_BUFFER_SIZE) {
+            M_REQUIRE(fwrite(buffer, sizeof(l1_event_t), nb_buffered, output) == nb_buffered,
+                      ERR_IO, "%s", "Cannot write events");
+            nb_events += nb_buffered;
+            nb_buffered = 0;
+        }
+    }
+    M_EXIT_IF_ERR(command_stream_status(stream), "Error reading program");
+    M_REQUIRE(fwrite(buffer, sizeof(l1_event_t), nb_buffered, output) == nb_buffered,
+              ERR_IO, "%s", "Cannot write events");
+    nb_events += nb_buffered;
+
+    l1_events_header_init(&header, filter, nb_events);
+    M_REQUIRE(fseek(output, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, output) == 1,
+              ERR_IO, "%s", "Cannot write header");
+
+    printf("commands: %" PRIu64 "\n", filter->nb_commands);
+    printf("filtered L1 hits: %" PRIu64 "\n", filter->nb_commands - nb_events);
+    printf("events: %" PRIu64 "\n", nb_events);
+    return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Replays events on a (flushed) L2 cache and prints what happened.
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int replay(const l1_events_t* events)
+{
+    l2_cache_entry_t* l2_cache = calloc(L2_CACHE_LINES * L2_CACHE_WAYS, sizeof(l2_cache_entry_t));
+    M_EXIT_IF_NULL(l2_cache, L2_CACHE_LINES * L2_CACHE_WAYS * sizeof(l2_cache_entry_t));
+    cache_flush(l2_cache, L2_CACHE);
+
+    uint64_t nb_hits = 0;
+    for (size_t i = 0; i < events->nb_events; ++i) {
+        int hit = 0;
+        const int err = l1_event_replay(l2_cache, &events->events[i], &hit);
+        if (err != ERR_NONE) {
+            free(l2_cache);
+            return err;
+        }
+        nb_hits += hit != 0;
+    }
+    free(l2_cache);
+
+    const l1_events_header_t* header = events->header;
+    const uint64_t nb_misses = events->nb_events - nb_hits;
+    printf("commands: %" PRIu64 "\n", header->nb_commands);
+    printf("filtered L1 hits: %" PRIu64 " (instruction reads: %" PRIu64 ", data reads: %" PRIu64
+           ", data writes: %" PRIu64 ")\n",
+           header->nb_filtered[INSTRUCTION][READ] + header->nb_filtered[DATA][READ]
+           + header->nb_filtered[DATA][WRITE],
+           header->nb_filtered[INSTRUCTION][READ], header->nb_filtered[DATA][READ],
+           header->nb_filtered[DATA][WRITE]);
+    printf("L2 accesses: %zu\n", events->nb_events);
+    printf("L2 hits: %" PRIu64 "\n", nb_hits);
+    printf("L2 misses: %" PRIu64 " (%.6f per command)\n", nb_misses,
+           header->nb_commands == 0 ? 0.0 : (double) nb_misses / (double) header->nb_commands);
+    return ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && !strcmp(argv[1], "replay")) {
+        l1_events_t events;
+        if (l1_events_map(argv[2], &events) != ERR_NONE) {
+            error(argv[0], "cannot read events.");
+            return 1;
+        }
+        const int err = replay(&events);
+        l1_events_unmap(&events);
+        return err == ERR_NONE ? 0 : 1;
+    }
+
+    if (argc < 5) {
+        error(argv[0], "please provide memory format, memory file, program file and events file:");
+        return 1;
+    }
+    int dump = 1;
+    if (strcmp(argv[1], "dump")) {
+        if (strcmp(argv[1], "desc")) {
+            error(argv[0], "unknown command.");
+            return 1;
+        }
+        dump = 0;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = dump ? mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size)
+                   : mem_init_from_description(argv[2], &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(argv[0], "cannot read memory.");
+        return 1;
+    }
+
+    command_stream_t pgm;
+    if (command_stream_open(argv[3], &pgm) != ERR_NONE) {
+        error(argv[0], "cannot open program.");
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+
+    l1_filter_t* l1 = calloc(1, sizeof(l1_filter_t));
+    FILE* output = fopen(argv[4], "wb");
+    if (l1 == NULL || output == NULL) {
+        error(argv[0], l1 == NULL ? "cannot allocate filter." : "cannot open events file.");
+        err = ERR_IO;
+    } else {
+        err = l1_filter_init(l1, mem_space);
+        if (err == ERR_NONE) err = filter(l1, &pgm, output);
+    }
+    if (output != NULL && fclose(output) != 0 && err == ERR_NONE) err = ERR_IO;
+
+    command_stream_close(&pgm);
+    free(l1);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
@@ -0,0 +1,533 @@
+/**
+ * @file gen-workload.c
+ * @brief Generates synthetic programs (access patterns) together with a matching memory
+ *
+ * The generated directory holds:
+ *  - the program, in text, binary or packed format (commands.txt/.bin/.pack);
+ *  - a memory description (memory-desc.txt) and its page files (pages/), in
+ *    the format read by mem_init_from_description();
+ *  - the same memory as one single dump (memory.mem), as read by mem_init_from_dumpfile().
+ * Page tables are built so that every generated address can be translated (the data
+ * may be mapped with large pages, see -P).
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for getopt(), mkdir()
+
+#include "error.h"
+#include "addr.h"
+#include "addr_mng.h"
+#include "commands.h"
+#include "commands_bin.h"
+#include "commands_packed.h"
+#include "memory.h"
+#include "page_walk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h> // pow(), exp(), log()
+#include <inttypes.h> // PRIX macros
+#include <unistd.h> // getopt()
+#include <sys/stat.h> // mkdir()
+#include <assert.h>
+
+#define CODE_BASE 0x0000000000000000ull // virtual address of the code (instructions)
+#define DATA_BASE 0x0000000040000000ull // virtual address of the data
+#define MAX_VIRT_ADDR (1ull << (VIRT_ADDR - VIRT_ADDR_RES))
+#define MAX_PHY_SIZE (1ull << PHY_ADDR)
+
+#define DEFAULT_FOOTPRINT (1u << 20)
+#define DEFAULT_CODE_FOOTPRINT (64u << 10)
+#define DEFAULT_STRIDE 64u
+#define DEFAULT_WRITE_RATIO 0.2
+#define DEFAULT_INSTR_RATIO 0.6
+#define DEFAULT_ZIPF 0.99
+
+#define BLOCK_SIZE 64u // granularity of Zipf-popular blocks and of pointer-chasing nodes
+#define JUMP_PROBABILITY 0.125 // for instructions: one jump every 8 instructions on average
+#define SCATTER_PRIME 2654435761ull // to spread Zipf ranks over the footprint
+
+#define OUT_BUFFER_SIZE (256 * 1024)
+#define MAX_PATH_LENGTH 127 // memory descriptions are read with 128-chars filenames
+
+typedef enum {
+    PATTERN_SEQ,
+    PATTERN_STRIDE,
+    PATTERN_UNIFORM,
+    PATTERN_ZIPF,
+    PATTERN_CHASE,
+    PATTERN_MIXED,
+    PATTERN_UNKNOWN
+} pattern_t;
+
+static const char* const PATTERN_NAMES[] = { "seq", "stride", "uniform", "zipf", "chase", "mixed" };
+
+typedef enum {
+    FORMAT_TXT,
+    FORMAT_BIN,
+    FORMAT_PACK,
+    FORMAT_UNKNOWN
+} format_t;
+
+static const char* const FORMAT_NAMES[] = { "txt", "bin", "pack" };
+
+static const char* const PAGE_SIZE_NAMES[] = { "4k", "2m", "1g" }; // indexed by page_size_t
+#define PAGE_SIZE_UNKNOWN 3
+
+typedef struct {
+    pattern_t pattern;
+    size_t nb_commands;
+    const char* out_dir;
+    format_t format;
+    int page_size; // page_size_t of the data pages (PAGE_SIZE_UNKNOWN if invalid)
+    uint64_t footprint; // of the data, in bytes
+    uint64_t code_footprint; // of the instructions, in bytes (mixed pattern only)
+    uint64_t stride; // in bytes
+    double write_ratio; // fraction of data accesses that are writes
+    double byte_ratio; // fraction of data accesses on bytes (words otherwise)
+    double instr_ratio; // fraction of instruction fetches (mixed pattern only)
+    double zipf; // exponent of the Zipf distribution
+    uint64_t seed;
+} options_t;
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [options] (seq|stride|uniform|zipf|chase|mixed) nb_commands output_dir\n", pgm);
+    fprintf(stderr, "options:  -f data footprint in bytes (default %u)\n", DEFAULT_FOOTPRINT);
+    fprintf(stderr, "          -c code footprint in bytes, for mixed (default %u)\n", DEFAULT_CODE_FOOTPRINT);
+    fprintf(stderr, "          -S stride in bytes, for stride (default %u)\n", DEFAULT_STRIDE);
+    fprintf(stderr, "          -w fraction of writes among data accesses (default %g)\n", DEFAULT_WRITE_RATIO);
+    fprintf(stderr, "          -b fraction of byte accesses among data accesses (default 0)\n");
+    fprintf(stderr, "          -i fraction of instruction fetches, for mixed (default %g)\n", DEFAULT_INSTR_RATIO);
+    fprintf(stderr, "          -z Zipf exponent, for zipf (default %g)\n", DEFAULT_ZIPF);
+    fprintf(stderr, "          -s random seed (default 1)\n");
+    fprintf(stderr, "          -o output format: txt, bin or pack (default txt)\n");
+    fprintf(stderr, "          -P size of the data pages: 4k, 2m or 1g (default 4k)\n");
+    fprintf(stderr, "examples: %s -f 4194304 -w 0.3 zipf 1000000 work/zipf\n", pgm);
+    fprintf(stderr, "          %s -f 67108864 -P 2m uniform 1000000 work/huge\n", pgm);
+    fprintf(stderr, "          %s -o pack mixed 100000000 work/mixed\n", pgm);
+}
+
+// ======================================================================
+// xorshift64* pseudo-random generator: fast and reproducible across platforms
+static uint64_t rng_state = 1;
+
+static void rng_seed(uint64_t seed)
+{
+    rng_state = seed != 0 ? seed : 1;
+}
+
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static double rng_uniform(void) // in [0, 1)
+{
+    return (double) (rng_next() >> 11) / (double) (1ull << 53);
+}
+
+static uint64_t rng_below(uint64_t n) // in [0, n)
+{
+    return n == 0 ? 0 : rng_next() % n;
+}
+
+// ======================================================================
+/**
+ * @brief Translates an address of a page mapped in the memory under construction
+ */
+static word_t* word_at(const mem_builder_t* builder, uint64_t vaddr)
+{
+    virt_addr_t virt;
+    phy_addr_t phy;
+    if (init_virt_addr64(&virt, vaddr) != ERR_NONE || page_walk(builder->memory, &virt, &phy) != ERR_NONE) return NULL;
+    return (word_t*) builder->memory + (phy_addr_t_to_uint32_t(&phy) >> BYTE_SEL_BITS);
+}
+
+// ======================================================================
+/* Where the commands go: rendered in a buffer (text and binary formats)
+ * or appended to a packed program. */
+typedef struct {
+    format_t format;
+    FILE* output;
+    char* buffer;
+    size_t used;
+    packed_program_t packed;
+} sink_t;
+
+static int sink_flush(sink_t* sink)
+{
+    M_REQUIRE(fwrite(sink->buffer, 1, sink->used, sink->output) == sink->used, ERR_IO, "%s", "cannot write program");
+    sink->used = 0;
+    return ERR_NONE;
+}
+
+static int sink_put(sink_t* sink, const command_t* command)
+{
+    switch (sink->format) {
+    case FORMAT_TXT:
+        sink->used += command_format(sink->buffer + sink->used, command);
+        break;
+    case FORMAT_BIN:
+        command_bin_encode(command, (command_bin_t*) (sink->buffer + sink->used));
+        sink->used += sizeof(command_bin_t);
+        break;
+    default:
+        return packed_program_add_command(&sink->packed, command);
+    }
+
+    if (sink->used > OUT_BUFFER_SIZE - MAX_PRINTED_COMMAND_LENGTH) return sink_flush(sink);
+    return ERR_NONE;
+}
+
+// ======================================================================
+typedef struct {
+    const options_t* options;
+    uint64_t offset; // data offset of the last access (seq, stride)
+    uint64_t pc; // code offset of the next instruction (mixed)
+    uint32_t* next_node; // pointer-chasing cycle (chase)
+    uint64_t node; // current node (chase)
+    uint64_t nb_blocks; // number of blocks in the footprint
+} generator_t;
+
+/**
+ * @brief Builds a random single cycle over all the blocks (Sattolo's algorithm)
+ */
+static int chase_init(generator_t* gen)
+{
+    M_REQUIRE(gen->nb_blocks <= UINT32_MAX, ERR_BAD_PARAMETER, "%s", "footprint too large to chase pointers");
+    gen->next_node = calloc(gen->nb_blocks, sizeof(uint32_t));
+    M_EXIT_IF_NULL(gen->next_node, gen->nb_blocks * sizeof(uint32_t));
+
+    uint32_t* order = calloc(gen->nb_blocks, sizeof(uint32_t));
+    M_EXIT_IF_NULL(order, gen->nb_blocks * sizeof(uint32_t));
+    for (uint64_t i = 0; i < gen->nb_blocks; ++i) order[i] = (uint32_t) i;
+    for (uint64_t i = gen->nb_blocks - 1; i > 0; --i) {
+        const uint64_t j = rng_below(i);
+        const uint32_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (uint64_t i = 0; i < gen->nb_blocks; ++i) {
+        gen->next_node[order[i]] = order[(i + 1) % gen->nb_blocks];
+    }
+    free(order);
+
+    return ERR_NONE;
+}
+
+/**
+ * @brief Draws a rank in [0, n) following (approximately) a Zipf law of exponent s,
+ * by inverting the CDF of the continuous power law
+ */
+static uint64_t zipf_rank(uint64_t n, double s)
+{
+    const double u = rng_uniform();
+    double x;
+    if (fabs(s - 1.0) < 1e-9) {
+        x = exp(u * log((double) n + 1.0));
+    } else {
+        x = pow(u * (pow((double) n + 1.0, 1.0 - s) - 1.0) + 1.0, 1.0 / (1.0 - s));
+    }
+    const uint64_t rank = (uint64_t) x - 1;
+    return rank < n ? rank : n - 1;
+}
+
+/**
+ * @brief Offset (in the data footprint) of the next data access, word aligned
+ */
+static uint64_t next_data_offset(generator_t* gen)
+{
+    const options_t* opt = gen->options;
+    switch (opt->pattern) {
+    case PATTERN_SEQ:
+        gen->offset = (gen->offset + sizeof(word_t)) % opt->footprint;
+        return gen->offset;
+    case PATTERN_STRIDE:
+        gen->offset = (gen->offset + opt->stride) % opt->footprint;
+        return gen->offset & ~(uint64_t) BYTE_SEL_MASK;
+    case PATTERN_ZIPF: {
+        const uint64_t block = (zipf_rank(gen->nb_blocks, opt->zipf) * SCATTER_PRIME) % gen->nb_blocks;
+        return block * BLOCK_SIZE + rng_below(BLOCK_SIZE / sizeof(word_t)) * sizeof(word_t);
+    }
+    case PATTERN_CHASE:
+        gen->node = gen->next_node[gen->node];
+        return gen->node * BLOCK_SIZE;
+    default: // uniform, and data of mixed
+        return rng_below(opt->footprint / sizeof(word_t)) * sizeof(word_t);
+    }
+}
+
+static int next_command(generator_t* gen, command_t* command)
+{
+    const options_t* opt = gen->options;
+    memset(command, 0, sizeof(*command));
+
+    if (opt->pattern == PATTERN_MIXED && rng_uniform() < opt->instr_ratio) {
+        command->order = READ;
+        command->type = INSTRUCTION;
+        command->data_size = sizeof(word_t);
+        const uint64_t vaddr = CODE_BASE + gen->pc;
+        gen->pc = rng_uniform() < JUMP_PROBABILITY
+                  ? rng_below(opt->code_footprint / sizeof(word_t)) * sizeof(word_t)
+                  : (gen->pc + sizeof(word_t)) % opt->code_footprint;
+        return init_virt_addr64(&command->vaddr, vaddr);
+    }
+
+    uint64_t offset = next_data_offset(gen);
+    command->type = DATA;
+    command->order = opt->pattern != PATTERN_CHASE && rng_uniform() < opt->write_ratio ? WRITE : READ;
+    command->data_size = sizeof(word_t);
+    if (opt->pattern != PATTERN_CHASE && rng_uniform() < opt->byte_ratio) {
+        command->data_size = sizeof(byte_t);
+        offset += rng_below(sizeof(word_t));
+    }
+    if (command->order == WRITE) {
+        command->write_data = (word_t) rng_next() & (command->data_size == sizeof(byte_t) ? 0xFFu : 0xFFFFFFFFu);
+    }
+    return init_virt_addr64(&command->vaddr, DATA_BASE + offset);
+}
+
+// ======================================================================
+static int write_page_file(const char* filename, const byte_t* page)
+{
+    FILE* file = fopen(filename, "wb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(file, ERR_IO);
+    const size_t written = fwrite(page, 1, PAGE_SIZE, file);
+    M_REQUIRE(fclose(file) == 0 && written == PAGE_SIZE, ERR_IO, "cannot write %s", filename);
+    return ERR_NONE;
+}
+
+static int page_filename(char* filename, const char* dir, const char* kind, uint64_t id)
+{
+    const int len = snprintf(filename, MAX_PATH_LENGTH + 1, "%s/pages/%s_%" PRIX64 ".bin", dir, kind, id);
+    M_REQUIRE(len > 0 && len <= MAX_PATH_LENGTH, ERR_BAD_PARAMETER, "%s", "output directory name is too long");
+    return ERR_NONE;
+}
+
+/**
+ * @brief Writes the memory description, its page files and the memory dump
+ */
+static int write_memory(const mem_builder_t* builder, const char* dir)
+{
+    char filename[MAX_PATH_LENGTH + 1];
+    const byte_t* mem = builder->memory;
+    const size_t mem_size = builder->nb_frames * PAGE_SIZE;
+
+    // memory dump
+    snprintf(filename, sizeof(filename), "%s/memory.mem", dir);
+    FILE* dump = fopen(filename, "wb");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(dump, ERR_IO);
+    const size_t written = fwrite(mem, 1, mem_size, dump);
+    M_REQUIRE(fclose(dump) == 0 && written == mem_size, ERR_IO, "cannot write %s", filename);
+
+    // description
+    snprintf(filename, sizeof(filename), "%s/pages", dir);
+    M_REQUIRE(mkdir(filename, 0777) == 0 || errno == EEXIST, ERR_IO, "cannot create %s", filename);
+
+    snprintf(filename, sizeof(filename), "%s/memory-desc.txt", dir);
+    FILE* desc = fopen(filename, "w");
+    M_REQUIRE_NON_NULL_CUSTOM_ERR(desc, ERR_IO);
+
+    error_code err = page_filename(filename, dir, "pgd", 0);
+    if (err == ERR_NONE) err = write_page_file(filename, mem);
+    fprintf(desc, "%zu\n%s\n%zu\n", mem_size, filename, builder->nb_tables);
+
+    for (size_t i = 0; err == ERR_NONE && i < builder->nb_tables; ++i) {
+        err = page_filename(filename, dir, "table", builder->tables[i]);
+        if (err == ERR_NONE) err = write_page_file(filename, mem + builder->tables[i]);
+        fprintf(desc, "0x%08" PRIX32 " %s\n", builder->tables[i], filename);
+    }
+    for (size_t i = 0; err == ERR_NONE && i < builder->nb_data; ++i) {
+        err = page_filename(filename, dir, "data", builder->data_vaddr[i]);
+        if (err == ERR_NONE) err = write_page_file(filename, mem + builder->data_paddr[i]);
+        fprintf(desc, "0x%016" PRIX64 " %s\n", builder->data_vaddr[i], filename);
+    }
+
+    M_REQUIRE(fclose(desc) == 0, ERR_IO, "%s", "cannot write memory description");
+    return err;
+}
+
+/**
+ * @brief Maps the footprints and fills the data pages: with the pointer-chasing
+ * cycle for chase, with a value derived from the address otherwise
+ */
+static int build_memory(mem_builder_t* builder, generator_t* gen)
+{
+    const options_t* opt = gen->options;
+
+    if (opt->pattern == PATTERN_MIXED) {
+        M_EXIT_IF_ERR(mem_map_range(builder, CODE_BASE, opt->code_footprint), "mapping code");
+    }
+    M_EXIT_IF_ERR(mem_map_range_sized(builder, DATA_BASE, opt->footprint, (page_size_t) opt->page_size), "mapping data");
+
+    for (size_t i = 0; i < builder->nb_data; ++i) {
+        word_t* page = (word_t*) ((byte_t*) builder->memory + builder->data_paddr[i]);
+        for (size_t w = 0; w < PAGE_SIZE / sizeof(word_t); ++w) {
+            page[w] = (word_t) ((builder->data_vaddr[i] + w * sizeof(word_t)) * SCATTER_PRIME >> 16);
+        }
+    }
+
+    if (opt->pattern == PATTERN_CHASE) {
+        for (uint64_t node = 0; node < gen->nb_blocks; ++node) {
+            word_t* word = word_at(builder, DATA_BASE + node * BLOCK_SIZE);
+            M_REQUIRE(word != NULL, ERR_ADDR, "node %" PRIu64 " not mapped", node);
+            *word = (word_t) (DATA_BASE + gen->next_node[node] * BLOCK_SIZE);
+        }
+    }
+
+    return ERR_NONE;
+}
+
+static int generate(const options_t* opt)
+{
+    generator_t gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.options = opt;
+    gen.nb_blocks = opt->footprint / BLOCK_SIZE;
+    gen.offset = opt->footprint - (opt->pattern == PATTERN_STRIDE ? opt->stride % opt->footprint : sizeof(word_t));
+    if (opt->pattern == PATTERN_CHASE) M_EXIT_IF_ERR(chase_init(&gen), "building pointer chase");
+
+    mem_builder_t builder;
+    error_code err = mem_builder_init(&builder, MAX_PHY_SIZE);
+    if (err == ERR_NONE) {
+        err = build_memory(&builder, &gen);
+        if (err == ERR_NONE) err = write_memory(&builder, opt->out_dir);
+        mem_builder_free(&builder);
+    }
+    if (err != ERR_NONE) {
+        free(gen.next_node);
+        return err;
+    }
+
+    // program
+    sink_t sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.format = opt->format;
+    char filename[MAX_PATH_LENGTH + 1];
+    snprintf(filename, sizeof(filename), "%s/commands.%s", opt->out_dir, FORMAT_NAMES[opt->format]);
+
+    if (opt->format == FORMAT_PACK) {
+        err = packed_program_init(&sink.packed);
+    } else {
+        sink.output = fopen(filename, "wb");
+        sink.buffer = malloc(OUT_BUFFER_SIZE);
+        err = sink.output == NULL || sink.buffer == NULL ? ERR_IO : ERR_NONE;
+        if (err == ERR_NONE && opt->format == FORMAT_BIN) {
+            command_bin_header_t header;
+            command_bin_header_init(&header, opt->nb_commands);
+            err = fwrite(&header, sizeof(header), 1, sink.output) == 1 ? ERR_NONE : ERR_IO;
+        }
+    }
+
+    command_t command;
+    for (size_t i = 0; err == ERR_NONE && i < opt->nb_commands; ++i) {
+        err = next_command(&gen, &command);
+        if (err == ERR_NONE) err = sink_put(&sink, &command);
+    }
+
+    if (opt->format == FORMAT_PACK) {
+        if (err == ERR_NONE) err = packed_program_write(filename, &sink.packed);
+        packed_program_free(&sink.packed);
+    } else {
+        if (err == ERR_NONE) err = sink_flush(&sink);
+        if (sink.output != NULL && fclose(sink.output) != 0 && err == ERR_NONE) err = ERR_IO;
+        free(sink.buffer);
+    }
+    free(gen.next_node);
+
+    return err;
+}
+
+// ======================================================================
+static int parse_name(const char* name, const char* const names[], int nb_names)
+{
+    for (int i = 0; i < nb_names; ++i) {
+        if (!strcmp(name, names[i])) return i;
+    }
+    return nb_names;
+}
+
+static uint64_t round_to_page(uint64_t size)
+{
+    return (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+int main(int argc, char *argv[])
+{
+    options_t opt = {
+        .format = FORMAT_TXT,
+        .page_size = PAGE_4K,
+        .footprint = DEFAULT_FOOTPRINT,
+        .code_footprint = DEFAULT_CODE_FOOTPRINT,
+        .stride = DEFAULT_STRIDE,
+        .write_ratio = DEFAULT_WRITE_RATIO,
+        .byte_ratio = 0.0,
+        .instr_ratio = DEFAULT_INSTR_RATIO,
+        .zipf = DEFAULT_ZIPF,
+        .seed = 1
+    };
+
+    int c;
+    while ((c = getopt(argc, argv, "f:c:S:w:b:i:z:s:o:P:")) != -1) {
+        switch (c) {
+        case 'f': opt.footprint = strtoull(optarg, NULL, 0); break;
+        case 'c': opt.code_footprint = strtoull(optarg, NULL, 0); break;
+        case 'S': opt.stride = strtoull(optarg, NULL, 0); break;
+        case 'w': opt.write_ratio = strtod(optarg, NULL); break;
+        case 'b': opt.byte_ratio = strtod(optarg, NULL); break;
+        case 'i': opt.instr_ratio = strtod(optarg, NULL); break;
+        case 'z': opt.zipf = strtod(optarg, NULL); break;
+        case 's': opt.seed = strtoull(optarg, NULL, 0); break;
+        case 'o': opt.format = (format_t) parse_name(optarg, FORMAT_NAMES, FORMAT_UNKNOWN); break;
+        case 'P': opt.page_size = parse_name(optarg, PAGE_SIZE_NAMES, PAGE_SIZE_UNKNOWN); break;
+        default:
+            error(argv[0], "unknown option.");
+            return 1;
+        }
+    }
+
+    if (argc - optind < 3) {
+        error(argv[0], "please provide pattern, number of commands and output directory:");
+        return 1;
+    }
+    opt.pattern = (pattern_t) parse_name(argv[optind], PATTERN_NAMES, PATTERN_UNKNOWN);
+    opt.nb_commands = strtoull(argv[optind + 1], NULL, 10);
+    opt.out_dir = argv[optind + 2];
+
+    opt.footprint = round_to_page(opt.footprint);
+    opt.code_footprint = round_to_page(opt.code_footprint);
+    if (opt.pattern == PATTERN_UNKNOWN || opt.format == FORMAT_UNKNOWN || opt.page_size == PAGE_SIZE_UNKNOWN) {
+        error(argv[0], "unknown pattern, format or page size.");
+        return 1;
+    }
+    if (opt.footprint == 0 || opt.code_footprint == 0 || opt.code_footprint > DATA_BASE - CODE_BASE
+        || DATA_BASE + opt.footprint > MAX_VIRT_ADDR || opt.stride == 0) {
+        error(argv[0], "invalid footprint or stride.");
+        return 1;
+    }
+
+    if (mkdir(opt.out_dir, 0777) != 0 && errno != EEXIST) {
+        error(argv[0], "cannot create output directory.");
+        return 2;
+    }
+
+    rng_seed(opt.seed);
+    const int err = generate(&opt);
+    if (err != ERR_NONE) {
+        fprintf(stderr, "ERROR: generation failed: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+        return 3;
+    }
+    return 0;
+}
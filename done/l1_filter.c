@@ -0,0 +1,187 @@
+/**
+ * @file l1_filter.c
+ * @brief Filtering of a program through the L1 caches, and replay of what reaches L2
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for mmap()
+
+#include <stdio.h>
+#include <string.h> // memcmp(), memcpy(), memset()
+#include <fcntl.h> // open()
+#include <unistd.h> // close()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+
+#include "l1_filter.h"
+#include "cache_mng.h"
+#include "page_walk.h"
+#include "addr_mng.h"
+#include "error.h"
+
+_Static_assert(sizeof(l1_events_header_t) == 64, "unexpected event file header size");
+_Static_assert(sizeof(l1_event_t) == 12, "unexpected event record size");
+
+int l1_filter_init(l1_filter_t* filter, void* mem_space){
+	M_REQUIRE_NON_NULL(filter);
+	M_REQUIRE_NON_NULL(mem_space);
+
+	filter->mem_space = mem_space;
+	M_EXIT_IF_ERR(cache_flush(filter->l1_icache, L1_ICACHE), "Error flushing L1 instruction cache");
+	M_EXIT_IF_ERR(cache_flush(filter->l1_dcache, L1_DCACHE), "Error flushing L1 data cache");
+	M_EXIT_IF_ERR(cache_flush(filter->l2_cache, L2_CACHE), "Error flushing L2 cache");
+	filter->nb_commands = 0;
+	memset(filter->nb_filtered, 0, sizeof(filter->nb_filtered));
+	return ERR_NONE;
+}
+
+int l1_filter_command(l1_filter_t* filter, const command_t* command, l1_event_t* event, int* missed){
+	M_REQUIRE_NON_NULL(filter);
+	M_REQUIRE_NON_NULL(command);
+	M_REQUIRE_NON_NULL(event);
+	M_REQUIRE_NON_NULL(missed);
+
+	phy_addr_t paddr;
+	M_EXIT_IF_ERR(page_walk(filter->mem_space, &command->vaddr, &paddr), "Error translating address");
+
+	void* l1_cache = command->type == INSTRUCTION ? (void*) filter->l1_icache : (void*) filter->l1_dcache;
+	const cache_t l1_type = command->type == INSTRUCTION ? L1_ICACHE : L1_DCACHE;
+
+	// what happens in L1 has to be known before running the command
+	uint8_t way;
+	uint16_t index;
+	M_EXIT_IF_ERR(cache_probe(l1_cache, &paddr, &way, &index, l1_type), "Error probing L1 cache");
+	*missed = way == HIT_WAY_MISS;
+	if(*missed){
+		memset(event, 0, sizeof(*event));
+		event->line_addr = phy_addr_t_to_uint32_t(&paddr) & ~(uint32_t) (L1_DCACHE_LINE - 1);
+		event->type = (uint8_t) command->type;
+		event->order = (uint8_t) command->order;
+		int evicts = 0;
+		M_EXIT_IF_ERR(cache_victim(l1_cache, &paddr, l1_type, &event->victim_addr, &evicts), "Error finding L1 victim");
+		if(evicts) event->flags |= L1_EVENT_VICTIM;
+	}else{
+		++filter->nb_filtered[command->type][command->order];
+	}
+	++filter->nb_commands;
+
+	word_t word = 0;
+	uint8_t byte = 0;
+	if(command->order == READ){
+		if(command->data_size == sizeof(word_t)){
+			M_EXIT_IF_ERR(cache_read(filter->mem_space, &paddr, command->type, l1_cache, filter->l2_cache, &word, LRU),
+			              "Error reading word");
+		}else{
+			M_EXIT_IF_ERR(cache_read_byte(filter->mem_space, &paddr, command->type, l1_cache, filter->l2_cache, &byte, LRU),
+			              "Error reading byte");
+		}
+	}else{
+		if(command->data_size == sizeof(word_t)){
+			M_EXIT_IF_ERR(cache_write(filter->mem_space, &paddr, filter->l1_dcache, filter->l2_cache, &command->write_data, LRU),
+			              "Error writing word");
+		}else{
+			M_EXIT_IF_ERR(cache_write_byte(filter->mem_space, &paddr, filter->l1_dcache, filter->l2_cache,
+			                               (uint8_t) command->write_data, LRU),
+			              "Error writing byte");
+		}
+	}
+	return ERR_NONE;
+}
+
+int l1_events_header_init(l1_events_header_t* header, const l1_filter_t* filter, uint64_t nb_events){
+	M_REQUIRE_NON_NULL(header);
+	M_REQUIRE_NON_NULL(filter);
+
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, L1_EVENTS_MAGIC, L1_EVENTS_MAGIC_SIZE);
+	header->version = L1_EVENTS_VERSION;
+	header->record_size = sizeof(l1_event_t);
+	header->nb_events = nb_events;
+	header->nb_commands = filter->nb_commands;
+	memcpy(header->nb_filtered, filter->nb_filtered, sizeof(header->nb_filtered));
+
+	return ERR_NONE;
+}
+
+int l1_events_map(const char* filename, l1_events_t* events){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(events);
+
+	memset(events, 0, sizeof(*events));
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(l1_events_header_t)){
+		close(fd);
+		M_EXIT(ERR_IO, "%s is too small to be an event file", filename);
+	}
+
+	const size_t map_size = (size_t) st.st_size;
+	void* map_start = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference on the file
+	M_REQUIRE(map_start != MAP_FAILED, ERR_MEM, "Cannot map %s", filename);
+
+	const l1_events_header_t* header = map_start;
+	if(memcmp(header->magic, L1_EVENTS_MAGIC, L1_EVENTS_MAGIC_SIZE) != 0
+	   || header->version != L1_EVENTS_VERSION
+	   || header->record_size != sizeof(l1_event_t)
+	   || header->nb_events > (map_size - sizeof(*header)) / sizeof(l1_event_t)){
+		munmap(map_start, map_size);
+		M_EXIT(ERR_IO, "%s is not a valid event file", filename);
+	}
+
+	// events are read sequentially
+	(void)posix_madvise(map_start, map_size, POSIX_MADV_SEQUENTIAL);
+
+	events->header = header;
+	events->events = (const l1_event_t*) (header + 1);
+	events->nb_events = header->nb_events;
+	events->map_start = map_start;
+	events->map_size = map_size;
+
+	return ERR_NONE;
+}
+
+int l1_events_unmap(l1_events_t* events){
+	M_REQUIRE_NON_NULL(events);
+	M_REQUIRE_NON_NULL(events->map_start);
+
+	M_REQUIRE(munmap(events->map_start, events->map_size) == 0, ERR_MEM, "%s", "Cannot unmap events");
+	memset(events, 0, sizeof(*events));
+
+	return ERR_NONE;
+}
+
+int l1_event_replay(void* l2_cache, const l1_event_t* event, int* hit){
+	M_REQUIRE_NON_NULL(l2_cache);
+	M_REQUIRE_NON_NULL(event);
+	M_REQUIRE_NON_NULL(hit);
+
+	phy_addr_t paddr;
+	M_EXIT_IF_ERR(init_phy_addr(&paddr, event->line_addr & ~(uint32_t) MAX_12BIT_VALUE,
+	                            event->line_addr & MAX_12BIT_VALUE), "Error building physical address");
+
+	// same order as in cache_read: L2 lookup, insertion of the L1 victim, then the L2 copy is dropped
+	const uint32_t* p_line;
+	uint8_t hit_way;
+	uint16_t hit_index;
+	// cache_hit() does not read the memory: the cache itself stands for it
+	M_EXIT_IF_ERR(cache_hit(l2_cache, l2_cache, &paddr, &p_line, &hit_way, &hit_index, L2_CACHE),
+	              "Error calling cache_hit on l2 cache");
+	*hit = hit_way != HIT_WAY_MISS;
+
+	if(event->flags & L1_EVENT_VICTIM){
+		const word_t line[L2_CACHE_WORDS_PER_LINE] = {0}; // contents do not matter to the replay
+		M_EXIT_IF_ERR(cache_insert_victim(l2_cache, event->victim_addr, line, LRU), "Error inserting L1 victim in L2");
+	}
+
+	if(*hit){
+		void* cache = l2_cache;
+		cache_entry(l2_cache_entry_t, L2_CACHE_WAYS, hit_index, hit_way)->v = INVALID;
+	}
+	return ERR_NONE;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+ * @file l1_filter.h
+ * @brief Filtering of a program through the L1 caches, and replay of what reaches L2
+ *
+ * The L1 caches behave the same whatever the L2 cache (a line missing in L1 is
+ * inserted in L1 whether it comes from L2 or from memory), and the L2 cache is only
+ * touched on L1 misses (see cache_read and cache_write). A program can thus be run
+ * once through the L1 caches, keeping one event per L1 miss: the missing line, and
+ * the line evicted from L1 to make room for it (which goes to L2). Replaying these
+ * events leaves any L2 cache in the very same state as the whole program would.
+ *
+ * An event file is a fixed-size header (holding the counts of the L1 hits filtered
+ * out) followed by nb_events fixed-width records. Fields are in host byte order.
+ *
+ * Note that the TLBs cannot be filtered that way: an L2 TLB miss invalidates L1 TLB
+ * entries (see tlb_search).
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "commands.h" // for command_t
+#include "cache.h" // for l1_icache_entry_t, l1_dcache_entry_t, l2_cache_entry_t
+
+#define L1_EVENTS_MAGIC "PPSL1EV"
+#define L1_EVENTS_MAGIC_SIZE 8 // including the final '\0'
+#define L1_EVENTS_VERSION 1u
+
+#define L1_EVENT_VICTIM 0x01 // a valid line was evicted from L1 (victim_addr is meaningful)
+
+typedef struct {
+	char magic[L1_EVENTS_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t nb_events;
+	uint64_t nb_commands; // number of commands of the filtered program
+	uint64_t nb_filtered[2][2]; // number of L1 hits filtered out, per mem_access_t and command_word_t
+} l1_events_header_t;
+
+typedef struct {
+	uint32_t line_addr; // physical address of the line missing in L1
+	uint32_t victim_addr; // physical address of the line evicted from L1, if any
+	uint8_t type; // mem_access_t of the access (which L1 cache missed)
+	uint8_t order; // command_word_t of the command that missed
+	uint8_t flags; // L1_EVENT_VICTIM or 0
+	uint8_t reserved; // always 0
+} l1_event_t;
+
+typedef struct {
+	void* mem_space; // the memory the program runs on (written to)
+	l1_icache_entry_t l1_icache[L1_ICACHE_LINES * L1_ICACHE_WAYS];
+	l1_dcache_entry_t l1_dcache[L1_DCACHE_LINES * L1_DCACHE_WAYS];
+	l2_cache_entry_t l2_cache[L2_CACHE_LINES * L2_CACHE_WAYS]; // needed to run cache_read/write(); not observed
+	uint64_t nb_commands;
+	uint64_t nb_filtered[2][2]; // as in l1_events_header_t
+} l1_filter_t;
+
+typedef struct {
+	const l1_events_header_t* header; // points into the mapped file (read-only)
+	const l1_event_t* events;
+	size_t nb_events;
+	void* map_start; // start of the mapping (header included)
+	size_t map_size;
+} l1_events_t;
+
+/**
+ * @brief "Constructor" for l1_filter_t: flush its caches and reset its counts.
+ * @param filter (modified) the filter to be initialized
+ * @param mem_space the memory the program runs on
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_filter_init(l1_filter_t* filter, void* mem_space);
+
+/**
+ * @brief Run a command through the L1 caches.
+ * @param filter (modified) the filter
+ * @param command the command to run
+ * @param event (modified) on L1 miss, the event to be kept
+ * @param missed (modified) 1 if the command missed in L1 (event is set), 0 if it was filtered out
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_filter_command(l1_filter_t* filter, const command_t* command, l1_event_t* event, int* missed);
+
+/**
+ * @brief Initialize the header of an event file from the counts of a filter.
+ * @param header (modified) the header to initialize
+ * @param filter the filter all the commands went through
+ * @param nb_events the number of events that will follow the header
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_events_header_init(l1_events_header_t* header, const l1_filter_t* filter, uint64_t nb_events);
+
+/**
+ * @brief Map an event file in memory (read-only).
+ * @param filename the name of the event file to map
+ * @param events (modified) the mapped events; to be released with l1_events_unmap()
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_events_map(const char* filename, l1_events_t* events);
+
+/**
+ * @brief Release events mapped by l1_events_map().
+ * @param events (modified) the events to unmap
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_events_unmap(l1_events_t* events);
+
+/**
+ * @brief Replay an event on a L2 cache, as cache_read/cache_write would on that L1 miss:
+ * look the line up (moving it out of L2 on hit), and insert the L1 victim, if any.
+ * @param l2_cache pointer to the beginning of L2 CACHE
+ * @param event the event to replay
+ * @param hit (modified) 1 if the line was found in L2, 0 if it had to be fetched from memory
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int l1_event_replay(void* l2_cache, const l1_event_t* event, int* hit);
@@ -0,0 +1,292 @@
+/**
+ * @file mem_dump.c
+ * @brief Buffered dumps of the memory, in hexadecimal or raw, to a FILE* or a file descriptor
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for write()
+
+#include <stdio.h>
+#include <string.h> // memcpy(), memset(), strlen()
+#include <errno.h>
+#include <unistd.h> // write()
+
+#include "mem_dump.h"
+#include "page_walk.h"
+#include "addr_mng.h"
+#include "error.h"
+
+#define ADDR_MAX_LEN 32 // longest printed address (a pointer or a 64-bit offset)
+
+// the two hexadecimal digits of every byte
+#define HEX_DIGIT(n) ((char) ((n) < 10 ? '0' + (n) : 'A' + (n) - 10))
+#define HEX_BYTE(n) { HEX_DIGIT((n) >> 4), HEX_DIGIT((n) & 0xF) }
+#define HEX_ROW(r) \
+	HEX_BYTE(16 * (r) + 0), HEX_BYTE(16 * (r) + 1), HEX_BYTE(16 * (r) + 2), HEX_BYTE(16 * (r) + 3), \
+	HEX_BYTE(16 * (r) + 4), HEX_BYTE(16 * (r) + 5), HEX_BYTE(16 * (r) + 6), HEX_BYTE(16 * (r) + 7), \
+	HEX_BYTE(16 * (r) + 8), HEX_BYTE(16 * (r) + 9), HEX_BYTE(16 * (r) + 10), HEX_BYTE(16 * (r) + 11), \
+	HEX_BYTE(16 * (r) + 12), HEX_BYTE(16 * (r) + 13), HEX_BYTE(16 * (r) + 14), HEX_BYTE(16 * (r) + 15)
+
+static const char hex_bytes[256][2] = {
+	HEX_ROW(0), HEX_ROW(1), HEX_ROW(2), HEX_ROW(3), HEX_ROW(4), HEX_ROW(5), HEX_ROW(6), HEX_ROW(7),
+	HEX_ROW(8), HEX_ROW(9), HEX_ROW(10), HEX_ROW(11), HEX_ROW(12), HEX_ROW(13), HEX_ROW(14), HEX_ROW(15)
+};
+
+// ======================================================================
+static int dumper_init(mem_dumper_t* dumper, const void* mem_space, size_t mem_capacity_in_bytes,
+                       mem_dump_mode_t mode, addr_fmt_t show_addr, size_t line_size, const char* sep){
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(sep);
+	M_REQUIRE(mode == MEM_DUMP_HEX || mode == MEM_DUMP_RAW, ERR_BAD_PARAMETER, "%s", "Unknown dump mode");
+	M_REQUIRE(line_size != 0, ERR_BAD_PARAMETER, "%s", "Dump lines must not be empty");
+	const size_t sep_len = strlen(sep);
+	M_REQUIRE(sep_len <= MEM_DUMP_MAX_SEP, ERR_BAD_PARAMETER, "Separator \"%s\" is too long", sep);
+
+	dumper->mem_space = mem_space;
+	dumper->mem_capacity_in_bytes = mem_capacity_in_bytes;
+	dumper->mode = mode;
+	dumper->show_addr = show_addr;
+	dumper->line_size = line_size;
+	memset(dumper->sep, 0, sizeof(dumper->sep));
+	memcpy(dumper->sep, sep, sep_len);
+	dumper->sep_len = sep_len;
+	dumper->used = 0;
+	dumper->nb_written = 0;
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_dumper_init_file(mem_dumper_t* dumper, FILE* output, const void* mem_space, size_t mem_capacity_in_bytes,
+                         mem_dump_mode_t mode, addr_fmt_t show_addr, size_t line_size, const char* sep){
+	M_REQUIRE_NON_NULL(dumper);
+	M_REQUIRE_NON_NULL(output);
+
+	dumper->file = output;
+	dumper->fd = -1;
+	return dumper_init(dumper, mem_space, mem_capacity_in_bytes, mode, show_addr, line_size, sep);
+}
+
+// ======================================================================
+int mem_dumper_init_fd(mem_dumper_t* dumper, int fd, const void* mem_space, size_t mem_capacity_in_bytes,
+                       mem_dump_mode_t mode, addr_fmt_t show_addr, size_t line_size, const char* sep){
+	M_REQUIRE_NON_NULL(dumper);
+	M_REQUIRE(fd >= 0, ERR_BAD_PARAMETER, "Invalid file descriptor %d", fd);
+
+	dumper->file = NULL;
+	dumper->fd = fd;
+	return dumper_init(dumper, mem_space, mem_capacity_in_bytes, mode, show_addr, line_size, sep);
+}
+
+// ======================================================================
+/**
+ * @brief Write to the output of the dumper, bypassing its buffer.
+ */
+static int dumper_write(mem_dumper_t* dumper, const void* data, size_t size){
+	if(dumper->file != NULL){
+		M_REQUIRE(fwrite(data, 1, size, dumper->file) == size, ERR_IO, "%s", "Cannot write dump");
+	}else{
+		const char* next = data;
+		size_t left = size;
+		while(left > 0){
+			const ssize_t written = write(dumper->fd, next, left);
+			if(written < 0 && errno == EINTR) continue;
+			M_REQUIRE(written > 0, ERR_IO, "%s", "Cannot write dump");
+			next += written;
+			left -= (size_t) written;
+		}
+	}
+	dumper->nb_written += size;
+	return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Make room for size characters in the buffer (size <= MEM_DUMP_BUFFER_SIZE).
+ */
+static int dumper_room(mem_dumper_t* dumper, size_t size){
+	if(dumper->used + size > MEM_DUMP_BUFFER_SIZE){
+		M_EXIT_IF_ERR(dumper_write(dumper, dumper->buffer, dumper->used), "Error writing dump buffer");
+		dumper->used = 0;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+static int dumper_put(mem_dumper_t* dumper, const char* text, size_t size){
+	M_EXIT_IF_ERR(dumper_room(dumper, size), "Error writing dump buffer");
+	memcpy(dumper->buffer + dumper->used, text, size);
+	dumper->used += size;
+	return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Render a number in the given base (10 or 16, upper case); return its length.
+ */
+static size_t number_render(char* where, size_t value, unsigned base){
+	char digits[ADDR_MAX_LEN];
+	size_t nb_digits = 0;
+	do{
+		const unsigned digit = (unsigned) (value % base);
+		digits[nb_digits++] = HEX_DIGIT(digit);
+		value /= base;
+	}while(value != 0);
+	for(size_t i = 0; i < nb_digits; ++i) where[i] = digits[nb_digits - 1 - i];
+	return nb_digits;
+}
+
+// ======================================================================
+/**
+ * @brief Print the address of a line, its colon and the separator (nothing if show_addr is NONE).
+ */
+static int dumper_put_address(mem_dumper_t* dumper, addr_fmt_t show_addr, const uint8_t* addr){
+	if(show_addr != POINTER && show_addr != OFFSET && show_addr != OFFSET_U) return ERR_NONE;
+
+	M_EXIT_IF_ERR(dumper_room(dumper, ADDR_MAX_LEN + 1 + dumper->sep_len), "Error writing dump buffer");
+	char* where = dumper->buffer + dumper->used;
+	const size_t offset = (size_t) (addr - (const uint8_t*) dumper->mem_space);
+	size_t len = 0;
+	if(show_addr == POINTER){
+		const int printed = snprintf(where, ADDR_MAX_LEN, "%p", (const void*) addr);
+		M_REQUIRE(printed > 0 && printed < ADDR_MAX_LEN, ERR_IO, "%s", "Cannot print address");
+		len = (size_t) printed;
+	}else{
+		len = number_render(where, offset, show_addr == OFFSET ? 16 : 10);
+	}
+	where[len++] = ':';
+	memcpy(where + len, dumper->sep, dumper->sep_len);
+	dumper->used += len + dumper->sep_len;
+	return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Print bytes in hexadecimal, each followed by the separator.
+ */
+static int dumper_put_bytes(mem_dumper_t* dumper, const uint8_t* from, size_t size){
+	const size_t width = 2 + dumper->sep_len;
+	while(size > 0){
+		size_t chunk = (MEM_DUMP_BUFFER_SIZE - dumper->used) / width;
+		if(chunk == 0){
+			M_EXIT_IF_ERR(dumper_room(dumper, MEM_DUMP_BUFFER_SIZE), "Error writing dump buffer");
+			continue;
+		}
+		if(chunk > size) chunk = size;
+
+		char* where = dumper->buffer + dumper->used;
+		if(dumper->sep_len == 1){
+			const char sep = dumper->sep[0];
+			for(size_t i = 0; i < chunk; ++i, where += 3){
+				memcpy(where, hex_bytes[from[i]], 2);
+				where[2] = sep;
+			}
+		}else{
+			for(size_t i = 0; i < chunk; ++i, where += width){
+				memcpy(where, hex_bytes[from[i]], 2);
+				memcpy(where + 2, dumper->sep, dumper->sep_len);
+			}
+		}
+		dumper->used += chunk * width;
+		from += chunk;
+		size -= chunk;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Print [from, to) in lines of line_size bytes, each starting with its address.
+ */
+static int dumper_put_lines(mem_dumper_t* dumper, const uint8_t* from, const uint8_t* to, addr_fmt_t show_addr){
+	while(from < to){
+		const size_t left = (size_t) (to - from);
+		const size_t size = left < dumper->line_size ? left : dumper->line_size;
+		M_EXIT_IF_ERR(dumper_put_address(dumper, show_addr, from), "Error dumping address");
+		M_EXIT_IF_ERR(dumper_put_bytes(dumper, from, size), "Error dumping bytes");
+		M_EXIT_IF_ERR(dumper_put(dumper, "\n", 1), "Error dumping line");
+		from += size;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Dump a whole physical page, split at offset (see vmem_page_dump_with_options()).
+ */
+static int dumper_put_page(mem_dumper_t* dumper, const uint8_t* page_start, size_t offset){
+	if(dumper->mode == MEM_DUMP_RAW){
+		M_EXIT_IF_ERR(dumper_room(dumper, PAGE_SIZE), "Error writing dump buffer");
+		memcpy(dumper->buffer + dumper->used, page_start, PAGE_SIZE);
+		dumper->used += PAGE_SIZE;
+		return ERR_NONE;
+	}
+
+	const size_t line_size = dumper->line_size;
+	const uint8_t* const start = page_start + offset;
+	const uint8_t* const end = page_start + PAGE_SIZE;
+	const size_t indent = offset % line_size;
+	const uint8_t* end_line = start + (line_size - indent);
+	if(end_line > end) end_line = end;
+
+	M_EXIT_IF_ERR(dumper_put_lines(dumper, page_start, start, dumper->show_addr), "Error dumping page");
+	if(indent == 0) M_EXIT_IF_ERR(dumper_put(dumper, "\n", 1), "Error dumping page");
+	M_EXIT_IF_ERR(dumper_put_address(dumper, dumper->show_addr, start), "Error dumping page");
+	for(size_t i = 0; i < indent; ++i){
+		M_EXIT_IF_ERR(dumper_put(dumper, "  ", 2), "Error dumping page");
+		M_EXIT_IF_ERR(dumper_put(dumper, dumper->sep, dumper->sep_len), "Error dumping page");
+	}
+	M_EXIT_IF_ERR(dumper_put_lines(dumper, start, end_line, NONE), "Error dumping page");
+	M_EXIT_IF_ERR(dumper_put_lines(dumper, end_line, end, dumper->show_addr), "Error dumping page");
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_dump_vpages(mem_dumper_t* dumper, const virt_addr_t* from, size_t nb_pages){
+	M_REQUIRE_NON_NULL(dumper);
+	M_REQUIRE_NON_NULL(from);
+
+	uint64_t vaddr64 = virt_addr_t_to_uint64_t(from);
+	for(size_t i = 0; i < nb_pages; ++i){
+		virt_addr_t vaddr;
+		M_EXIT_IF_ERR(init_virt_addr64(&vaddr, vaddr64), "Error building virtual address");
+		phy_addr_t paddr;
+		M_EXIT_IF_ERR(page_walk(dumper->mem_space, &vaddr, &paddr), "Error translating page to dump");
+
+		const size_t page_offset = (size_t) paddr.phy_page_num << PAGE_OFFSET;
+		M_REQUIRE(dumper->mem_capacity_in_bytes >= PAGE_SIZE && page_offset <= dumper->mem_capacity_in_bytes - PAGE_SIZE,
+		          ERR_ADDR, "Page at 0x%zx out of the memory", page_offset);
+		const uint8_t* page_start = (const uint8_t*) dumper->mem_space + page_offset;
+		M_EXIT_IF_ERR(dumper_put_page(dumper, page_start, paddr.page_offset), "Error dumping page");
+		// the following pages are dumped from their start
+		vaddr64 = (vaddr64 & ~(uint64_t) (PAGE_SIZE - 1)) + PAGE_SIZE;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_dump_physical(mem_dumper_t* dumper, size_t from, size_t size){
+	M_REQUIRE_NON_NULL(dumper);
+	M_REQUIRE(from <= dumper->mem_capacity_in_bytes && size <= dumper->mem_capacity_in_bytes - from, ERR_ADDR,
+	          "Area of %zu bytes at 0x%zx out of the memory", size, from);
+
+	const uint8_t* start = (const uint8_t*) dumper->mem_space + from;
+	if(dumper->mode == MEM_DUMP_HEX){
+		return dumper_put_lines(dumper, start, start + size, dumper->show_addr);
+	}
+
+	// raw: small areas are gathered, large ones are written as they are
+	if(size <= MEM_DUMP_BUFFER_SIZE - dumper->used) return dumper_put(dumper, (const char*) start, size);
+	M_EXIT_IF_ERR(dumper_room(dumper, MEM_DUMP_BUFFER_SIZE), "Error writing dump buffer");
+	return dumper_write(dumper, start, size);
+}
+
+// ======================================================================
+int mem_dumper_flush(mem_dumper_t* dumper){
+	M_REQUIRE_NON_NULL(dumper);
+
+	M_EXIT_IF_ERR(dumper_room(dumper, MEM_DUMP_BUFFER_SIZE), "Error writing dump buffer");
+	if(dumper->file != NULL) M_REQUIRE(fflush(dumper->file) == 0, ERR_IO, "%s", "Cannot flush dump");
+	return ERR_NONE;
+}
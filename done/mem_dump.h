@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * @file mem_dump.h
+ * @brief Buffered dumps of the memory, in hexadecimal or raw, to a FILE* or a file descriptor
+ *
+ * A dumper renders what it is asked to dump in its own buffer, which is written
+ * to its output whenever it is full, and on mem_dumper_flush(). Bytes are turned
+ * into hexadecimal through a table, a whole line at a time. In raw mode, the
+ * bytes of the memory are written as they are (large areas without any copy).
+ *
+ * The hexadecimal layout of a virtual page is the one of vmem_page_dump_with_options().
+ * The one of a physical area is a line of line_size bytes per line_size bytes.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for FILE and size_t
+#include <stdint.h> // for uint64_t
+
+#include "addr.h" // for virt_addr_t
+#include "memory.h" // for addr_fmt_t
+
+#define MEM_DUMP_BUFFER_SIZE (1 << 16)
+#define MEM_DUMP_MAX_SEP 15 // longest separator, in characters
+
+typedef enum {
+	MEM_DUMP_HEX,
+	MEM_DUMP_RAW
+} mem_dump_mode_t;
+
+typedef struct {
+	FILE* file; // the output, if any...
+	int fd; // ...otherwise this file descriptor
+	const void* mem_space; // the memory dumped (the reference of the offsets)
+	size_t mem_capacity_in_bytes; // its size: nothing past it is ever dumped
+	mem_dump_mode_t mode;
+	addr_fmt_t show_addr; // how to print the address of a line (hexadecimal only)
+	size_t line_size; // number of bytes per line (hexadecimal only)
+	char sep[MEM_DUMP_MAX_SEP + 1]; // printed after addresses and bytes (hexadecimal only)
+	size_t sep_len;
+	size_t used; // number of characters in the buffer
+	uint64_t nb_written; // number of characters written to the output so far
+	char buffer[MEM_DUMP_BUFFER_SIZE];
+} mem_dumper_t;
+
+/**
+ * @brief "Constructor" for mem_dumper_t, writing to a FILE*.
+ * @param dumper (modified) the dumper to be initialized
+ * @param output where to write
+ * @param mem_space the memory to dump
+ * @param mem_capacity_in_bytes the size of the memory
+ * @param mode hexadecimal or raw
+ * @param show_addr how to print the address of each line (see addr_fmt_t)
+ * @param line_size number of bytes per line (not 0)
+ * @param sep separator printed after addresses and bytes (at most MEM_DUMP_MAX_SEP characters)
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int mem_dumper_init_file(mem_dumper_t* dumper, FILE* output, const void* mem_space, size_t mem_capacity_in_bytes,
+                         mem_dump_mode_t mode, addr_fmt_t show_addr, size_t line_size, const char* sep);
+
+/**
+ * @brief "Constructor" for mem_dumper_t, writing to a file descriptor
+ * (see mem_dumper_init_file() for the other parameters).
+ * @param fd where to write
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int mem_dumper_init_fd(mem_dumper_t* dumper, int fd, const void* mem_space, size_t mem_capacity_in_bytes,
+                       mem_dump_mode_t mode, addr_fmt_t show_addr, size_t line_size, const char* sep);
+
+/**
+ * @brief Dump consecutive virtual pages: all of each page is dumped, the first
+ * one being split at the offset of from (as vmem_page_dump_with_options() does).
+ * @param dumper (modified) the dumper
+ * @param from the virtual address to start from
+ * @param nb_pages the number of pages to dump
+ * @return ERR_NONE if ok, appropriate error code otherwise (some pages may have been dumped);
+ * ERR_ADDR if a page is not (wholly) in the memory.
+ */
+int mem_dump_vpages(mem_dumper_t* dumper, const virt_addr_t* from, size_t nb_pages);
+
+/**
+ * @brief Dump an area of the physical memory.
+ * @param dumper (modified) the dumper
+ * @param from offset of the first byte to dump
+ * @param size number of bytes to dump
+ * @return ERR_NONE if ok, appropriate error code otherwise; ERR_ADDR if the area is not in the memory.
+ */
+int mem_dump_physical(mem_dumper_t* dumper, size_t from, size_t size);
+
+/**
+ * @brief Write what the dumper still holds to its output (and flush the FILE*, if any).
+ * @param dumper (modified) the dumper
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int mem_dumper_flush(mem_dumper_t* dumper);
@@ -10,79 +10,31 @@
 #define __USE_MINGW_ANSI_STDIO 1
 #endif
 
+#define _POSIX_C_SOURCE 200809L // for mmap()
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS, MAP_NORESERVE and mincore()
+
 #include <stdio.h>  // for FILE
 #include <stdlib.h> // for strtoul
 #include <stdint.h> // for size_t
 #include <string.h> // for memset()
 #include <inttypes.h> // for SCNx macros
 #include <assert.h>
+#include <fcntl.h> // open()
+#include <unistd.h> // close()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "memory.h"
+#include "mem_dump.h"
 #include "page_walk.h"
 #include "addr_mng.h"
 #include "util.h" // for SIZE_T_FMT
 #include "addr.h" // for virt_addr_t and phy_addr_t
 #include "error.h"
 
-// ======================================================================
-/**
- * @brief Tool function to print an address.
- *
- * @param show_addr the format how to display addresses; see addr_fmt_t type in memory.h
- * @param reference the reference address; i.e. the top of the main memory
- * @param addr the address to be displayed
- * @param sep a separator to print after the address (and its colon, printed anyway)
- *
- */
-static void address_print(addr_fmt_t show_addr, const void* reference,
-                          const void* addr, const char* sep)
-{
-    switch (show_addr) {
-    case POINTER:
-        (void)printf("%p", addr);
-        break;
-    case OFFSET:
-        (void)printf("%zX", (const char*)addr - (const char*)reference);
-        break;
-    case OFFSET_U:
-        (void)printf(SIZE_T_FMT, (const char*)addr - (const char*)reference);
-        break;
-    default:
-        // do nothing
-        return;
-    }
-    (void)printf(":%s", sep);
-}
-
-// ======================================================================
-/**
- * @brief Tool function to print the content of a memory area
- *
- * @param reference the reference address; i.e. the top of the main memory
- * @param from first address to print
- * @param to first address NOT to print; if less that `from`, nothing is printed;
- * @param show_addr the format how to display addresses; see addr_fmt_t type in memory.h
- * @param line_size how many memory byted to print per stdout line
- * @param sep a separator to print after the address and between bytes
- *
- */
-static void mem_dump_with_options(const void* reference, const void* from, const void* to,
-                                  addr_fmt_t show_addr, size_t line_size, const char* sep)
-{
-    assert(line_size != 0);
-    size_t nb_to_print = line_size;
-    for (const uint8_t* addr = from; addr < (const uint8_t*) to; ++addr) {
-        if (nb_to_print == line_size) {
-            address_print(show_addr, reference, addr, sep);
-        }
-        (void)printf("%02"PRIX8"%s", *addr, sep);
-        if (--nb_to_print == 0) {
-            nb_to_print = line_size;
-            putchar('\n');
-        }
-    }
-    if (nb_to_print != line_size) putchar('\n');
-}
+static size_t mem_mapping_capacity(const void* memory);
 
 // ======================================================================
 // See memory.h for description
@@ -95,31 +47,16 @@ int vmem_page_dump_with_options(const void *mem_space, const virt_addr_t* from,
     print_virtual_address(stderr, from);
     (void)fputc('\n', stderr);
 #endif
-    phy_addr_t paddr;
-    zero_init_var(paddr);
+    // the dumper is too large for the stack of some threads
+    mem_dumper_t* dumper = malloc(sizeof(mem_dumper_t));
+    M_EXIT_IF_NULL(dumper, sizeof(mem_dumper_t));
 
-    M_EXIT_IF_ERR(page_walk(mem_space, from, &paddr),
-                  "calling page_walk() from vmem_page_dump_with_options()");
-
-#ifdef DEBUG
-    (void)fprintf(stderr, __FILE__ ":%d:%s(): phys. addr.=", __LINE__, __func__);
-    print_physical_address(stderr, &paddr);
-    (void)fputc('\n', stderr);
-#endif
-    const uint32_t paddr_offset = ((uint32_t) paddr.phy_page_num << PAGE_OFFSET);
-    const char * const page_start = (const char *)mem_space + paddr_offset;
-    const char * const start = page_start + paddr.page_offset;
-    const char * const end_line = start + (line_size - paddr.page_offset % line_size);
-    const char * const end   = page_start + PAGE_SIZE;
-    debug_print("start=%p (offset=%zX)\n", (const void*) start, start - (const char *)mem_space);
-    debug_print("end  =%p (offset=%zX)\n", (const void*) end, end   - (const char *)mem_space) ;
-    mem_dump_with_options(mem_space, page_start, start, show_addr, line_size, sep);
-    const size_t indent = paddr.page_offset % line_size;
-    if (indent == 0) putchar('\n');
-    address_print(show_addr, mem_space, start, sep);
-    for (size_t i = 1; i <= indent; ++i) printf("  %s", sep);
-    mem_dump_with_options(mem_space, start, end_line, NONE, line_size, sep);
-    mem_dump_with_options(mem_space, end_line, end, show_addr, line_size, sep);
+    int err = mem_dumper_init_file(dumper, stdout, mem_space, mem_mapping_capacity(mem_space), MEM_DUMP_HEX,
+                                   show_addr, line_size, sep);
+    if (err == ERR_NONE) err = mem_dump_vpages(dumper, from, 1);
+    if (err == ERR_NONE) err = mem_dumper_flush(dumper);
+    free(dumper);
+    M_EXIT_IF_ERR(err, "calling mem_dump_vpages() from vmem_page_dump_with_options()");
     return ERR_NONE;
 }
 
@@ -147,24 +84,20 @@ int mem_init_from_dumpfile(const char* filename, void** memory, size_t* mem_capa
 		*mem_capacity_in_bytes = (size_t) ftell(mem_dump);
 		rewind(mem_dump);
 
-		//Allocate memory
-		*memory = calloc(*mem_capacity_in_bytes, 1);
-		if(memory == NULL){
+		//Allocate memory (on huge pages if asked to)
+		if(mem_init_sparse(*mem_capacity_in_bytes, memory) != ERR_NONE){
 			fclose(mem_dump);
+			*memory = NULL;
 			M_EXIT(ERR_MEM, "%s", "Error allocating memory to init from dumpfile");
 		}
-		
-		size_t bytes_read;
-		if(*memory != NULL){
-			//Initialize the memory from mem_dump file
-			bytes_read = fread(*memory, 1, *mem_capacity_in_bytes, mem_dump);
-		}
-		fclose(mem_dump);
 
-		M_EXIT_IF_NULL(*memory, *mem_capacity_in_bytes);
+		//Initialize the memory from mem_dump file
+		const size_t bytes_read = fread(*memory, 1, *mem_capacity_in_bytes, mem_dump);
+		fclose(mem_dump);
 
 		if(bytes_read != *mem_capacity_in_bytes){
-			free(*memory);
+			mem_release(*memory, *mem_capacity_in_bytes);
+			*memory = NULL;
 			M_EXIT(ERR_IO, "%s", "Couldn't read the whole memory dump file");
 		}
 	}else{
@@ -175,6 +108,272 @@ int mem_init_from_dumpfile(const char* filename, void** memory, size_t* mem_capa
 	return ERR_NONE;
 }
 
+// ======================================================================
+/*
+ * Memories that are not allocated by malloc(), and thus not to be free()'d
+ * (see mem_release()). Their number is small: a simulator typically uses one memory.
+ */
+#define MEM_MAX_MAPPINGS 16
+
+typedef struct {
+	void* start; // NULL if the slot is unused
+	size_t size; // as returned by mem_init_*()
+	size_t map_size; // as mapped (whole huge pages)
+	int huge; // backed by huge pages: parts are never remapped from files
+} mem_mapping_t;
+
+static mem_mapping_t mem_mappings[MEM_MAX_MAPPINGS];
+
+static mem_huge_pages_t mem_huge_pages = MEM_HUGE_NONE;
+
+/**
+ * @brief Record a mapped memory, so that mem_release() knows how to release it
+ * @return 1 if recorded, 0 if the registry is full
+ */
+static int mem_mapping_add(void* start, size_t size, size_t map_size, int huge){
+	for(size_t i = 0; i < MEM_MAX_MAPPINGS; ++i){
+		if(mem_mappings[i].start == NULL){
+			mem_mappings[i].start = start;
+			mem_mappings[i].size = size;
+			mem_mappings[i].map_size = map_size;
+			mem_mappings[i].huge = huge;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Find a mapped memory in the registry
+ * @return its registry entry, NULL if the memory was not mapped
+ */
+static mem_mapping_t* mem_mapping_find(const void* start){
+	for(size_t i = 0; i < MEM_MAX_MAPPINGS; ++i){
+		if(mem_mappings[i].start != NULL && mem_mappings[i].start == start) return &mem_mappings[i];
+	}
+	return NULL;
+}
+
+/**
+ * @brief The size of a memory, when it is not given (as to vmem_page_dump_with_options())
+ * @return its size, SIZE_MAX if unknown (memory not mapped, but allocated by malloc())
+ */
+static size_t mem_mapping_capacity(const void* memory){
+	const mem_mapping_t* mapping = mem_mapping_find(memory);
+	return mapping == NULL ? SIZE_MAX : mapping->size;
+}
+
+// ======================================================================
+int mem_init_from_dumpfile_mapped(const char* filename, void** memory, size_t* mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(filename);
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(mem_capacity_in_bytes);
+
+	*memory = NULL;
+	// a file mapping cannot be made of huge pages
+	if(mem_huge_pages != MEM_HUGE_NONE) return mem_init_from_dumpfile(filename, memory, mem_capacity_in_bytes);
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Error opening file %s", filename);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0){
+		close(fd);
+		M_EXIT(ERR_IO, "Cannot stat %s", filename);
+	}
+	const size_t size = (size_t) st.st_size;
+
+	/* Private (copy-on-write) mapping: the simulation may write to the memory,
+	 * the file is never modified; pages are only read from the file when touched. */
+	void* start = size == 0 ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference on the file
+
+	if(start == MAP_FAILED || !mem_mapping_add(start, size, size, 0)){
+		// empty file, no mmap() or too many mappings: fall back to a copy
+		if(start != MAP_FAILED) munmap(start, size);
+		return mem_init_from_dumpfile(filename, memory, mem_capacity_in_bytes);
+	}
+
+	*memory = start;
+	*mem_capacity_in_bytes = size;
+	return ERR_NONE;
+}
+
+// ======================================================================
+typedef struct {
+	const void* memory;
+	mem_write_observer_t observer;
+	void* context;
+} mem_observer_t;
+
+static mem_observer_t mem_observers[MEM_MAX_OBSERVERS];
+static size_t mem_nb_observers = 0;
+
+int mem_observer_add(const void* memory, mem_write_observer_t observer, void* context){
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(observer);
+	M_REQUIRE(mem_nb_observers < MEM_MAX_OBSERVERS, ERR_MEM, "%s", "Too many memory observers");
+
+	mem_observers[mem_nb_observers].memory = memory;
+	mem_observers[mem_nb_observers].observer = observer;
+	mem_observers[mem_nb_observers].context = context;
+	++mem_nb_observers;
+	return ERR_NONE;
+}
+
+int mem_observer_remove(const void* memory, mem_write_observer_t observer, void* context){
+	for(size_t i = 0; i < mem_nb_observers; ++i){
+		const mem_observer_t* o = &mem_observers[i];
+		if(o->memory == memory && o->observer == observer && o->context == context){
+			mem_observers[i] = mem_observers[--mem_nb_observers];
+			return ERR_NONE;
+		}
+	}
+	M_EXIT(ERR_BAD_PARAMETER, "%s", "No such memory observer");
+}
+
+void mem_written(const void* memory, uint32_t paddr, size_t size){
+	for(size_t i = 0; i < mem_nb_observers; ++i){
+		if(mem_observers[i].memory == memory) mem_observers[i].observer(mem_observers[i].context, paddr, size);
+	}
+}
+
+// ======================================================================
+int mem_init_sparse(size_t mem_capacity_in_bytes, void** memory){
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE(mem_capacity_in_bytes <= MEM_MAX_CAPACITY, ERR_BAD_PARAMETER,
+	          "Memory of %zu bytes exceeds the physical address space", mem_capacity_in_bytes);
+
+	const size_t huge_size = (mem_capacity_in_bytes + MEM_HUGE_PAGE_SIZE - 1) / MEM_HUGE_PAGE_SIZE * MEM_HUGE_PAGE_SIZE;
+	if(mem_huge_pages == MEM_HUGE_TLB && mem_capacity_in_bytes != 0){
+		// from the pool of the system: reserved at once (no MAP_NORESERVE, not to get SIGBUS when the pool is empty)
+		*memory = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(*memory != MAP_FAILED){
+			if(mem_mapping_add(*memory, mem_capacity_in_bytes, huge_size, 1)) return ERR_NONE;
+			munmap(*memory, huge_size);
+		}
+		// no huge page pool: fall back to transparent huge pages
+	}
+
+	if(mem_huge_pages != MEM_HUGE_NONE && mem_capacity_in_bytes != 0){
+		// transparent huge pages need 2 MiB-aligned ranges: over-reserve, then trim
+		byte_t* start = mmap(NULL, huge_size + MEM_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if(start != MAP_FAILED){
+			byte_t* aligned = (byte_t*) (((uintptr_t) start + MEM_HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (MEM_HUGE_PAGE_SIZE - 1));
+			if(aligned > start) munmap(start, (size_t) (aligned - start));
+			if(aligned < start + MEM_HUGE_PAGE_SIZE) munmap(aligned + huge_size, (size_t) (start + MEM_HUGE_PAGE_SIZE - aligned));
+			(void) madvise(aligned, huge_size, MADV_HUGEPAGE); // a hint: small pages if refused
+			*memory = aligned;
+			if(mem_mapping_add(*memory, mem_capacity_in_bytes, huge_size, 1)) return ERR_NONE;
+			munmap(aligned, huge_size);
+		}
+	}
+
+	/* Only reserve the address range: the kernel allocates (zeroed) frames on first touch,
+	 * and its page tables act as the directory of the populated frames. */
+	*memory = mmap(NULL, mem_capacity_in_bytes, PROT_READ | PROT_WRITE,
+	               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(*memory != MAP_FAILED){
+		if(mem_mapping_add(*memory, mem_capacity_in_bytes, mem_capacity_in_bytes, 0)) return ERR_NONE;
+		munmap(*memory, mem_capacity_in_bytes);
+	}
+
+	// empty memory, no mmap() or too many mappings: fall back to malloc()
+	*memory = calloc(mem_capacity_in_bytes, 1);
+	M_EXIT_IF_NULL(*memory, mem_capacity_in_bytes);
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_resident_size(const void* memory, size_t mem_capacity_in_bytes, size_t* resident){
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(resident);
+
+	*resident = 0;
+	if(mem_capacity_in_bytes == 0) return ERR_NONE;
+
+	// mincore() wants a page-aligned start
+	const uintptr_t begin = (uintptr_t) memory & ~(uintptr_t) (PAGE_SIZE - 1);
+	const uintptr_t end = (uintptr_t) memory + mem_capacity_in_bytes;
+	const size_t nb_pages = (end - begin + PAGE_SIZE - 1) / PAGE_SIZE;
+
+	// by chunks, not to allocate one status byte per page of a huge memory
+	unsigned char status[4096];
+	for(size_t first = 0; first < nb_pages; first += sizeof(status)){
+		const size_t n = nb_pages - first < sizeof(status) ? nb_pages - first : sizeof(status);
+		M_REQUIRE(mincore((void*) (begin + first * PAGE_SIZE), n * PAGE_SIZE, status) == 0, ERR_MEM,
+		          "%s", "Cannot get the resident pages of the memory");
+		for(size_t i = 0; i < n; ++i) *resident += (status[i] & 1) ? PAGE_SIZE : 0;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+void mem_set_huge_pages(mem_huge_pages_t huge_pages){
+	mem_huge_pages = huge_pages;
+}
+
+// ======================================================================
+int mem_huge_size(const void* memory, size_t mem_capacity_in_bytes, size_t* huge){
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(huge);
+
+	*huge = 0;
+	const mem_mapping_t* mapping = mem_mapping_find(memory);
+	if(mapping == NULL || !mapping->huge) return ERR_NONE;
+
+	// the kernel only tells through the description of the areas of the process
+	FILE* smaps = fopen("/proc/self/smaps", "r");
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(smaps, ERR_IO);
+
+	const uintptr_t begin = (uintptr_t) mapping->start;
+	const uintptr_t end = begin + mapping->map_size;
+	int inside = 0; // whether the current area overlaps the memory
+	size_t total = 0;
+	char line[256];
+	while(fgets(line, sizeof(line), smaps) != NULL){
+		uintptr_t from, to;
+		char perms[5];
+		size_t kb;
+		if(sscanf(line, "%" SCNxPTR "-%" SCNxPTR " %4s", &from, &to, perms) == 3){
+			inside = from < end && to > begin;
+		}else if(inside && (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1
+		                    || sscanf(line, "Private_Hugetlb: %zu kB", &kb) == 1
+		                    || sscanf(line, "Shared_Hugetlb: %zu kB", &kb) == 1)){
+			total += kb * 1024;
+		}
+	}
+	fclose(smaps);
+
+	// a neighbouring area merged with the memory's would be counted too
+	*huge = total < mem_capacity_in_bytes ? total : mem_capacity_in_bytes;
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_release(void* memory, size_t mem_capacity_in_bytes){
+	if(memory == NULL) return ERR_NONE;
+
+	// a later memory may get the same address
+	for(size_t i = mem_nb_observers; i-- > 0; ){
+		if(mem_observers[i].memory == memory) mem_observers[i] = mem_observers[--mem_nb_observers];
+	}
+
+	mem_mapping_t* mapping = mem_mapping_find(memory);
+	if(mapping == NULL){
+		free(memory);
+		return ERR_NONE;
+	}
+
+	M_REQUIRE(mapping->size == mem_capacity_in_bytes, ERR_BAD_PARAMETER,
+	          "Memory of %zu bytes released with a size of %zu bytes", mapping->size, mem_capacity_in_bytes);
+	const int unmapped = munmap(mapping->start, mapping->map_size) == 0;
+	mapping->start = NULL;
+	M_REQUIRE(unmapped, ERR_MEM, "%s", "Cannot unmap memory");
+	return ERR_NONE;
+}
+
 
 /**
  * @brief Create and initialize the whole memory space from a provided
@@ -213,6 +412,34 @@ static int virt_uint_64_to_phy_addr(void * const memory,
 									const uint64_t vaddr64,
 									phy_addr_t * const paddr);
 
+// ======================================================================
+#define MEM_LOAD_THREADS 8 // max. number of threads loading the pages of a description
+
+typedef struct {
+	phy_addr_t paddr; // where the page goes (resolved from vaddr64 for data pages)
+	uint64_t vaddr64; // data pages only
+	size_t rank; // position in the description (the last of two pages at the same address wins)
+	int skip; // 1 if overwritten by a later page
+	char filename[MAX_FILENAME_SIZE];
+} page_job_t;
+
+typedef struct {
+	page_job_t* jobs;
+	size_t nb_jobs;
+	size_t allocated;
+} page_jobs_t;
+
+typedef struct {
+	const page_jobs_t* jobs;
+	void* memory;
+	size_t mem_capacity_in_bytes;
+	atomic_size_t next; // next job to be taken by a thread
+	atomic_int err; // first error met by a thread, ERR_NONE if none
+} page_loader_t;
+
+static int description_load(const char* master_filename, void** memory, size_t* mem_capacity_in_bytes,
+                            page_jobs_t* translation, page_jobs_t* data);
+
 int mem_init_from_description(const char* master_filename,
                               void** memory,
                               size_t* mem_capacity_in_bytes) {
@@ -221,8 +448,114 @@ int mem_init_from_description(const char* master_filename,
 	M_REQUIRE_NON_NULL(memory);
 	M_REQUIRE_NON_NULL(mem_capacity_in_bytes);
 
-	FILE* f = fopen(master_filename, "r");
-	M_REQUIRE_NON_NULL_CUSTOM_ERR(f, ERR_IO);
+	page_jobs_t translation = {NULL, 0, 0};
+	page_jobs_t data = {NULL, 0, 0};
+	const int err = description_load(master_filename, memory, mem_capacity_in_bytes, &translation, &data);
+	free(translation.jobs);
+	free(data.jobs);
+	return err;
+}
+
+/**
+ * @brief Appends a (blank) job to a list
+ * @param jobs (modified) the list to grow
+ * @return the new job, NULL if out of memory
+ */
+static page_job_t* page_jobs_add(page_jobs_t* jobs){
+	if(jobs->nb_jobs == jobs->allocated){
+		const size_t allocated = jobs->allocated == 0 ? 64 : 2 * jobs->allocated;
+		page_job_t* grown = realloc(jobs->jobs, allocated * sizeof(page_job_t));
+		if(grown == NULL) return NULL;
+		jobs->jobs = grown;
+		jobs->allocated = allocated;
+	}
+	page_job_t* job = &jobs->jobs[jobs->nb_jobs];
+	memset(job, 0, sizeof(*job));
+	job->rank = jobs->nb_jobs++;
+	return job;
+}
+
+/**
+ * @brief Orders jobs by physical address, and then by rank in the description
+ */
+static int page_job_cmp(const void* a, const void* b){
+	const page_job_t* ja = a;
+	const page_job_t* jb = b;
+	const uint32_t pa = phy_addr_t_to_uint32_t(&ja->paddr);
+	const uint32_t pb = phy_addr_t_to_uint32_t(&jb->paddr);
+	if(pa != pb) return pa < pb ? -1 : 1;
+	return ja->rank < jb->rank ? -1 : ja->rank > jb->rank;
+}
+
+/**
+ * @brief Thread body: loads the jobs not taken yet, until none is left or some thread failed
+ * @param arg the page_loader_t shared by the threads
+ * @return NULL (errors are reported in the loader)
+ */
+static void* page_loader_run(void* arg){
+	page_loader_t* loader = arg;
+	size_t i;
+	while(atomic_load(&loader->err) == ERR_NONE
+	      && (i = atomic_fetch_add(&loader->next, 1)) < loader->jobs->nb_jobs){
+		const page_job_t* job = &loader->jobs->jobs[i];
+		if(job->skip) continue;
+
+		if(page_file_read(&job->paddr, job->filename, loader->memory, loader->mem_capacity_in_bytes) != ERR_NONE){
+			int none = ERR_NONE;
+			atomic_compare_exchange_strong(&loader->err, &none, ERR_IO);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Loads pages into memory, concurrently. Jobs writing the same page shall be skipped but one.
+ * @param jobs the pages to load
+ * @param memory the memory space to write the pages in
+ * @param mem_capacity_in_bytes the memory capacity
+ * @return ERR_NONE if sucessful, ERR_IO if any page could not be loaded
+ */
+static int page_jobs_load(const page_jobs_t* jobs, void* memory, size_t mem_capacity_in_bytes){
+	page_loader_t loader = {jobs, memory, mem_capacity_in_bytes};
+	atomic_init(&loader.next, 0);
+	atomic_init(&loader.err, ERR_NONE);
+
+	// the calling thread is a loader too: nothing is started for a single page
+	const size_t nb_threads = jobs->nb_jobs < MEM_LOAD_THREADS ? jobs->nb_jobs : MEM_LOAD_THREADS;
+	pthread_t threads[MEM_LOAD_THREADS];
+	size_t nb_started = 0;
+	while(nb_started + 1 < nb_threads
+	      && pthread_create(&threads[nb_started], NULL, page_loader_run, &loader) == 0){
+		++nb_started; // if creation fails, the threads already there do the job
+	}
+	page_loader_run(&loader);
+	for(size_t t = 0; t < nb_started; ++t) pthread_join(threads[t], NULL);
+
+	return atomic_load(&loader.err);
+}
+
+/**
+ * @brief Marks the jobs writing a page that a later job of the list overwrites, as the loading order is lost
+ * @param jobs (modified) the jobs, sorted by physical address as a side effect
+ */
+static void page_jobs_skip_overwritten(page_jobs_t* jobs){
+	qsort(jobs->jobs, jobs->nb_jobs, sizeof(page_job_t), page_job_cmp);
+	for(size_t i = 0; i + 1 < jobs->nb_jobs; ++i){
+		jobs->jobs[i].skip = phy_addr_t_to_uint32_t(&jobs->jobs[i].paddr)
+		                     == phy_addr_t_to_uint32_t(&jobs->jobs[i + 1].paddr);
+	}
+}
+
+/**
+ * @brief Parses a memory description (see mem_init_from_description()) into the translation
+ * pages (at their physical address) and the data pages (at their virtual address), and closes it
+ * @param f the opened description file
+ * @param mem_capacity_in_bytes (modified) the memory size read
+ * @param translation (modified) the translation pages, PGD first
+ * @param data (modified) the data pages
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int description_parse(FILE* f, size_t* mem_capacity_in_bytes, page_jobs_t* translation, page_jobs_t* data) {
 
 /*
  *  line1:           TOTAL MEMORY SIZE (size_t)
@@ -234,67 +567,82 @@ int mem_init_from_description(const char* master_filename,
  *                       VIRTUAL ADDRESS (uint64_t in hexa) and FILENAME
  */
 
-	/*** ALLOCATE THE WHOLE PHYSICAL MEMORY SPACE (FOR ALL THE PAGES) ***/
-	fscanf(f, "%zu", mem_capacity_in_bytes);
-	*memory  = calloc(*mem_capacity_in_bytes, 1);
+	if(fscanf(f, "%zu", mem_capacity_in_bytes) != 1) { fclose(f); return ERR_IO; }
 
-	if(*memory == NULL) { fclose(f); return ERR_MEM; }
+	// PGD
+	page_job_t* job = page_jobs_add(translation);
+	if(job == NULL) { fclose(f); return ERR_MEM; }
+	if(fscanf(f, "%s", job->filename) != 1) { fclose(f); return ERR_IO; }
+	//PGD starts at phy addr. 0 (job->paddr is zeroed)
+
+	// OTHER TRANSLATION PAGES
+	int nb_pages;
+	if(fscanf(f, "%d", &nb_pages) != 1) { fclose(f); return ERR_IO; }
 
-	/*** WRITE THE TRANSLATION PAGES IN MEMORY ***/
-	char filename[MAX_FILENAME_SIZE];
-	phy_addr_t paddr;
 	uint32_t paddr_32b = 0u;
 	error_code err = ERR_NONE;
-
-	// PGD
-
-	if(fscanf(f, "%s", filename) != 1){
-		fclose(f); return ERR_IO;
+	for(int i = 0; i < nb_pages; i++) {
+		if((job = page_jobs_add(translation)) == NULL) { fclose(f); return ERR_MEM; }
+		if(fscanf(f, "%x %s", &paddr_32b, job->filename) != 2) { fclose(f); return ERR_IO; }
+		if((err = init_phy_addr(&job->paddr, paddr_32b, 0)) != ERR_NONE) { fclose(f); return err; }
 	}
 
-	if((err = init_phy_addr(&paddr, 0, 0)) != ERR_NONE) { //PGD starts at phy addr. 0
-  	fclose(f); return err;
-	}
-	if(page_file_read(&paddr, filename, *memory, *mem_capacity_in_bytes) != ERR_NONE){
-  	fclose(f); return ERR_IO;
+	// DATA PAGES
+	uint64_t vaddr64 = 0ul;
+	char filename[MAX_FILENAME_SIZE];
+	while(fscanf(f, "%lx %s", &vaddr64, filename) == 2 && !feof(f)) {
+		if((job = page_jobs_add(data)) == NULL) { fclose(f); return ERR_MEM; }
+		job->vaddr64 = vaddr64;
+		strcpy(job->filename, filename);
 	}
+	fclose(f);
+	return ERR_NONE;
+}
+
+/**
+ * @brief Creates a memory from a description (see mem_init_from_description()).
+ * Translation pages are all loaded first, as the data pages are placed by walking them.
+ * @param master_filename the name of the description file
+ * @param memory (modified) the memory created, NULL on error
+ * @param mem_capacity_in_bytes (modified) total size of the created memory
+ * @param translation (modified) the translation pages loaded; to be freed (even on error)
+ * @param data (modified) the data pages loaded; to be freed (even on error)
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int description_load(const char* master_filename, void** memory, size_t* mem_capacity_in_bytes,
+                            page_jobs_t* translation, page_jobs_t* data) {
+	*memory = NULL;
+	*mem_capacity_in_bytes = 0;
+	FILE* f = fopen(master_filename, "r");
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(f, ERR_IO);
 
-  // OTHER TRANSLATION PAGES
+	/*** LIST THE PAGES, AND RESERVE THE WHOLE PHYSICAL MEMORY SPACE (ONLY THE PAGES WRITTEN ARE ALLOCATED) ***/
+	size_t capacity = 0;
+	int err = description_parse(f, &capacity, translation, data);
+	if(err == ERR_NONE && (err = mem_init_sparse(capacity, memory)) == ERR_NONE){
+		*mem_capacity_in_bytes = capacity;
+	}
 
-	int nb_pages;
-	if(fscanf(f, "%d", &nb_pages) != 1){
-		fclose(f); return ERR_IO;
+	/*** WRITE THE TRANSLATION PAGES IN MEMORY ***/
+	if(err == ERR_NONE){
+		page_jobs_skip_overwritten(translation);
+		err = page_jobs_load(translation, *memory, capacity);
 	}
 
-	uint64_t vaddr64 = 0ul;
-	for(int i = 0; i < nb_pages; i++) {
-		if(fscanf(f, "%x %s", &paddr_32b, filename) != 2){
-			fclose(f); return ERR_IO;
-		}
+	/*** WRITE DATA PAGES ***/
+	for(size_t i = 0; err == ERR_NONE && i < data->nb_jobs; ++i){
+		err = virt_uint_64_to_phy_addr(*memory, data->jobs[i].vaddr64, &data->jobs[i].paddr);
+	}
+	if(err == ERR_NONE){
+		page_jobs_skip_overwritten(data);
+		err = page_jobs_load(data, *memory, capacity);
+	}
 
-		if((err = init_phy_addr(&paddr, paddr_32b, 0)) != ERR_NONE) {
-        	fclose(f);
-        	return err;
-    	}
-		if(page_file_read(&paddr, filename, *memory, *mem_capacity_in_bytes) != ERR_NONE) {
-      		fclose(f);
-     		return ERR_IO;
-    	}
-  	}
-
-  /*** WRITE DATA PAGES ***/
-	while(fscanf(f, "%lx %s", &vaddr64, filename) == 2 && !feof(f)) {
-		if((err = virt_uint_64_to_phy_addr(*memory, vaddr64, &paddr)) != ERR_NONE) {
-      		fclose(f);
-      		return err;
-    	}
-		if(page_file_read(&paddr, filename, *memory, *mem_capacity_in_bytes) != ERR_NONE) {
-      		fclose(f);
-      		return ERR_IO;
-    	}
+	if(err != ERR_NONE){
+		mem_release(*memory, *mem_capacity_in_bytes);
+		*memory = NULL;
 	}
-	fclose(f);
-	return ERR_NONE;
+	return err;
 }
 
 /**
@@ -332,7 +680,7 @@ static int page_file_read(
 	M_REQUIRE((phy_addr_32b & MAX_12BIT_VALUE) == 0, ERR_ADDR, "%s", "Address should be aligned with the beggining of the page");
 
 	//Check that it fits in allocated memory from given address
-	if(phy_addr_32b + PAGE_SIZE <= mem_capacity_in_bytes){
+	if((size_t) phy_addr_32b + PAGE_SIZE <= mem_capacity_in_bytes){
 		//Read the page_file and write it in memory
 		bytes_read = fread(&((byte_t*)memory)[phy_addr_32b], 1, PAGE_SIZE, page_file);
 	}else{
@@ -345,3 +693,683 @@ static int page_file_read(
 
 	return ERR_NONE;
 }
+
+// ======================================================================
+#define MEM_IMAGE_MAGIC "PPSMIMG"
+#define MEM_IMAGE_MAGIC_SIZE 8 // including the final '\0'
+#define MEM_IMAGE_VERSION 1u
+#define MEM_IMAGE_MAX_RUNS 4096 // above that many runs of pages, payloads are copied rather than mapped
+
+typedef struct {
+	char magic[MEM_IMAGE_MAGIC_SIZE];
+	uint32_t version;
+	uint32_t page_size;
+	uint64_t mem_capacity; // in bytes
+	uint64_t nb_sources; // number of mem_image_source_t following the header
+	uint64_t nb_pages; // number of directory entries (uint32_t) following the sources
+	uint64_t payload_offset; // page-aligned start of the payloads, in the same order as the directory
+	uint64_t reserved[2]; // always 0
+} mem_image_header_t;
+
+typedef struct {
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	int64_t size;
+	char name[MAX_FILENAME_SIZE];
+} mem_image_source_t;
+
+_Static_assert(sizeof(mem_image_header_t) == 64, "unexpected memory image header size");
+
+typedef struct {
+	const mem_image_header_t* header; // points into the mapped image (read-only)
+	const mem_image_source_t* sources;
+	const uint32_t* directory; // physical page numbers, increasing
+	void* map_start;
+	size_t map_size;
+} mem_image_t;
+
+/**
+ * @brief Builds the default image name of a description if none is given
+ * @param master_filename the description file name
+ * @param image_filename the image file name given, or NULL
+ * @param buffer (modified) where to build the default name
+ * @return the image name, NULL if too long
+ */
+static const char* image_name(const char* master_filename, const char* image_filename, char buffer[FILENAME_MAX]){
+	if(image_filename != NULL) return image_filename;
+	const int len = snprintf(buffer, FILENAME_MAX, "%s%s", master_filename, MEM_IMAGE_SUFFIX);
+	return len < 0 || len >= FILENAME_MAX ? NULL : buffer;
+}
+
+/**
+ * @brief Records the name, modification time and size of a file
+ * @param source (modified) the record
+ * @param filename the file
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_source_init(mem_image_source_t* source, const char* filename){
+	memset(source, 0, sizeof(*source));
+	M_REQUIRE(strlen(filename) < MAX_FILENAME_SIZE, ERR_BAD_PARAMETER, "File name too long: %s", filename);
+	strcpy(source->name, filename);
+
+	struct stat st;
+	M_REQUIRE(stat(filename, &st) == 0, ERR_IO, "Cannot stat %s", filename);
+	source->mtime_sec = (int64_t) st.st_mtim.tv_sec;
+	source->mtime_nsec = (int64_t) st.st_mtim.tv_nsec;
+	source->size = (int64_t) st.st_size;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Orders physical page numbers
+ */
+static int frame_cmp(const void* a, const void* b){
+	const uint32_t fa = *(const uint32_t*) a;
+	const uint32_t fb = *(const uint32_t*) b;
+	return fa < fb ? -1 : fa > fb;
+}
+
+/**
+ * @brief Writes an image file: to a temporary file first, renamed once complete
+ * @param image_filename the name of the image file
+ * @param sources the source files to record
+ * @param nb_sources their number
+ * @param memory the memory to take the pages from
+ * @param mem_capacity_in_bytes its size
+ * @param directory the physical page numbers of the pages to write, increasing
+ * @param nb_pages their number
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_file_write(const char* image_filename, const mem_image_source_t* sources, size_t nb_sources,
+                            const void* memory, size_t mem_capacity_in_bytes,
+                            const uint32_t* directory, size_t nb_pages){
+	char tmp_filename[FILENAME_MAX];
+	const int len = snprintf(tmp_filename, sizeof(tmp_filename), "%s.%ld.tmp", image_filename, (long) getpid());
+	M_REQUIRE(len > 0 && len < FILENAME_MAX, ERR_BAD_PARAMETER, "Image file name too long: %s", image_filename);
+
+	mem_image_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MEM_IMAGE_MAGIC, MEM_IMAGE_MAGIC_SIZE);
+	header.version = MEM_IMAGE_VERSION;
+	header.page_size = PAGE_SIZE;
+	header.mem_capacity = mem_capacity_in_bytes;
+	header.nb_sources = nb_sources;
+	header.nb_pages = nb_pages;
+	const size_t meta_size = sizeof(header) + nb_sources * sizeof(mem_image_source_t) + nb_pages * sizeof(uint32_t);
+	header.payload_offset = (meta_size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+
+	FILE* output = fopen(tmp_filename, "wb");
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(output, ERR_IO);
+
+	static const byte_t padding[PAGE_SIZE];
+	int err = ERR_NONE;
+	if(fwrite(&header, sizeof(header), 1, output) != 1
+	   || (nb_sources != 0 && fwrite(sources, sizeof(mem_image_source_t), nb_sources, output) != nb_sources)
+	   || (nb_pages != 0 && fwrite(directory, sizeof(uint32_t), nb_pages, output) != nb_pages)
+	   || fwrite(padding, 1, header.payload_offset - meta_size, output) != header.payload_offset - meta_size){
+		err = ERR_IO;
+	}
+	for(size_t i = 0; err == ERR_NONE && i < nb_pages; ++i){
+		if(fwrite((const byte_t*) memory + (size_t) directory[i] * PAGE_SIZE, PAGE_SIZE, 1, output) != 1) err = ERR_IO;
+	}
+
+	if(fclose(output) != 0 && err == ERR_NONE) err = ERR_IO;
+	if(err == ERR_NONE && rename(tmp_filename, image_filename) != 0) err = ERR_IO;
+	if(err != ERR_NONE) remove(tmp_filename);
+	return err;
+}
+
+/**
+ * @brief Writes the image of a memory built from a description
+ * @param image_filename the name of the image file
+ * @param master_filename the description file name
+ * @param memory the memory built from the description
+ * @param mem_capacity_in_bytes its size
+ * @param jobs the translation pages and the data pages it was built from
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_write(const char* image_filename, const char* master_filename,
+                       const void* memory, size_t mem_capacity_in_bytes, const page_jobs_t jobs[2]){
+	const size_t nb_jobs = jobs[0].nb_jobs + jobs[1].nb_jobs;
+	mem_image_source_t* sources = calloc(nb_jobs + 1, sizeof(mem_image_source_t));
+	uint32_t* directory = calloc(nb_jobs + 1, sizeof(uint32_t)); // + 1: never calloc(0)
+	int err = sources == NULL || directory == NULL ? ERR_MEM : ERR_NONE;
+
+	// sources: the description, then every page file; directory: every page written, once
+	size_t nb_pages = 0;
+	if(err == ERR_NONE) err = image_source_init(&sources[0], master_filename);
+	for(int l = 0; l < 2; ++l){
+		for(size_t i = 0; err == ERR_NONE && i < jobs[l].nb_jobs; ++i){
+			const page_job_t* job = &jobs[l].jobs[i];
+			err = image_source_init(&sources[1 + (l == 0 ? 0 : jobs[0].nb_jobs) + i], job->filename);
+			directory[nb_pages++] = job->paddr.phy_page_num;
+		}
+	}
+	if(err == ERR_NONE){
+		qsort(directory, nb_pages, sizeof(uint32_t), frame_cmp);
+		size_t unique = 0;
+		for(size_t i = 0; i < nb_pages; ++i){
+			if(unique == 0 || directory[unique - 1] != directory[i]) directory[unique++] = directory[i];
+		}
+		nb_pages = unique;
+		err = image_file_write(image_filename, sources, nb_jobs + 1, memory, mem_capacity_in_bytes, directory, nb_pages);
+	}
+
+	free(sources);
+	free(directory);
+	return err;
+}
+
+// ======================================================================
+int mem_image_compile(const char* master_filename, const char* image_filename){
+	M_REQUIRE_NON_NULL(master_filename);
+
+	char default_name[FILENAME_MAX];
+	image_filename = image_name(master_filename, image_filename, default_name);
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(image_filename, ERR_BAD_PARAMETER);
+
+	void* memory = NULL;
+	size_t mem_capacity_in_bytes = 0;
+	page_jobs_t jobs[2] = {{NULL, 0, 0}, {NULL, 0, 0}}; // translation and data pages
+	int err = description_load(master_filename, &memory, &mem_capacity_in_bytes, &jobs[0], &jobs[1]);
+	if(err == ERR_NONE) err = image_write(image_filename, master_filename, memory, mem_capacity_in_bytes, jobs);
+
+	mem_release(memory, mem_capacity_in_bytes);
+	free(jobs[0].jobs);
+	free(jobs[1].jobs);
+	return err;
+}
+
+/**
+ * @brief Maps an image file (read-only), checking it is a consistent image
+ * @param fd the opened image file
+ * @param image (modified) the mapped image; to be unmapped if ERR_NONE
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_map(int fd, mem_image_t* image){
+	memset(image, 0, sizeof(*image));
+
+	struct stat st;
+	M_REQUIRE(fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(mem_image_header_t), ERR_IO,
+	          "%s", "File too small to be a memory image");
+	const size_t map_size = (size_t) st.st_size;
+	void* map_start = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	M_REQUIRE(map_start != MAP_FAILED, ERR_MEM, "%s", "Cannot map memory image");
+
+	const mem_image_header_t* header = map_start;
+	const uint64_t max_sources = (map_size - sizeof(*header)) / sizeof(mem_image_source_t);
+	int valid = memcmp(header->magic, MEM_IMAGE_MAGIC, MEM_IMAGE_MAGIC_SIZE) == 0
+	            && header->version == MEM_IMAGE_VERSION
+	            && header->page_size == PAGE_SIZE
+	            && header->mem_capacity <= MEM_MAX_CAPACITY
+	            && header->nb_sources <= max_sources
+	            && header->nb_pages <= header->mem_capacity / PAGE_SIZE
+	            && header->payload_offset % PAGE_SIZE == 0
+	            && header->payload_offset >= sizeof(*header) + header->nb_sources * sizeof(mem_image_source_t)
+	                                         + header->nb_pages * sizeof(uint32_t)
+	            && header->payload_offset <= map_size
+	            && header->nb_pages <= (map_size - header->payload_offset) / PAGE_SIZE;
+
+	const mem_image_source_t* sources = (const mem_image_source_t*) (header + 1);
+	const uint32_t* directory = (const uint32_t*) (sources + (valid ? header->nb_sources : 0));
+	for(uint64_t i = 0; valid && i < header->nb_pages; ++i){
+		valid = directory[i] < header->mem_capacity / PAGE_SIZE && (i == 0 || directory[i - 1] < directory[i]);
+	}
+	if(!valid){
+		munmap(map_start, map_size);
+		M_EXIT(ERR_IO, "%s", "Invalid memory image");
+	}
+
+	image->header = header;
+	image->sources = sources;
+	image->directory = directory;
+	image->map_start = map_start;
+	image->map_size = map_size;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Tells whether the source files of an image are the ones it was compiled from
+ * @param image the mapped image
+ * @return 1 if all the sources are unchanged, 0 otherwise
+ */
+static int image_fresh(const mem_image_t* image){
+	for(uint64_t i = 0; i < image->header->nb_sources; ++i){
+		const mem_image_source_t* source = &image->sources[i];
+		struct stat st;
+		if(memchr(source->name, '\0', MAX_FILENAME_SIZE) == NULL
+		   || stat(source->name, &st) != 0
+		   || (int64_t) st.st_mtim.tv_sec != source->mtime_sec
+		   || (int64_t) st.st_mtim.tv_nsec != source->mtime_nsec
+		   || (int64_t) st.st_size != source->size){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Writes the pages of a mapped image into a memory: runs of consecutive pages
+ * are mapped privately from the image file when the memory is itself mapped, copied otherwise.
+ * @param fd the opened image file (for mapping payloads)
+ * @param image the mapped image
+ * @param memory (modified) the memory; undefined on error
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_apply(int fd, const mem_image_t* image, void* memory){
+	const mem_image_header_t* header = image->header;
+
+	// a run is a range of consecutive pages, both in memory and in the image
+	size_t nb_runs = 0;
+	for(uint64_t i = 0; i < header->nb_pages; ++i){
+		nb_runs += i == 0 || image->directory[i - 1] + 1 != image->directory[i];
+	}
+
+	const mem_mapping_t* mapping = mem_mapping_find(memory);
+	const int mapped = mapping != NULL && !mapping->huge && nb_runs <= MEM_IMAGE_MAX_RUNS;
+	const byte_t* payloads = (const byte_t*) image->map_start + header->payload_offset;
+	for(uint64_t i = 0, run = 0; i < header->nb_pages; i = run){
+		for(run = i + 1; run < header->nb_pages && image->directory[run - 1] + 1 == image->directory[run]; ++run);
+
+		byte_t* to = (byte_t*) memory + (size_t) image->directory[i] * PAGE_SIZE;
+		const size_t size = (run - i) * PAGE_SIZE;
+		if(mapped){
+			// replaces that part of the memory; released with it
+			M_REQUIRE(mmap(to, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+			               (off_t) (header->payload_offset + i * PAGE_SIZE)) != MAP_FAILED,
+			          ERR_MEM, "%s", "Cannot map memory image pages");
+		}else{
+			memcpy(to, payloads + i * PAGE_SIZE, size);
+		}
+		mem_written(memory, (uint32_t) (to - (byte_t*) memory), size);
+	}
+	return ERR_NONE;
+}
+
+/**
+ * @brief Creates a memory from a mapped image
+ * @param fd the opened image file (for mapping payloads)
+ * @param image the mapped image
+ * @param memory (modified) the memory created
+ * @param mem_capacity_in_bytes (modified) total size of the created memory
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int image_load(int fd, const mem_image_t* image, void** memory, size_t* mem_capacity_in_bytes){
+	M_EXIT_IF_ERR(mem_init_sparse(image->header->mem_capacity, memory), "Error creating memory");
+	*mem_capacity_in_bytes = image->header->mem_capacity;
+
+	const int err = image_apply(fd, image, *memory);
+	if(err != ERR_NONE){
+		mem_release(*memory, *mem_capacity_in_bytes);
+		*memory = NULL;
+	}
+	return err;
+}
+
+// ======================================================================
+int mem_init_from_image(const char* master_filename, const char* image_filename,
+                        void** memory, size_t* mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(master_filename);
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(mem_capacity_in_bytes);
+
+	*memory = NULL;
+	*mem_capacity_in_bytes = 0;
+	char default_name[FILENAME_MAX];
+	image_filename = image_name(master_filename, image_filename, default_name);
+	M_REQUIRE_NON_NULL_CUSTOM_ERR(image_filename, ERR_BAD_PARAMETER);
+
+	mem_image_t image;
+	int fd = open(image_filename, O_RDONLY);
+	int usable = fd >= 0 && image_map(fd, &image) == ERR_NONE;
+	if(usable && !image_fresh(&image)){
+		munmap(image.map_start, image.map_size);
+		usable = 0;
+	}
+
+	if(!usable){
+		if(fd >= 0) close(fd);
+		M_EXIT_IF_ERR(mem_image_compile(master_filename, image_filename), "Error compiling memory image");
+		fd = open(image_filename, O_RDONLY);
+		M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", image_filename);
+		if(image_map(fd, &image) != ERR_NONE){
+			close(fd);
+			return ERR_IO;
+		}
+	}
+
+	const int err = image_load(fd, &image, memory, mem_capacity_in_bytes);
+	munmap(image.map_start, image.map_size);
+	close(fd); // the mappings of the payloads keep their own reference on the file
+	return err;
+}
+
+// ======================================================================
+#define BITS_PER_WORD 64
+
+/**
+ * @brief Write observer of a checkpointer: marks the frames written as dirty
+ */
+static void checkpointer_written(void* context, uint32_t paddr, size_t size){
+	mem_checkpointer_t* checkpointer = context;
+	if(size == 0) return;
+
+	const size_t nb_frames = checkpointer->mem_capacity_in_bytes / PAGE_SIZE;
+	const size_t last = ((size_t) paddr + size - 1) / PAGE_SIZE;
+	for(size_t frame = paddr / PAGE_SIZE; frame <= last && frame < nb_frames; ++frame){
+		const uint64_t bit = UINT64_C(1) << (frame % BITS_PER_WORD);
+		uint64_t* word = &checkpointer->dirty[frame / BITS_PER_WORD];
+		if(!(*word & bit)){
+			*word |= bit;
+			++checkpointer->nb_dirty;
+		}
+	}
+}
+
+// ======================================================================
+int mem_checkpointer_init(mem_checkpointer_t* checkpointer, void* memory, size_t mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(checkpointer);
+	M_REQUIRE_NON_NULL(memory);
+
+	memset(checkpointer, 0, sizeof(*checkpointer));
+	const size_t nb_words = mem_capacity_in_bytes / PAGE_SIZE / BITS_PER_WORD + 1;
+	checkpointer->dirty = calloc(nb_words, sizeof(uint64_t));
+	M_EXIT_IF_NULL(checkpointer->dirty, nb_words * sizeof(uint64_t));
+	checkpointer->memory = memory;
+	checkpointer->mem_capacity_in_bytes = mem_capacity_in_bytes;
+
+	const int err = mem_observer_add(memory, checkpointer_written, checkpointer);
+	if(err != ERR_NONE){
+		free(checkpointer->dirty);
+		checkpointer->dirty = NULL;
+	}
+	return err;
+}
+
+// ======================================================================
+int mem_checkpoint(mem_checkpointer_t* checkpointer, const char* filename){
+	M_REQUIRE_NON_NULL(checkpointer);
+	M_REQUIRE_NON_NULL(checkpointer->dirty);
+	M_REQUIRE_NON_NULL(filename);
+
+	uint32_t* directory = malloc((checkpointer->nb_dirty + 1) * sizeof(uint32_t)); // + 1: never malloc(0)
+	M_EXIT_IF_NULL(directory, (checkpointer->nb_dirty + 1) * sizeof(uint32_t));
+
+	// frames in increasing order, as a directory wants them
+	size_t nb_pages = 0;
+	const size_t nb_words = checkpointer->mem_capacity_in_bytes / PAGE_SIZE / BITS_PER_WORD + 1;
+	for(size_t w = 0; w < nb_words; ++w){
+		for(uint64_t bits = checkpointer->dirty[w]; bits != 0; bits &= bits - 1){
+			directory[nb_pages++] = (uint32_t) (w * BITS_PER_WORD + (size_t) __builtin_ctzll(bits));
+		}
+	}
+
+	const int err = image_file_write(filename, NULL, 0, checkpointer->memory, checkpointer->mem_capacity_in_bytes,
+	                                 directory, nb_pages);
+	free(directory);
+	M_EXIT_IF_ERR(err, "Error writing checkpoint");
+
+	memset(checkpointer->dirty, 0, nb_words * sizeof(uint64_t));
+	checkpointer->nb_dirty = 0;
+	++checkpointer->nb_checkpoints;
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_checkpointer_free(mem_checkpointer_t* checkpointer){
+	M_REQUIRE_NON_NULL(checkpointer);
+
+	// the memory may have been released already, taking its observers with it
+	if(checkpointer->memory != NULL) (void) mem_observer_remove(checkpointer->memory, checkpointer_written, checkpointer);
+	free(checkpointer->dirty);
+	memset(checkpointer, 0, sizeof(*checkpointer));
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_restore(void* memory, size_t mem_capacity_in_bytes, const char* filename){
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE_NON_NULL(filename);
+
+	int fd = open(filename, O_RDONLY);
+	M_REQUIRE(fd >= 0, ERR_IO, "Cannot open %s", filename);
+
+	mem_image_t image;
+	int err = image_map(fd, &image);
+	if(err == ERR_NONE){
+		if(image.header->mem_capacity != mem_capacity_in_bytes){
+			debug_print("Checkpoint of a memory of %" PRIu64 " bytes, not %zu", image.header->mem_capacity,
+			            mem_capacity_in_bytes);
+			err = ERR_BAD_PARAMETER;
+		}else{
+			err = image_apply(fd, &image, memory);
+		}
+		munmap(image.map_start, image.map_size);
+	}
+	close(fd); // the mappings of the pages keep their own reference on the file
+	return err;
+}
+
+// ======================================================================
+#define MAX_MAPPED_VADDR (1ull << (VIRT_ADDR - VIRT_ADDR_RES)) // first virtual address page_walk cannot translate
+
+/**
+ * @brief Grows an array of the builder to hold at least nb_elements
+ * @return ERR_NONE if sucessful, ERR_MEM otherwise
+ */
+static int builder_grow(void** array, size_t* allocated, size_t nb_elements, size_t element_size){
+	if(nb_elements <= *allocated) return ERR_NONE;
+
+	size_t grown_size = *allocated == 0 ? 64 : 2 * *allocated;
+	if(grown_size < nb_elements) grown_size = nb_elements;
+	void* grown = realloc(*array, grown_size * element_size);
+	M_EXIT_IF_NULL(grown, grown_size * element_size);
+	*array = grown;
+	*allocated = grown_size;
+	return ERR_NONE;
+}
+
+/**
+ * @brief The entry of a page directory (of any level)
+ */
+static pte_t* builder_entry(const mem_builder_t* builder, uint32_t table, uint64_t vaddr, unsigned shift){
+	return (pte_t*) ((byte_t*) builder->memory + table) + ((vaddr >> shift) & (PD_ENTRIES - 1));
+}
+
+/**
+ * @brief Writes an entry of a page directory
+ */
+static void builder_set(const mem_builder_t* builder, pte_t* entry, pte_t value){
+	*entry = value;
+	mem_written(builder->memory, (uint32_t) ((byte_t*) entry - (byte_t*) builder->memory), sizeof(pte_t));
+}
+
+/**
+ * @brief Finds the page directory of a level translating a virtual address, creating it
+ * (and the ones above) if missing
+ * @param builder (modified) the memory
+ * @param vaddr the virtual address
+ * @param level the level of the page directory (PUD_LEVEL to PTE_LEVEL)
+ * @param table (modified) the physical address of the page directory
+ * @return ERR_NONE if sucessful, appropriate error code otherwise
+ */
+static int builder_table(mem_builder_t* builder, uint64_t vaddr, page_level_t level, uint32_t* table){
+	static const unsigned SHIFTS[] = {
+		PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY, // PGD entry
+		PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY, // PUD entry
+		PAGE_OFFSET + PTE_ENTRY // PMD entry
+	};
+
+	*table = 0; // PGD
+	for(page_level_t above = PGD_LEVEL; above < level; ++above){
+		pte_t* entry = builder_entry(builder, *table, vaddr, SHIFTS[above]);
+		M_REQUIRE(!page_entry_is_large(above, *entry), ERR_ADDR,
+		          "Virtual address 0x%" PRIX64 " already mapped by a large page", vaddr);
+		if(*entry == 0){
+			M_EXIT_IF_ERR(builder_grow((void**) &builder->tables, &builder->allocated_tables,
+			                           builder->nb_tables + 1, sizeof(uint32_t)), "Error growing tables");
+			uint32_t next;
+			M_EXIT_IF_ERR(mem_frame_alloc(builder, &next), "Error allocating a translation page");
+			builder->tables[builder->nb_tables++] = next;
+			builder_set(builder, entry, next);
+		}
+		*table = *entry;
+	}
+	return ERR_NONE;
+}
+
+/**
+ * @brief Finds the PTE page of a virtual address, creating it (and the PUD and PMD pages) if missing
+ */
+static int builder_pte_page(mem_builder_t* builder, uint64_t vaddr, uint32_t* pte){
+	return builder_table(builder, vaddr, PTE_LEVEL, pte);
+}
+
+/**
+ * @brief Records a new mapping (the arrays shall already be large enough)
+ */
+static void builder_record(mem_builder_t* builder, uint64_t vaddr, uint32_t paddr){
+	builder->data_vaddr[builder->nb_data] = vaddr;
+	builder->data_paddr[builder->nb_data] = paddr;
+	++builder->nb_data;
+}
+
+/**
+ * @brief Grows the arrays of mappings to hold nb_more more
+ */
+static int builder_reserve_data(mem_builder_t* builder, size_t nb_more){
+	size_t allocated = builder->allocated_data;
+	M_EXIT_IF_ERR(builder_grow((void**) &builder->data_vaddr, &allocated, builder->nb_data + nb_more, sizeof(uint64_t)),
+	              "Error growing mappings");
+	allocated = builder->allocated_data;
+	M_EXIT_IF_ERR(builder_grow((void**) &builder->data_paddr, &allocated, builder->nb_data + nb_more, sizeof(uint32_t)),
+	              "Error growing mappings");
+	builder->allocated_data = allocated;
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_builder_init(mem_builder_t* builder, size_t mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(builder);
+	M_REQUIRE(mem_capacity_in_bytes >= PAGE_SIZE, ERR_BAD_PARAMETER, "%s", "Memory too small for a PGD");
+
+	memset(builder, 0, sizeof(*builder));
+	M_EXIT_IF_ERR(mem_init_sparse(mem_capacity_in_bytes, &builder->memory), "Error creating memory");
+	builder->mem_capacity_in_bytes = mem_capacity_in_bytes;
+
+	uint32_t pgd;
+	return mem_frame_alloc(builder, &pgd); // at physical address 0
+}
+
+// ======================================================================
+int mem_frame_alloc(mem_builder_t* builder, uint32_t* paddr){
+	M_REQUIRE_NON_NULL(builder);
+	M_REQUIRE_NON_NULL(paddr);
+	M_REQUIRE((builder->nb_frames + 1) * PAGE_SIZE <= builder->mem_capacity_in_bytes, ERR_MEM, "%s",
+	          "Physical memory is full");
+
+	// the memory is all zeros until written: frames need no clearing
+	*paddr = (uint32_t) (builder->nb_frames * PAGE_SIZE);
+	++builder->nb_frames;
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_map_page(mem_builder_t* builder, uint64_t vaddr, uint32_t paddr){
+	M_REQUIRE_NON_NULL(builder);
+	M_REQUIRE((vaddr & MAX_12BIT_VALUE) == 0 && vaddr < MAX_MAPPED_VADDR, ERR_ADDR,
+	          "Invalid virtual page address 0x%" PRIX64, vaddr);
+	M_REQUIRE((paddr & MAX_12BIT_VALUE) == 0 && (size_t) paddr + PAGE_SIZE <= builder->mem_capacity_in_bytes, ERR_ADDR,
+	          "Invalid physical page address 0x%" PRIX32, paddr);
+
+	M_EXIT_IF_ERR(builder_reserve_data(builder, 1), "Error growing mappings");
+	uint32_t pte;
+	M_EXIT_IF_ERR(builder_pte_page(builder, vaddr, &pte), "Error building page tables");
+	pte_t* entry = builder_entry(builder, pte, vaddr, PAGE_OFFSET);
+	M_REQUIRE(*entry == 0, ERR_ADDR, "Virtual page 0x%" PRIX64 " already mapped", vaddr);
+
+	builder_set(builder, entry, paddr);
+	builder_record(builder, vaddr, paddr);
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_map_range(mem_builder_t* builder, uint64_t vaddr, uint64_t size){
+	M_REQUIRE_NON_NULL(builder);
+	M_REQUIRE((vaddr & MAX_12BIT_VALUE) == 0 && (size & MAX_12BIT_VALUE) == 0, ERR_ADDR, "%s",
+	          "Range should be made of whole pages");
+	M_REQUIRE(vaddr <= MAX_MAPPED_VADDR && size <= MAX_MAPPED_VADDR - vaddr, ERR_ADDR,
+	          "Range 0x%" PRIX64 "+0x%" PRIX64 " cannot be translated", vaddr, size);
+
+	// never more mappings than pages in the range, nor than frames left
+	const uint64_t nb_pages = size / PAGE_SIZE;
+	const size_t frames_left = builder->mem_capacity_in_bytes / PAGE_SIZE - builder->nb_frames;
+	M_EXIT_IF_ERR(builder_reserve_data(builder, nb_pages < frames_left ? (size_t) nb_pages : frames_left),
+	              "Error growing mappings");
+
+	uint32_t pte = 0;
+	for(uint64_t page = vaddr; page < vaddr + size; page += PAGE_SIZE){
+		// a new PTE page every PD_ENTRIES pages only
+		if(page == vaddr || ((page >> PAGE_OFFSET) & (PD_ENTRIES - 1)) == 0){
+			M_EXIT_IF_ERR(builder_pte_page(builder, page, &pte), "Error building page tables");
+		}
+
+		pte_t* entry = builder_entry(builder, pte, page, PAGE_OFFSET);
+		if(*entry != 0) continue; // already mapped
+
+		uint32_t frame;
+		M_EXIT_IF_ERR(mem_frame_alloc(builder, &frame), "Error allocating a data page");
+		builder_set(builder, entry, frame);
+		builder_record(builder, page, frame);
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_map_range_sized(mem_builder_t* builder, uint64_t vaddr, uint64_t size, page_size_t page_size){
+	M_REQUIRE_NON_NULL(builder);
+	M_REQUIRE(page_size <= PAGE_1G, ERR_BAD_PARAMETER, "Invalid page size %d", (int) page_size);
+
+	const uint64_t large_size = UINT64_C(1) << PAGE_SIZE_BITS(page_size);
+	M_REQUIRE(vaddr % large_size == 0 && size <= MAX_MAPPED_VADDR, ERR_ADDR, "%s", "Range should start on a page");
+	size = (size + large_size - 1) / large_size * large_size;
+	if(page_size == PAGE_4K) return mem_map_range(builder, vaddr, size);
+	M_REQUIRE(vaddr <= MAX_MAPPED_VADDR && size <= MAX_MAPPED_VADDR - vaddr, ERR_ADDR,
+	          "Range 0x%" PRIX64 "+0x%" PRIX64 " cannot be translated", vaddr, size);
+
+	const page_level_t level = PTE_LEVEL - page_size; // of the page directories holding the entries
+	const size_t nb_frames = (size_t) (large_size / PAGE_SIZE);
+	for(uint64_t page = vaddr; page < vaddr + size; page += large_size){
+		uint32_t table;
+		M_EXIT_IF_ERR(builder_table(builder, page, level, &table), "Error building page tables");
+		pte_t* entry = builder_entry(builder, table, page, PAGE_SIZE_BITS(page_size));
+		if(page_entry_is_large(level, *entry)) continue; // already mapped
+		M_REQUIRE(*entry == 0, ERR_ADDR, "Virtual page 0x%" PRIX64 " already mapped by smaller pages", page);
+
+		// the frames of the page: the next ones aligned on its size
+		const size_t first = (builder->nb_frames + nb_frames - 1) / nb_frames * nb_frames;
+		M_REQUIRE((first + nb_frames) * PAGE_SIZE <= builder->mem_capacity_in_bytes, ERR_MEM, "%s",
+		          "Physical memory is full");
+		M_EXIT_IF_ERR(builder_reserve_data(builder, nb_frames), "Error growing mappings");
+		builder->nb_frames = first + nb_frames;
+
+		const uint32_t paddr = (uint32_t) (first * PAGE_SIZE);
+		builder_set(builder, entry, paddr | PTE_LARGE_PAGE);
+		for(size_t frame = 0; frame < nb_frames; ++frame){
+			builder_record(builder, page + frame * PAGE_SIZE, paddr + (uint32_t) (frame * PAGE_SIZE));
+		}
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+int mem_builder_free(mem_builder_t* builder){
+	M_REQUIRE_NON_NULL(builder);
+
+	const int err = mem_release(builder->memory, builder->mem_capacity_in_bytes);
+	free(builder->tables);
+	free(builder->data_vaddr);
+	free(builder->data_paddr);
+	memset(builder, 0, sizeof(*builder));
+	return err;
+}
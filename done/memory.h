@@ -10,6 +10,7 @@
 
 #include "addr.h"   // for virt_addr_t
 #include <stdlib.h> // for size_t and free()
+#include <stdint.h> // for uint32_t, uint64_t
 
 /**
  * @brief enum type to describe how to print address;
@@ -41,6 +42,156 @@ typedef enum addr_fmt addr_fmt_t;
 
 int mem_init_from_dumpfile(const char* filename, void** memory, size_t* mem_capacity_in_bytes);
 
+/**
+ * @brief Same as mem_init_from_dumpfile(), but without copying the dump: the file is
+ * mapped in memory, privately (the simulation writes to its own copy-on-write pages,
+ * never to the file). Pages are read from the file when first touched only, and are
+ * shared (through the page cache) with all the other runs on the same dump.
+ * Falls back to mem_init_from_dumpfile() if the file cannot be mapped.
+ *
+ * @param filename the name of the memory dump file to map
+ * @param memory (modified) pointer to the begining of the memory
+ * @param mem_capacity_in_bytes (modified) total size of the created memory
+ * @return error code, *memory shall be NULL in case of error
+ *
+ */
+
+int mem_init_from_dumpfile_mapped(const char* filename, void** memory, size_t* mem_capacity_in_bytes);
+
+
+#define MEM_MAX_CAPACITY ((size_t) 1 << 32) // physical addresses are 32-bit
+
+/**
+ * @brief Create an empty (all zeros) memory space. Its pages only take physical
+ * memory once written to, so that huge (up to MEM_MAX_CAPACITY) and sparsely used
+ * memory spaces are cheap. Memories created from a description are sparse.
+ *
+ * @param mem_capacity_in_bytes total size of the memory to create
+ * @param memory (modified) pointer to the begining of the memory
+ * @return error code
+ *
+ */
+
+int mem_init_sparse(size_t mem_capacity_in_bytes, void** memory);
+
+
+/**
+ * @brief How the memories created from now on are backed:
+ *  MEM_HUGE_NONE:        small (4 kiB) pages, the default;
+ *  MEM_HUGE_TRANSPARENT: 2 MiB-aligned memory the kernel is advised to back with
+ *                        transparent huge pages (small pages where it cannot);
+ *  MEM_HUGE_TLB:         huge pages from the pool of the system (hugetlbfs), reserved
+ *                        at once; transparent huge pages if the pool cannot hold it.
+ * Huge pages cut the misses in the TLB of the host on large memories, at the cost of
+ * making whole 2 MiB pages resident. Memory dumps are then copied, not mapped.
+ */
+typedef enum {
+	MEM_HUGE_NONE,
+	MEM_HUGE_TRANSPARENT,
+	MEM_HUGE_TLB
+} mem_huge_pages_t;
+
+#define MEM_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+/**
+ * @brief Choose how the memories created from now on are backed (see mem_huge_pages_t).
+ *
+ * @param huge_pages the kind of pages to use
+ *
+ */
+
+void mem_set_huge_pages(mem_huge_pages_t huge_pages);
+
+
+/**
+ * @brief Tell how much of a memory space actually is on huge pages.
+ *
+ * @param memory the memory space
+ * @param mem_capacity_in_bytes its total size
+ * @param huge (modified) the number of bytes on huge pages (0 if none asked for)
+ * @return error code
+ *
+ */
+
+int mem_huge_size(const void* memory, size_t mem_capacity_in_bytes, size_t* huge);
+
+
+/**
+ * @brief Tell how much of a memory space actually is in physical memory.
+ *
+ * @param memory the memory space
+ * @param mem_capacity_in_bytes its total size
+ * @param resident (modified) the number of bytes (whole pages) in physical memory
+ * @return error code
+ *
+ */
+
+int mem_resident_size(const void* memory, size_t mem_capacity_in_bytes, size_t* resident);
+
+
+/**
+ * @brief Release a memory space created by any of the mem_init_*() functions
+ * (which may not have been allocated by malloc(): do not free() it directly).
+ *
+ * @param memory the memory to release (nothing is done if NULL)
+ * @param mem_capacity_in_bytes its total size, as returned by mem_init_*()
+ * @return error code
+ *
+ */
+
+int mem_release(void* memory, size_t mem_capacity_in_bytes);
+
+
+/**
+ * @brief Function called on every write to a memory space (see mem_written()).
+ * @param context the context given when registering the observer
+ * @param paddr the physical address of the first byte written
+ * @param size the number of bytes written
+ */
+typedef void (*mem_write_observer_t)(void* context, uint32_t paddr, size_t size);
+
+#define MEM_MAX_OBSERVERS 8
+
+/**
+ * @brief Register a function to be called on every write to a memory space.
+ *
+ * @param memory the memory space to observe
+ * @param observer the function to call
+ * @param context passed to observer
+ * @return error code, ERR_MEM if there already are MEM_MAX_OBSERVERS observers
+ *
+ */
+
+int mem_observer_add(const void* memory, mem_write_observer_t observer, void* context);
+
+
+/**
+ * @brief Unregister an observer added with mem_observer_add() (observers of a memory
+ * are also removed when it is released).
+ *
+ * @param memory the memory space observed
+ * @param observer the function registered
+ * @param context the context it was registered with
+ * @return error code, ERR_BAD_PARAMETER if no such observer
+ *
+ */
+
+int mem_observer_remove(const void* memory, mem_write_observer_t observer, void* context);
+
+
+/**
+ * @brief Tell the observers of a memory space that it was written to. To be called
+ * by whatever writes to a memory once it is created (the write-through paths of
+ * the caches, the builder, ...). Cheap when no observer is registered.
+ *
+ * @param memory the memory space written to
+ * @param paddr the physical address of the first byte written
+ * @param size the number of bytes written
+ *
+ */
+
+void mem_written(const void* memory, uint32_t paddr, size_t size);
+
 
 /**
  * @brief Create and initialize the whole memory space from a provided
@@ -64,6 +215,209 @@ int mem_init_from_dumpfile(const char* filename, void** memory, size_t* mem_capa
 int mem_init_from_description(const char* master_filename, void** memory, size_t* mem_capacity_in_bytes);
 
 
+#define MEM_IMAGE_SUFFIX ".img" // default image of a description: its name with this suffix
+
+/**
+ * @brief Compile a memory description (see mem_init_from_description()) and all the
+ * page files it lists into a single image file: a header, the list of the source files
+ * (with their modification time and size), a page directory (sorted physical page
+ * numbers) and the page payloads, page-aligned in the file.
+ * The image is written to a temporary file first, and renamed once complete, so that
+ * concurrent runs always see a whole image.
+ *
+ * @param master_filename the name of the memory content description file
+ * @param image_filename the name of the image to write, NULL for master_filename + MEM_IMAGE_SUFFIX
+ * @return error code
+ *
+ */
+
+int mem_image_compile(const char* master_filename, const char* image_filename);
+
+
+/**
+ * @brief Create the memory space described by a description file from its image,
+ * (re)compiling the image first if it is missing, invalid, or older than any of its
+ * source files (different modification time or size).
+ * The page payloads are mapped privately from the image (copy-on-write) when possible.
+ *
+ * @param master_filename the name of the memory content description file
+ * @param image_filename the name of the image, NULL for master_filename + MEM_IMAGE_SUFFIX
+ * @param memory (modified) pointer to the begining of the memory
+ * @param mem_capacity_in_bytes (modified) total size of the created memory
+ * @return error code, *memory shall be NULL in case of error
+ *
+ */
+
+int mem_init_from_image(const char* master_filename, const char* image_filename,
+                        void** memory, size_t* mem_capacity_in_bytes);
+
+
+/**
+ * @brief A memory under construction: page tables are built by mapping virtual pages,
+ * instead of being read from (hand-made) page files.
+ * Frames are allocated in order, the PGD being the first one (physical address 0):
+ * the memory actually used is nb_frames * PAGE_SIZE bytes.
+ */
+typedef struct {
+	void* memory; // the memory space (sparse), usable as soon as the builder is initialized
+	size_t mem_capacity_in_bytes;
+	size_t nb_frames; // number of frames allocated so far
+	uint32_t* tables; // physical addresses of the translation pages (PGD excepted), in allocation order
+	size_t nb_tables;
+	size_t allocated_tables;
+	uint64_t* data_vaddr; // virtual addresses of the pages mapped...
+	uint32_t* data_paddr; // ...and their physical addresses, in mapping order
+	size_t nb_data;
+	size_t allocated_data;
+} mem_builder_t;
+
+/**
+ * @brief Create an empty memory: a PGD with no mapping.
+ *
+ * @param builder (modified) the builder to initialize
+ * @param mem_capacity_in_bytes the size of the memory to build (at most MEM_MAX_CAPACITY)
+ * @return error code
+ *
+ */
+
+int mem_builder_init(mem_builder_t* builder, size_t mem_capacity_in_bytes);
+
+
+/**
+ * @brief Allocate a (zeroed) frame of the memory.
+ *
+ * @param builder (modified) the memory to allocate in
+ * @param paddr (modified) the physical address of the new frame
+ * @return error code, ERR_MEM if the memory is full
+ *
+ */
+
+int mem_frame_alloc(mem_builder_t* builder, uint32_t* paddr);
+
+
+/**
+ * @brief Map a virtual page to a frame, creating the missing PUD, PMD and PTE pages.
+ *
+ * @param builder (modified) the memory to map the page in
+ * @param vaddr the (page-aligned) virtual address of the page
+ * @param paddr the (page-aligned) physical address of the frame
+ * @return error code, ERR_ADDR if the page is already mapped
+ *
+ */
+
+int mem_map_page(mem_builder_t* builder, uint64_t vaddr, uint32_t paddr);
+
+
+/**
+ * @brief Map a whole range of virtual pages to newly allocated frames (pages already
+ * mapped are left as they are). Each PTE page is looked up only once.
+ *
+ * @param builder (modified) the memory to map the pages in
+ * @param vaddr the (page-aligned) virtual address of the range
+ * @param size the (page-aligned) size of the range, in bytes
+ * @return error code
+ *
+ */
+
+int mem_map_range(mem_builder_t* builder, uint64_t vaddr, uint64_t size);
+
+
+/**
+ * @brief Map a whole range of virtual addresses with pages of a given size: large
+ * pages are entries of PMD (2 MiB) or PUD (1 GiB) pages with PTE_LARGE_PAGE set,
+ * mapping contiguous frames aligned on their size (the frames skipped to align them
+ * stay unused). Each frame is recorded as a mapped page.
+ *
+ * @param builder (modified) the memory to map the pages in
+ * @param vaddr the virtual address of the range (aligned on the page size)
+ * @param size the size of the range, in bytes (rounded up to whole pages)
+ * @param page_size the size of the pages (PAGE_4K is as mem_map_range())
+ * @return error code, ERR_ADDR if part of a large page is already mapped by smaller pages
+ * (large pages already mapped are left as they are)
+ *
+ */
+
+int mem_map_range_sized(mem_builder_t* builder, uint64_t vaddr, uint64_t size, page_size_t page_size);
+
+
+/**
+ * @brief Release a builder and the memory it built.
+ *
+ * @param builder (modified) the builder to release
+ * @return error code
+ *
+ */
+
+int mem_builder_free(mem_builder_t* builder);
+
+
+/**
+ * @brief Incremental checkpoints of a memory space: the frames written since the
+ * last checkpoint (or since the checkpointer was initialized) are tracked in a
+ * bitmap, through mem_written(), and only those are saved.
+ * A checkpoint file has the format of a memory image (see mem_image_compile()),
+ * with no source file: the chain of the checkpoints of a run, restored in order
+ * on the memory the run started from, gives back the memory at the last checkpoint.
+ */
+typedef struct {
+	void* memory;
+	size_t mem_capacity_in_bytes;
+	uint64_t* dirty; // one bit per frame, set when written since the last checkpoint
+	size_t nb_dirty; // number of bits set
+	uint64_t nb_checkpoints;
+} mem_checkpointer_t;
+
+/**
+ * @brief Start tracking the writes to a memory space (nothing is dirty yet).
+ *
+ * @param checkpointer (modified) the checkpointer to initialize
+ * @param memory the memory space to checkpoint
+ * @param mem_capacity_in_bytes its total size
+ * @return error code
+ *
+ */
+
+int mem_checkpointer_init(mem_checkpointer_t* checkpointer, void* memory, size_t mem_capacity_in_bytes);
+
+
+/**
+ * @brief Save the frames written since the last checkpoint, and clear the dirty bitmap.
+ *
+ * @param checkpointer (modified) the checkpointer
+ * @param filename the name of the checkpoint file to write
+ * @return error code
+ *
+ */
+
+int mem_checkpoint(mem_checkpointer_t* checkpointer, const char* filename);
+
+
+/**
+ * @brief Stop tracking the writes and release the checkpointer (not the memory).
+ *
+ * @param checkpointer (modified) the checkpointer to release
+ * @return error code
+ *
+ */
+
+int mem_checkpointer_free(mem_checkpointer_t* checkpointer);
+
+
+/**
+ * @brief Restore a checkpoint (or any memory image) on a memory space: its pages are
+ * mapped privately from the file when possible, copied otherwise. Restored pages are
+ * reported to the observers of the memory, as any write.
+ *
+ * @param memory (modified) the memory space; undefined on error
+ * @param mem_capacity_in_bytes its total size, which must be the one of the checkpoint
+ * @param filename the name of the checkpoint file
+ * @return error code
+ *
+ */
+
+int mem_restore(void* memory, size_t mem_capacity_in_bytes, const char* filename);
+
+
 /**
  * @brief Prints the content of one page from its virtual address.
  * It prints the content reading it as 32 bits integers.
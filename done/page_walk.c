@@ -6,41 +6,79 @@
  * @date 2019
  */
 
+#include "page_walk.h"
 #include "addr.h"
 #include "addr_mng.h"
 #include "error.h"
 
+#include <inttypes.h> // for PRIX32
+
 #define PGD_START 0
 static inline pte_t read_page_entry(const pte_t * start, pte_t page_start, uint16_t index);
 
 int page_walk(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr) {
+	return page_walk_sized(mem_space, vaddr, paddr, NULL);
+}
 
-	M_REQUIRE_NON_NULL(mem_space);
+int page_walk_sized(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr, page_size_t* size) {
 	M_REQUIRE_NON_NULL(vaddr);
+	return page_walk64_sized(mem_space, virt_addr64_pack(vaddr), paddr, size);
+}
+
+int page_walk64(const void* mem_space, virt_addr64_t vaddr, phy_addr_t* paddr) {
+	return page_walk64_sized(mem_space, vaddr, paddr, NULL);
+}
+
+int page_walk64_sized(const void* mem_space, virt_addr64_t vaddr, phy_addr_t* paddr, page_size_t* size) {
+
+	M_REQUIRE_NON_NULL(mem_space);
 	M_REQUIRE_NON_NULL(paddr);
 
 	//initialized to the beginning of addressed space
 	pte_t walker = PGD_START;
 
 	//get PUD entry from PGD
-	walker = read_page_entry(mem_space, walker, vaddr->pgd_entry);
+	walker = read_page_entry(mem_space, walker, virt_addr64_pgd_entry(vaddr));
 	M_REQUIRE(walker != 0, ERR_ADDR, "%s", "Mem space probably not initialized");
 	
-	//get PMD entry from PUD
-	walker = read_page_entry(mem_space, walker, vaddr->pud_entry);
+	//get PMD entry from PUD (or a 1 GiB page)
+	walker = read_page_entry(mem_space, walker, virt_addr64_pud_entry(vaddr));
 	M_REQUIRE(walker != 0, ERR_ADDR, "%s", "Mem space probably not initialized");
+	if(walker & PTE_LARGE_PAGE) return page_leaf_addr(PUD_LEVEL, walker, vaddr, paddr, size);
 
-	//get PTE entry from PMD
-	walker = read_page_entry(mem_space, walker, vaddr->pmd_entry);
+	//get PTE entry from PMD (or a 2 MiB page)
+	walker = read_page_entry(mem_space, walker, virt_addr64_pmd_entry(vaddr));
 	M_REQUIRE(walker != 0, ERR_ADDR, "%s", "Mem space probably not initialized");
+	if(walker & PTE_LARGE_PAGE) return page_leaf_addr(PMD_LEVEL, walker, vaddr, paddr, size);
 
 	//get physical_page_number from PTE
-	walker = read_page_entry(mem_space, walker, vaddr->pte_entry);
+	walker = read_page_entry(mem_space, walker, virt_addr64_pte_entry(vaddr));
 	M_REQUIRE(walker != 0, ERR_ADDR, "%s", "Mem space probably not initialized");
 
-	//init phy_addr
-	M_REQUIRE(init_phy_addr(paddr, walker, vaddr->page_offset) == ERR_NONE, ERR_MEM, "%s", "page walk unsuccesful");
+	return page_leaf_addr(PTE_LEVEL, walker, vaddr, paddr, size);
+}
 
+int page_leaf_addr(page_level_t level, pte_t entry, virt_addr64_t vaddr, phy_addr_t* paddr, page_size_t* size) {
+	M_REQUIRE_NON_NULL(paddr);
+
+	if(!page_entry_is_large(level, entry)){
+		//init phy_addr
+		M_REQUIRE(level == PTE_LEVEL && init_phy_addr(paddr, entry, virt_addr64_page_offset(vaddr)) == ERR_NONE, ERR_MEM,
+		          "%s", "page walk unsuccesful");
+		if(size != NULL) *size = PAGE_4K;
+		return ERR_NONE;
+	}
+
+	//the frames of a large page are contiguous: the lower indexes of vaddr select one
+	const page_size_t page_size = level == PUD_LEVEL ? PAGE_1G : PAGE_2M;
+	const uint32_t frame_mask = (UINT32_C(1) << (PAGE_SIZE_BITS(page_size) - PAGE_OFFSET)) - 1;
+	const uint32_t first_frame = entry >> PAGE_OFFSET;
+	M_REQUIRE((entry & MAX_12BIT_VALUE) == PTE_LARGE_PAGE && (first_frame & frame_mask) == 0, ERR_MEM,
+	          "Large page 0x%08" PRIX32 " not aligned on its size", entry);
+
+	paddr->phy_page_num = first_frame | ((uint32_t) virt_addr64_virtual_page_number(vaddr) & frame_mask);
+	paddr->page_offset = virt_addr64_page_offset(vaddr);
+	if(size != NULL) *size = page_size;
 	return ERR_NONE;
 }
 
@@ -54,3 +92,138 @@ int page_walk(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr
 static inline pte_t read_page_entry(const pte_t * start, pte_t page_start, uint16_t index) {
 	return start[page_start/BYTES_PER_WORD + index];
 }
+
+#define BATCH_CHUNK 32 // addresses whose PTE entries are prefetched before being read
+#define NO_PREFIX UINT32_MAX // prefixes are the PGD, PUD and PMD indexes (at most 27 bits)
+
+#if defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address) ((void) (address))
+#endif
+
+typedef struct {
+	uint32_t prefix; // the PGD, PUD and PMD indexes of the region (NO_PREFIX if none)
+	pte_t table; // the PTE directory they lead to, 0 if not mapped (or the entry of a large page)
+	page_level_t level; // the level of the page directory holding table
+} walk_memo_t;
+
+int page_walk_batch(const void* mem_space, const virt_addr_t* vaddrs, phy_addr_t* paddrs, int* errors,
+                    size_t nb_addrs){
+	M_REQUIRE_NON_NULL(mem_space);
+	if(nb_addrs == 0) return ERR_NONE;
+	M_REQUIRE_NON_NULL(vaddrs);
+	M_REQUIRE_NON_NULL(paddrs);
+	M_REQUIRE_NON_NULL(errors);
+
+	walk_memo_t memo[PAGE_WALK_BATCH_MEMO];
+	for(size_t i = 0; i < PAGE_WALK_BATCH_MEMO; ++i) memo[i].prefix = NO_PREFIX;
+	uint32_t pgd_prefix = NO_PREFIX;
+	pte_t pud_table = 0;
+	uint32_t pud_prefix = NO_PREFIX;
+	pte_t pmd_table = 0;
+
+	for(size_t start = 0; start < nb_addrs; start += BATCH_CHUNK){
+		const size_t end = nb_addrs - start < BATCH_CHUNK ? nb_addrs : start + BATCH_CHUNK;
+		pte_t tables[BATCH_CHUNK];
+		page_level_t levels[BATCH_CHUNK];
+
+		// find the PTE directories (through the memos), and prefetch the PTE entries
+		for(size_t i = start; i < end; ++i){
+			const virt_addr_t* vaddr = &vaddrs[i];
+			const uint32_t pud_key = (uint32_t) vaddr->pgd_entry << PUD_ENTRY | vaddr->pud_entry;
+			const uint32_t pmd_key = pud_key << PMD_ENTRY | vaddr->pmd_entry;
+			walk_memo_t* slot = &memo[pmd_key & (PAGE_WALK_BATCH_MEMO - 1)];
+			if(slot->prefix != pmd_key){
+				if(pud_prefix != pud_key){
+					if(pgd_prefix != vaddr->pgd_entry){
+						pgd_prefix = vaddr->pgd_entry;
+						pud_table = read_page_entry(mem_space, PGD_START, vaddr->pgd_entry);
+					}
+					pud_prefix = pud_key;
+					pmd_table = pud_table == 0 ? 0 : read_page_entry(mem_space, pud_table, vaddr->pud_entry);
+				}
+				slot->prefix = pmd_key;
+				if(pmd_table & PTE_LARGE_PAGE){
+					slot->table = pmd_table;
+					slot->level = PUD_LEVEL;
+				}else{
+					slot->table = pmd_table == 0 ? 0 : read_page_entry(mem_space, pmd_table, vaddr->pmd_entry);
+					slot->level = PMD_LEVEL;
+				}
+			}
+			tables[i - start] = slot->table;
+			levels[i - start] = slot->level;
+			if(slot->table != 0 && !(slot->table & PTE_LARGE_PAGE)){
+				PREFETCH((const pte_t*) mem_space + slot->table / BYTES_PER_WORD + vaddr->pte_entry);
+			}
+		}
+
+		// read the PTE entries
+		for(size_t i = start; i < end; ++i){
+			const pte_t table = tables[i - start];
+			if(table & PTE_LARGE_PAGE){
+				errors[i] = page_leaf_addr(levels[i - start], table, virt_addr64_pack(&vaddrs[i]), &paddrs[i], NULL);
+				continue;
+			}
+			const pte_t page = table == 0 ? 0 : read_page_entry(mem_space, table, vaddrs[i].pte_entry);
+			if(page == 0){
+				errors[i] = ERR_ADDR;
+			}else if((page & MAX_12BIT_VALUE) != 0){
+				errors[i] = ERR_MEM; // as page_walk(): not the beginning of a page
+			}else{
+				paddrs[i].phy_page_num = page >> PAGE_OFFSET;
+				paddrs[i].page_offset = vaddrs[i].page_offset;
+				errors[i] = ERR_NONE;
+			}
+		}
+	}
+	return ERR_NONE;
+}
+
+int page_subtree_walk(const void* mem_space, size_t mem_capacity_in_bytes, page_level_t level, uint32_t paddr,
+                      uint64_t vaddr64, page_visitor_t visit, void* ctx){
+	static const unsigned SHIFTS[] = {
+		PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY, // PGD entry
+		PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY, // PUD entry
+		PAGE_OFFSET + PTE_ENTRY, // PMD entry
+		PAGE_OFFSET // PTE entry
+	};
+
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(visit);
+	M_REQUIRE(level <= DATA_LEVEL, ERR_BAD_PARAMETER, "Invalid page level %d", (int) level);
+
+	if(level > PGD_LEVEL && page_entry_is_large(level - 1, paddr)){
+		//a large page: its frames are data pages
+		const uint64_t size = UINT64_C(1) << SHIFTS[level - 1];
+		const uint32_t start = paddr & ~(uint32_t) MAX_12BIT_VALUE;
+		M_REQUIRE((paddr & MAX_12BIT_VALUE) == PTE_LARGE_PAGE && start % size == 0
+		          && size <= mem_capacity_in_bytes && start <= mem_capacity_in_bytes - size,
+		          ERR_ADDR, "Invalid large page 0x%08" PRIX32, paddr);
+		for(uint64_t offset = 0; offset < size; offset += PAGE_SIZE){
+			M_EXIT_IF_ERR(visit(ctx, DATA_LEVEL, vaddr64 + offset, (uint32_t) (start + offset)), "Error visiting page");
+		}
+		return ERR_NONE;
+	}
+
+	M_REQUIRE(paddr % PAGE_SIZE == 0 && mem_capacity_in_bytes >= PAGE_SIZE && paddr <= mem_capacity_in_bytes - PAGE_SIZE,
+	          ERR_ADDR, "Invalid page 0x%08" PRIX32, paddr);
+
+	M_EXIT_IF_ERR(visit(ctx, level, vaddr64, paddr), "Error visiting page");
+	if(level == DATA_LEVEL) return ERR_NONE;
+
+	for(uint16_t index = 0; index < PD_ENTRIES; ++index){
+		const pte_t entry = read_page_entry(mem_space, paddr, index);
+		if(entry == 0) continue; // nothing mapped there
+
+		M_EXIT_IF_ERR(page_subtree_walk(mem_space, mem_capacity_in_bytes, level + 1, entry,
+		                                vaddr64 | ((uint64_t) index << SHIFTS[level]), visit, ctx),
+		              "Error walking page directory");
+	}
+	return ERR_NONE;
+}
+
+int page_tables_walk(const void* mem_space, size_t mem_capacity_in_bytes, page_visitor_t visit, void* ctx){
+	return page_subtree_walk(mem_space, mem_capacity_in_bytes, PGD_LEVEL, PGD_START, 0, visit, ctx);
+}
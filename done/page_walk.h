@@ -10,8 +10,14 @@
 
 #include "addr.h"
 
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint32_t, uint64_t
+
+#define PAGE_WALK_BATCH_MEMO 256 // number of PMD entries page_walk_batch() remembers (a power of 2)
+
 /**
- * @brief Page walker: virtual address to physical address conversion.
+ * @brief Page walker: virtual address to physical address conversion
+ * (large pages included, see page_walk_sized()).
  *
  * @param mem_space starting address of our simulated memory space
  * @param vaddr virtual address to be converted
@@ -19,3 +25,121 @@
  * @return error code
  */
 int page_walk(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr);
+
+/**
+ * @brief page_walk() of a packed virtual address (no reassembling of the address).
+ *
+ * @param mem_space starting address of our simulated memory space
+ * @param vaddr virtual address to be converted
+ * @param paddr (SET) physical address
+ * @return error code
+ */
+int page_walk64(const void* mem_space, virt_addr64_t vaddr, phy_addr_t* paddr);
+
+/**
+ * @brief Page walker for many virtual addresses at once (same results as page_walk() on each).
+ *
+ * The PGD, PUD and PMD entries are shared by the addresses of a same region: the last
+ * PGD and PUD entries, and the PMD entries of up to PAGE_WALK_BATCH_MEMO regions of
+ * 2 MiB, are remembered for the whole batch, so each of them is usually read once.
+ * The PTE entries are then read a chunk of addresses at a time, after being prefetched.
+ *
+ * @param mem_space starting address of our simulated memory space
+ * @param vaddrs the virtual addresses to be converted
+ * @param paddrs (SET) physical addresses (only meaningful where errors is ERR_NONE)
+ * @param errors (SET) error code of each conversion (ERR_ADDR for an address not mapped)
+ * @param nb_addrs number of addresses
+ * @return error code (ERR_NONE even if some addresses are not mapped)
+ */
+int page_walk_batch(const void* mem_space, const virt_addr_t* vaddrs, phy_addr_t* paddrs, int* errors,
+                    size_t nb_addrs);
+
+/**
+ * @brief The levels of the pages met by page_tables_walk().
+ */
+typedef enum {
+	PGD_LEVEL,
+	PUD_LEVEL,
+	PMD_LEVEL,
+	PTE_LEVEL,
+	DATA_LEVEL // a mapped page (not a page directory)
+} page_level_t;
+
+/**
+ * @brief Page walker also telling the size of the page translating vaddr: the walk stops
+ * on a PUD or PMD entry with PTE_LARGE_PAGE set (1 GiB or 2 MiB page).
+ *
+ * @param mem_space starting address of our simulated memory space
+ * @param vaddr virtual address to be converted
+ * @param paddr (SET) physical address
+ * @param size (SET) size of the page (may be NULL)
+ * @return error code (ERR_MEM if a page is not aligned on its size, as page_walk())
+ */
+int page_walk_sized(const void* mem_space, const virt_addr_t* vaddr, phy_addr_t* paddr, page_size_t* size);
+
+/**
+ * @brief page_walk_sized() of a packed virtual address.
+ */
+int page_walk64_sized(const void* mem_space, virt_addr64_t vaddr, phy_addr_t* paddr, page_size_t* size);
+
+/**
+ * @brief Whether an entry of a page directory of the given level maps a large page
+ * instead of pointing to a page directory (see PTE_LARGE_PAGE).
+ */
+static inline int page_entry_is_large(page_level_t level, pte_t entry){
+	return (level == PUD_LEVEL || level == PMD_LEVEL) && (entry & PTE_LARGE_PAGE) != 0;
+}
+
+/**
+ * @brief Physical address of vaddr in the page mapped by an entry of a page directory:
+ * a PTE entry, or a large-page PUD or PMD entry (see page_entry_is_large()).
+ *
+ * @param level the level of the page directory holding the entry
+ * @param entry the entry
+ * @param vaddr virtual address to be converted
+ * @param paddr (SET) physical address
+ * @param size (SET) size of the page (may be NULL)
+ * @return error code (ERR_MEM if the page is not aligned on its size)
+ */
+int page_leaf_addr(page_level_t level, pte_t entry, virt_addr64_t vaddr, phy_addr_t* paddr, page_size_t* size);
+
+/**
+ * @brief Called by page_tables_walk() on every page it meets.
+ *
+ * @param ctx the context given to page_tables_walk()
+ * @param level the level of the page
+ * @param vaddr64 the first virtual address the page covers (or maps, for DATA_LEVEL)
+ * @param paddr the physical address of the page
+ * @return error code; page_tables_walk() stops on the first error
+ */
+typedef int (*page_visitor_t)(void* ctx, page_level_t level, uint64_t vaddr64, uint32_t paddr);
+
+/**
+ * @brief Visit all the page directories of a memory, and all the pages they map,
+ * in increasing order of virtual addresses (a directory before what it points to).
+ * A large page is visited as the DATA_LEVEL pages of each of its 4 kiB frames.
+ *
+ * @param mem_space starting address of our simulated memory space
+ * @param mem_capacity_in_bytes its size: entries out of it are errors
+ * @param visit the function to call on every page
+ * @param ctx passed to visit
+ * @return error code
+ */
+int page_tables_walk(const void* mem_space, size_t mem_capacity_in_bytes, page_visitor_t visit, void* ctx);
+
+/**
+ * @brief Visit a page and, if it is a page directory, all the pages under it
+ * (as page_tables_walk() does from the PGD).
+ *
+ * @param mem_space starting address of our simulated memory space
+ * @param mem_capacity_in_bytes its size: pages out of it are errors
+ * @param level the level of the page
+ * @param paddr the physical address of the page; at PMD_LEVEL or PTE_LEVEL, may also be
+ * the large-page entry standing for it (then the frames of the large page are visited)
+ * @param vaddr64 the first virtual address the page covers
+ * @param visit the function to call on every page
+ * @param ctx passed to visit
+ * @return error code
+ */
+int page_subtree_walk(const void* mem_space, size_t mem_capacity_in_bytes, page_level_t level, uint32_t paddr,
+                      uint64_t vaddr64, page_visitor_t visit, void* ctx);
@@ -0,0 +1,223 @@
+/**
+ * @file pwc.c
+ * @brief Page-walk caches: caches of the entries of the upper page directories
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdlib.h> // calloc(), free(), strtoul()
+#include <string.h> // memset(), memcpy()
+
+#include "pwc.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "addr_mng.h"
+#include "error.h"
+
+#define PGD_START 0
+#define NB_WALK_LEVELS 4 // PGD, PUD, PMD and PTE
+
+// shift of the virtual address bits indexing a page directory, per level
+static const unsigned SHIFTS[NB_WALK_LEVELS] = {
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY, // PGD entry
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY, // PUD entry
+	PAGE_OFFSET + PTE_ENTRY, // PMD entry
+	PAGE_OFFSET // PTE entry
+};
+
+/**
+ * @brief Look an entry up in the cache of a level
+ * @return the cached entry, NULL on miss
+ */
+static pwc_entry_t* pwc_lookup(pwc_t* pwc, size_t level, uint64_t tag){
+	pwc_level_t* cache = &pwc->levels[level];
+	if(cache->nb_sets == 0) return NULL;
+
+	++cache->lookups;
+	pwc_entry_t* set = cache->entries + (tag & (cache->nb_sets - 1)) * cache->nb_ways;
+	for(size_t way = 0; way < cache->nb_ways; ++way){
+		if(set[way].valid && set[way].tag == tag){
+			++cache->hits;
+			set[way].last_use = ++pwc->clock;
+			return &set[way];
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Insert an entry read in memory in the cache of a level (in place of the LRU one)
+ * @param sources where the entries of the walk were read, from the PGD one to this one
+ */
+static void pwc_fill(pwc_t* pwc, size_t level, uint64_t tag, pte_t entry, const uint32_t sources[PWC_LEVELS]){
+	pwc_level_t* cache = &pwc->levels[level];
+	if(cache->nb_sets == 0) return;
+
+	pwc_entry_t* set = cache->entries + (tag & (cache->nb_sets - 1)) * cache->nb_ways;
+	pwc_entry_t* victim = &set[0];
+	for(size_t way = 0; way < cache->nb_ways && victim->valid; ++way){
+		if(!set[way].valid || set[way].last_use < victim->last_use) victim = &set[way];
+	}
+	victim->tag = tag;
+	victim->last_use = ++pwc->clock;
+	for(size_t above = 0; above <= level; ++above){
+		victim->sources[above] = sources[above];
+		pwc->sources |= UINT64_C(1) << (sources[above] / PAGE_SIZE % 64);
+	}
+	victim->entry = entry;
+	victim->valid = 1;
+}
+
+// ======================================================================
+void pwc_invalidate(pwc_t* pwc, uint32_t paddr, size_t size){
+	if(pwc == NULL || size == 0) return;
+
+	// most writes are to data frames: no entry can come from them
+	const size_t first = paddr / PAGE_SIZE;
+	const size_t last = ((size_t) paddr + size - 1) / PAGE_SIZE;
+	int maybe = 0;
+	for(size_t frame = first; frame <= last && !maybe; ++frame){
+		maybe = (pwc->sources >> (frame % 64)) & 1;
+	}
+	if(!maybe) return;
+
+	// an entry is stale if it, or any entry of its walk, is written to
+	const uint64_t end = (uint64_t) paddr + size;
+	for(size_t level = 0; level < PWC_LEVELS; ++level){
+		const pwc_level_t* cache = &pwc->levels[level];
+		for(size_t i = 0; i < cache->nb_sets * cache->nb_ways; ++i){
+			pwc_entry_t* e = &cache->entries[i];
+			if(!e->valid) continue;
+			for(size_t above = 0; above <= level; ++above){
+				if(e->sources[above] < end && (uint64_t) e->sources[above] + sizeof(pte_t) > paddr){
+					e->valid = 0;
+					++pwc->nb_invalidations;
+					break;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief mem_write_observer_t keeping the caches in line with the memory
+ */
+static void pwc_written(void* context, uint32_t paddr, size_t size){
+	pwc_invalidate(context, paddr, size);
+}
+
+// ======================================================================
+int pwc_init(pwc_t* pwc, const void* mem_space, const size_t nb_sets[PWC_LEVELS], const size_t nb_ways[PWC_LEVELS]){
+	M_REQUIRE_NON_NULL(pwc);
+	M_REQUIRE_NON_NULL(mem_space);
+	M_REQUIRE_NON_NULL(nb_sets);
+	M_REQUIRE_NON_NULL(nb_ways);
+
+	memset(pwc, 0, sizeof(*pwc));
+	pwc->mem_space = mem_space;
+	int err = ERR_NONE;
+	for(size_t level = 0; level < PWC_LEVELS && err == ERR_NONE; ++level){
+		const size_t sets = nb_ways[level] == 0 ? 0 : nb_sets[level];
+		if(sets == 0) continue;
+		if((sets & (sets - 1)) != 0){
+			err = ERR_BAD_PARAMETER;
+			break;
+		}
+		pwc->levels[level].entries = calloc(sets * nb_ways[level], sizeof(pwc_entry_t));
+		if(pwc->levels[level].entries == NULL){
+			err = ERR_MEM;
+			break;
+		}
+		pwc->levels[level].nb_sets = sets;
+		pwc->levels[level].nb_ways = nb_ways[level];
+	}
+	if(err == ERR_NONE) err = mem_observer_add(mem_space, pwc_written, pwc);
+	if(err != ERR_NONE){
+		for(size_t level = 0; level < PWC_LEVELS; ++level) free(pwc->levels[level].entries);
+		memset(pwc, 0, sizeof(*pwc));
+	}
+	return err;
+}
+
+// ======================================================================
+int pwc_free(pwc_t* pwc){
+	M_REQUIRE_NON_NULL(pwc);
+	M_REQUIRE_NON_NULL(pwc->mem_space);
+
+	const int err = mem_observer_remove(pwc->mem_space, pwc_written, pwc);
+	for(size_t level = 0; level < PWC_LEVELS; ++level) free(pwc->levels[level].entries);
+	memset(pwc, 0, sizeof(*pwc));
+	return err;
+}
+
+// ======================================================================
+int pwc_parse(const char* spec, size_t nb_sets[PWC_LEVELS], size_t nb_ways[PWC_LEVELS]){
+	M_REQUIRE_NON_NULL(spec);
+	M_REQUIRE_NON_NULL(nb_sets);
+	M_REQUIRE_NON_NULL(nb_ways);
+
+	const char* next = spec;
+	for(size_t level = 0; level < PWC_LEVELS; ++level){
+		char* end = NULL;
+		nb_sets[level] = (size_t) strtoul(next, &end, 10);
+		M_REQUIRE(end != next && *end == 'x', ERR_BAD_PARAMETER, "Invalid page-walk cache geometry \"%s\"", spec);
+		next = end + 1;
+		nb_ways[level] = (size_t) strtoul(next, &end, 10);
+		M_REQUIRE(end != next && *end == (level + 1 < PWC_LEVELS ? ',' : '\0'), ERR_BAD_PARAMETER,
+		          "Invalid page-walk cache geometry \"%s\"", spec);
+		M_REQUIRE((nb_sets[level] & (nb_sets[level] - 1)) == 0, ERR_BAD_PARAMETER,
+		          "Number of sets must be a power of 2 in \"%s\"", spec);
+		next = end + 1;
+	}
+	return ERR_NONE;
+}
+
+// ======================================================================
+int page_walk_cached(pwc_t* pwc, const virt_addr_t* vaddr, phy_addr_t* paddr, page_size_t* size){
+	M_REQUIRE_NON_NULL(vaddr);
+	return page_walk_cached64(pwc, virt_addr64_pack(vaddr), paddr, size);
+}
+
+// ======================================================================
+int page_walk_cached64(pwc_t* pwc, virt_addr64_t vaddr64, phy_addr_t* paddr, page_size_t* size){
+	M_REQUIRE_NON_NULL(pwc);
+	M_REQUIRE_NON_NULL(paddr);
+
+	++pwc->nb_walks;
+	// as page_walk(), the reserved bits are ignored
+	vaddr64 = virt_addr64_virtual_page_number(vaddr64) << PAGE_OFFSET | virt_addr64_page_offset(vaddr64);
+
+	// skip to the deepest level cached
+	size_t level = 0;
+	pte_t table = PGD_START;
+	uint32_t sources[PWC_LEVELS] = { 0 }; // where the entries of the walk are read
+	for(size_t cached = PWC_LEVELS; cached-- > 0; ){
+		const pwc_entry_t* hit = pwc_lookup(pwc, cached, vaddr64 >> SHIFTS[cached]);
+		if(hit != NULL){
+			// a cached large-page entry translates on its own
+			if(page_entry_is_large(cached, hit->entry)) return page_leaf_addr(cached, hit->entry, vaddr64, paddr, size);
+			table = hit->entry;
+			level = cached + 1;
+			memcpy(sources, hit->sources, level * sizeof(sources[0]));
+			break;
+		}
+	}
+
+	// read the remaining entries, caching them on the way
+	const pte_t* memory = pwc->mem_space;
+	for(; level < NB_WALK_LEVELS; ++level){
+		const uint32_t source = table + (uint32_t) (((vaddr64 >> SHIFTS[level]) & (PD_ENTRIES - 1)) * sizeof(pte_t));
+		const pte_t entry = memory[source / sizeof(pte_t)];
+		++pwc->nb_reads;
+		M_REQUIRE(entry != 0, ERR_ADDR, "%s", "Mem space probably not initialized");
+		if(level < PWC_LEVELS){
+			sources[level] = source;
+			pwc_fill(pwc, level, vaddr64 >> SHIFTS[level], entry, sources);
+		}
+		if(page_entry_is_large(level, entry)) return page_leaf_addr(level, entry, vaddr64, paddr, size);
+		table = entry;
+	}
+
+	return page_leaf_addr(PTE_LEVEL, table, vaddr64, paddr, size);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file pwc.h
+ * @brief Page-walk caches: caches of the entries of the upper page directories
+ *
+ * A page walk reads one entry per level: PGD, PUD, PMD, then PTE. Consecutive walks
+ * often share their upper levels, so the entries read in the PGD, the PUD and the PMD
+ * are kept in one small set-associative cache per level, tagged with the virtual
+ * address bits that select them (e.g. the PGD, PUD and PMD indexes for a PMD entry).
+ * A walk looks the deepest level up first, and only reads the entries below the
+ * deepest hit: a PMD entry hit leaves one read (the PTE entry) instead of four.
+ *
+ * Every cached entry remembers where in the memory it was read, and where the entries
+ * of the upper levels that led to it were read (whether these are cached or not).
+ * The caches follow the writes to the memory (see mem_observer_add()) and drop the
+ * entries with any of these sources written to, so that walks see the page tables
+ * as they are.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "addr.h" // for virt_addr_t, phy_addr_t and pte_t
+
+#define PWC_LEVELS 3 // caches of PGD, PUD and PMD entries
+
+typedef struct {
+	uint64_t tag; // the virtual address bits selecting the entry (up to its level)
+	uint64_t last_use; // for LRU replacement
+	uint32_t sources[PWC_LEVELS]; // physical addresses the entries of its walk were read at, PGD first, itself last
+	pte_t entry; // physical address of the page directory of the next level
+	uint8_t valid;
+} pwc_entry_t;
+
+typedef struct {
+	pwc_entry_t* entries; // nb_sets * nb_ways entries, set by set
+	size_t nb_sets; // a power of 2; 0 if the level is not cached
+	size_t nb_ways;
+	uint64_t lookups;
+	uint64_t hits;
+} pwc_level_t;
+
+typedef struct {
+	const void* mem_space;
+	pwc_level_t levels[PWC_LEVELS]; // PGD, PUD and PMD entries
+	uint64_t nb_walks;
+	uint64_t nb_reads; // number of page directory entries read from memory
+	uint64_t nb_invalidations; // number of cached entries dropped on writes
+	uint64_t clock; // for LRU replacement
+	uint64_t sources; // bit (frame % 64) set if an entry, or one above it, may have been read in such a frame
+} pwc_t;
+
+/**
+ * @brief "Constructor" for pwc_t: empty caches, which follow the writes to the memory.
+ * @param pwc (modified) the caches to initialize
+ * @param mem_space the memory walked
+ * @param nb_sets number of sets of the caches of PGD, PUD and PMD entries (powers of 2; 0 not to cache a level)
+ * @param nb_ways number of ways of the caches of PGD, PUD and PMD entries
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int pwc_init(pwc_t* pwc, const void* mem_space, const size_t nb_sets[PWC_LEVELS], const size_t nb_ways[PWC_LEVELS]);
+
+/**
+ * @brief Stop following the writes to the memory and release the caches.
+ * @param pwc (modified) the caches to release
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int pwc_free(pwc_t* pwc);
+
+/**
+ * @brief Parse the geometry of the caches: "SETSxWAYS,SETSxWAYS,SETSxWAYS" for the PGD,
+ * PUD and PMD entries (e.g. "1x4,4x4,16x4"; "0x0" for a level not cached).
+ * @param spec the text to parse
+ * @param nb_sets (modified) the number of sets per level
+ * @param nb_ways (modified) the number of ways per level
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int pwc_parse(const char* spec, size_t nb_sets[PWC_LEVELS], size_t nb_ways[PWC_LEVELS]);
+
+/**
+ * @brief Page walker going through the caches (same result as page_walk_sized()).
+ * A cached large-page entry (see PTE_LARGE_PAGE) is a whole translation.
+ * @param pwc (modified) the caches
+ * @param vaddr virtual address to be converted
+ * @param paddr (modified) physical address
+ * @param size (modified) size of the page (may be NULL)
+ * @return error code
+ */
+int page_walk_cached(pwc_t* pwc, const virt_addr_t* vaddr, phy_addr_t* paddr, page_size_t* size);
+
+/**
+ * @brief page_walk_cached() of a packed virtual address.
+ */
+int page_walk_cached64(pwc_t* pwc, virt_addr64_t vaddr, phy_addr_t* paddr, page_size_t* size);
+
+/**
+ * @brief Drop the cached entries read in a part of the memory (done on every write
+ * to the memory; to be called if the memory is changed behind mem_written()'s back).
+ * @param pwc (modified) the caches
+ * @param paddr physical address of the first byte changed
+ * @param size number of bytes changed
+ */
+void pwc_invalidate(pwc_t* pwc, uint32_t paddr, size_t size);
@@ -0,0 +1,71 @@
+/**
+ * @file restore-memory.c
+ * @brief Restores checkpoints on a memory, and dumps the result
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (dump|desc|image) mem_filename dump_filename [checkpoint_filename ...]\n", pgm);
+    fprintf(stderr, "          (checkpoints are restored in the given order, then the memory is dumped)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin restored.mem run.1.ckpt run.2.ckpt\n", pgm);
+    fprintf(stderr, "          %s desc memory_description.txt restored.mem run.1.ckpt\n", pgm);
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        error(argv[0], "please provide memory format, memory file and dump file:");
+        return 1;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_NONE;
+    if (!strcmp(argv[1], "dump")) {
+        err = mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size);
+    } else if (!strcmp(argv[1], "desc")) {
+        err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    } else if (!strcmp(argv[1], "image")) {
+        err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    } else {
+        error(argv[0], "unknown command.");
+        return 1;
+    }
+    if (err != ERR_NONE) {
+        error(argv[0], "cannot read memory.");
+        return 1;
+    }
+
+    for (int i = 4; err == ERR_NONE && i < argc; ++i) {
+        err = mem_restore(mem_space, mem_size, argv[i]);
+        if (err != ERR_NONE) error(argv[0], "cannot restore checkpoint.");
+    }
+
+    if (err == ERR_NONE) {
+        FILE* output = fopen(argv[3], "wb");
+        if (output == NULL
+            || fwrite(mem_space, 1, mem_size, output) != mem_size
+            || fclose(output) != 0) {
+            error(argv[0], "cannot write dump.");
+            err = ERR_IO;
+        }
+    }
+
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
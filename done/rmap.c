@@ -0,0 +1,325 @@
+/**
+ * @file rmap.c
+ * @brief Reverse translation: from a physical frame to the virtual pages mapping it
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdlib.h> // calloc(), realloc(), free()
+#include <string.h> // memcpy(), memset()
+
+#include "rmap.h"
+#include "memory.h"
+#include "error.h"
+
+// shift of the virtual address bits indexing a page directory, per level
+static const unsigned SHIFTS[] = {
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY, // PGD entry
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY, // PUD entry
+	PAGE_OFFSET + PTE_ENTRY, // PMD entry
+	PAGE_OFFSET // PTE entry
+};
+
+/**
+ * @brief Grows a dynamic array to hold at least needed elements
+ */
+static int rmap_grow(void** array, size_t* allocated, size_t needed, size_t elem_size){
+	if(needed <= *allocated) return ERR_NONE;
+	size_t new_allocated = *allocated == 0 ? 64 : *allocated;
+	while(new_allocated < needed) new_allocated *= 2;
+	void* grown = realloc(*array, new_allocated * elem_size);
+	M_EXIT_IF_NULL(grown, new_allocated * elem_size);
+	*array = grown;
+	*allocated = new_allocated;
+	return ERR_NONE;
+}
+
+/**
+ * @brief The copy of the page directory held in a frame (NULL if none)
+ */
+static pte_t* rmap_table(const rmap_t* rmap, size_t frame){
+	const uint32_t copy = rmap->copies[frame];
+	return copy == RMAP_NONE ? NULL : rmap->tables + (size_t) copy * PD_ENTRIES;
+}
+
+/**
+ * @brief Records a page under its frame; records of a frame are kept by level, then virtual address
+ */
+static int record_add(rmap_t* rmap, size_t frame, page_level_t level, uint64_t vaddr64){
+	uint32_t index = rmap->free_records;
+	if(index != RMAP_NONE){
+		rmap->free_records = rmap->records[index].next;
+	}else{
+		M_EXIT_IF_ERR(rmap_grow((void**) &rmap->records, &rmap->allocated_records, rmap->nb_records + 1,
+		                        sizeof(rmap_record_t)), "Error growing records");
+		index = (uint32_t) rmap->nb_records++;
+	}
+
+	rmap_record_t* record = &rmap->records[index];
+	record->vaddr64 = vaddr64;
+	record->level = (uint8_t) level;
+
+	uint32_t* link = &rmap->heads[frame];
+	while(*link != RMAP_NONE){
+		const rmap_record_t* other = &rmap->records[*link];
+		if(other->level > level || (other->level == level && other->vaddr64 > vaddr64)) break;
+		link = &rmap->records[*link].next;
+	}
+	record->next = *link;
+	*link = index;
+
+	if(level == DATA_LEVEL) ++rmap->nb_mappings;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Forgets a page recorded under its frame (if it was)
+ */
+static void record_remove(rmap_t* rmap, size_t frame, page_level_t level, uint64_t vaddr64){
+	for(uint32_t* link = &rmap->heads[frame]; *link != RMAP_NONE; link = &rmap->records[*link].next){
+		rmap_record_t* record = &rmap->records[*link];
+		if(record->level == level && record->vaddr64 == vaddr64){
+			const uint32_t index = *link;
+			*link = record->next;
+			record->next = rmap->free_records;
+			rmap->free_records = index;
+			if(level == DATA_LEVEL) --rmap->nb_mappings;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Whether a frame still is a page directory somewhere
+ */
+static int frame_is_table(const rmap_t* rmap, size_t frame){
+	for(uint32_t index = rmap->heads[frame]; index != RMAP_NONE; index = rmap->records[index].next){
+		if(rmap->records[index].level != DATA_LEVEL) return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Keeps a copy of the page directory held in a frame (if not already kept)
+ */
+static int table_copy(rmap_t* rmap, size_t frame){
+	if(rmap->copies[frame] != RMAP_NONE) return ERR_NONE;
+
+	uint32_t copy = rmap->free_tables;
+	if(copy != RMAP_NONE){
+		rmap->free_tables = rmap->tables[(size_t) copy * PD_ENTRIES];
+	}else{
+		M_EXIT_IF_ERR(rmap_grow((void**) &rmap->tables, &rmap->allocated_tables, (rmap->nb_tables + 1) * PD_ENTRIES,
+		                        sizeof(pte_t)), "Error growing page directory copies");
+		copy = (uint32_t) rmap->nb_tables++;
+	}
+	memcpy(rmap->tables + (size_t) copy * PD_ENTRIES, (const pte_t*) ((const uint8_t*) rmap->memory + frame * PAGE_SIZE),
+	       PD_ENTRIES * sizeof(pte_t));
+	rmap->copies[frame] = copy;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Drops the copy of the page directory held in a frame, once it is no page directory anymore
+ */
+static void table_drop(rmap_t* rmap, size_t frame){
+	const uint32_t copy = rmap->copies[frame];
+	if(copy == RMAP_NONE || frame_is_table(rmap, frame)) return;
+
+	rmap->tables[(size_t) copy * PD_ENTRIES] = rmap->free_tables;
+	rmap->free_tables = copy;
+	rmap->copies[frame] = RMAP_NONE;
+}
+
+/**
+ * @brief page_visitor_t recording every page met
+ */
+static int rmap_visit(void* ctx, page_level_t level, uint64_t vaddr64, uint32_t paddr){
+	rmap_t* rmap = ctx;
+	const size_t frame = paddr / PAGE_SIZE;
+	M_EXIT_IF_ERR(record_add(rmap, frame, level, vaddr64), "Error recording page");
+	if(level != DATA_LEVEL) M_EXIT_IF_ERR(table_copy(rmap, frame), "Error copying page directory");
+	return ERR_NONE;
+}
+
+/**
+ * @brief Whether a page directory entry points to a frame of the memory
+ */
+static int entry_valid(const rmap_t* rmap, pte_t entry){
+	return entry != 0 && entry % PAGE_SIZE == 0 && entry <= rmap->mem_capacity_in_bytes - PAGE_SIZE;
+}
+
+static void entry_remove(rmap_t* rmap, pte_t entry, page_level_t level, uint64_t vaddr64);
+
+/**
+ * @brief Forgets a page and, through the copies of the page directories, all the pages under it
+ */
+static void subtree_remove(rmap_t* rmap, size_t frame, page_level_t level, uint64_t vaddr64){
+	if(level != DATA_LEVEL){
+		for(size_t index = 0; index < PD_ENTRIES; ++index){
+			const pte_t* table = rmap_table(rmap, frame);
+			if(table == NULL) break;
+			entry_remove(rmap, table[index], level + 1, vaddr64 | ((uint64_t) index << SHIFTS[level]));
+		}
+	}
+	record_remove(rmap, frame, level, vaddr64);
+	if(level != DATA_LEVEL) table_drop(rmap, frame);
+}
+
+/**
+ * @brief Forgets the pages under an entry of a page directory (of level - 1): the page
+ * it points to and all the pages under it, or the frames of the large page it maps
+ */
+static void entry_remove(rmap_t* rmap, pte_t entry, page_level_t level, uint64_t vaddr64){
+	if(page_entry_is_large(level - 1, entry)){
+		const size_t first = entry / PAGE_SIZE;
+		const size_t nb_frames = (size_t) 1 << (SHIFTS[level - 1] - PAGE_OFFSET);
+		for(size_t frame = 0; frame < nb_frames && first + frame < rmap->nb_frames; ++frame){
+			record_remove(rmap, first + frame, DATA_LEVEL, vaddr64 + frame * PAGE_SIZE);
+		}
+	}else if(entry_valid(rmap, entry)){
+		subtree_remove(rmap, entry / PAGE_SIZE, level, vaddr64);
+	}
+}
+
+/**
+ * @brief Follows an entry of a page directory changed from old to new
+ */
+static int entry_update(rmap_t* rmap, size_t frame, size_t index, pte_t old, pte_t new){
+	// the directories the frame is (the list changes below if an entry points to the frame itself)
+	size_t nb_parents = 0;
+	for(uint32_t r = rmap->heads[frame]; r != RMAP_NONE; r = rmap->records[r].next){
+		nb_parents += rmap->records[r].level != DATA_LEVEL;
+	}
+	rmap_record_t* parents = calloc(nb_parents + 1, sizeof(rmap_record_t)); // + 1: never calloc(0)
+	M_EXIT_IF_NULL(parents, (nb_parents + 1) * sizeof(rmap_record_t));
+	size_t p = 0;
+	for(uint32_t r = rmap->heads[frame]; r != RMAP_NONE; r = rmap->records[r].next){
+		if(rmap->records[r].level != DATA_LEVEL) parents[p++] = rmap->records[r];
+	}
+
+	for(p = 0; p < nb_parents; ++p){
+		const uint64_t vaddr64 = parents[p].vaddr64 | ((uint64_t) index << SHIFTS[parents[p].level]);
+		entry_remove(rmap, old, parents[p].level + 1, vaddr64);
+	}
+
+	pte_t* table = rmap_table(rmap, frame);
+	if(table != NULL) table[index] = new;
+
+	int err = ERR_NONE;
+	for(p = 0; p < nb_parents && err == ERR_NONE; ++p){
+		const uint64_t vaddr64 = parents[p].vaddr64 | ((uint64_t) index << SHIFTS[parents[p].level]);
+		if(new != 0){
+			err = page_subtree_walk(rmap->memory, rmap->mem_capacity_in_bytes, parents[p].level + 1, new, vaddr64,
+			                        rmap_visit, rmap);
+		}
+		if(rmap->listener != NULL) rmap->listener(rmap->listener_context, parents[p].level, vaddr64, new);
+	}
+	free(parents);
+	++rmap->nb_updates;
+	return err;
+}
+
+/**
+ * @brief mem_write_observer_t following the changes of the page directories
+ */
+static void rmap_written(void* context, uint32_t paddr, size_t size){
+	rmap_t* rmap = context;
+	if(size == 0) return;
+
+	const size_t last = ((size_t) paddr + size - 1) / PAGE_SIZE;
+	for(size_t frame = paddr / PAGE_SIZE; frame <= last && frame < rmap->nb_frames; ++frame){
+		if(rmap->copies[frame] == RMAP_NONE) continue; // a data frame
+
+		const size_t frame_start = frame * PAGE_SIZE;
+		const size_t from = frame_start > paddr ? 0 : (paddr - frame_start) / sizeof(pte_t);
+		size_t to = ((size_t) paddr + size - frame_start + sizeof(pte_t) - 1) / sizeof(pte_t);
+		if(to > PD_ENTRIES) to = PD_ENTRIES; // the rest of the frame is not part of the directory
+		const pte_t* entries = (const pte_t*) ((const uint8_t*) rmap->memory + frame * PAGE_SIZE);
+		for(size_t index = from; index < to; ++index){
+			const pte_t* table = rmap_table(rmap, frame);
+			if(table == NULL) break; // no page directory anymore
+			if(table[index] == entries[index]) continue;
+
+			const int err = entry_update(rmap, frame, index, table[index], entries[index]);
+			if(err != ERR_NONE && rmap->error == ERR_NONE) rmap->error = err;
+		}
+	}
+}
+
+// ======================================================================
+int rmap_init(rmap_t* rmap, void* memory, size_t mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(rmap);
+	M_REQUIRE_NON_NULL(memory);
+	M_REQUIRE(mem_capacity_in_bytes >= PAGE_SIZE, ERR_BAD_PARAMETER, "%s", "Memory too small for a PGD");
+
+	memset(rmap, 0, sizeof(*rmap));
+	rmap->memory = memory;
+	rmap->mem_capacity_in_bytes = mem_capacity_in_bytes;
+	rmap->nb_frames = mem_capacity_in_bytes / PAGE_SIZE;
+	rmap->heads = calloc(rmap->nb_frames, sizeof(uint32_t));
+	rmap->copies = calloc(rmap->nb_frames, sizeof(uint32_t));
+	rmap->nb_records = 1; // records[0] stands for RMAP_NONE
+	rmap->nb_tables = 1; // so does copy 0
+	int err = rmap->heads == NULL || rmap->copies == NULL ? ERR_MEM : ERR_NONE;
+	if(err == ERR_NONE) err = rmap_grow((void**) &rmap->records, &rmap->allocated_records, 1, sizeof(rmap_record_t));
+	if(err == ERR_NONE) err = rmap_grow((void**) &rmap->tables, &rmap->allocated_tables, PD_ENTRIES, sizeof(pte_t));
+	if(err == ERR_NONE) err = page_tables_walk(memory, mem_capacity_in_bytes, rmap_visit, rmap);
+	if(err == ERR_NONE) err = mem_observer_add(memory, rmap_written, rmap);
+	if(err != ERR_NONE){
+		free(rmap->heads);
+		free(rmap->copies);
+		free(rmap->records);
+		free(rmap->tables);
+		memset(rmap, 0, sizeof(*rmap));
+	}
+	return err;
+}
+
+// ======================================================================
+int rmap_free(rmap_t* rmap){
+	M_REQUIRE_NON_NULL(rmap);
+	M_REQUIRE_NON_NULL(rmap->heads);
+
+	const int err = mem_observer_remove(rmap->memory, rmap_written, rmap);
+	free(rmap->heads);
+	free(rmap->copies);
+	free(rmap->records);
+	free(rmap->tables);
+	memset(rmap, 0, sizeof(*rmap));
+	return err;
+}
+
+// ======================================================================
+int rmap_listen(rmap_t* rmap, rmap_listener_t listener, void* context){
+	M_REQUIRE_NON_NULL(rmap);
+
+	rmap->listener = listener;
+	rmap->listener_context = context;
+	return ERR_NONE;
+}
+
+// ======================================================================
+const rmap_record_t* rmap_first(const rmap_t* rmap, uint32_t paddr){
+	if(rmap == NULL || rmap->heads == NULL || paddr / PAGE_SIZE >= rmap->nb_frames) return NULL;
+	const uint32_t index = rmap->heads[paddr / PAGE_SIZE];
+	return index == RMAP_NONE ? NULL : &rmap->records[index];
+}
+
+// ======================================================================
+const rmap_record_t* rmap_next(const rmap_t* rmap, const rmap_record_t* record){
+	if(rmap == NULL || record == NULL || record->next == RMAP_NONE) return NULL;
+	return &rmap->records[record->next];
+}
+
+// ======================================================================
+size_t rmap_vpages(const rmap_t* rmap, uint32_t paddr, uint64_t* vaddrs, size_t max){
+	size_t nb = 0;
+	rmap_for_each(rmap, paddr, record){
+		if(record->level != DATA_LEVEL) continue;
+		if(nb < max && vaddrs != NULL) vaddrs[nb] = record->vaddr64;
+		++nb;
+	}
+	return nb;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+/**
+ * @file rmap.h
+ * @brief Reverse translation: from a physical frame to the virtual pages mapping it
+ *
+ * The page tables are walked once (see page_tables_walk()), and every page met is
+ * recorded under its frame: the virtual pages a data frame is mapped at, and the
+ * level (and first virtual address covered) of a frame used as a page directory.
+ * Records of a frame are chained in a pool, from a per-frame head.
+ *
+ * The map then follows the writes to the memory (see mem_observer_add()). A copy of
+ * every page directory is kept: when one is written to, the entries that changed are
+ * found by comparing with the copy, the pages under the old entries are forgotten
+ * and the pages under the new ones are recorded. Writes to data frames cost one lookup.
+ * A listener (see rmap_listen()) is told of every entry that changed.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "addr.h" // for pte_t
+#include "page_walk.h" // for page_level_t
+
+#define RMAP_NONE 0 // "no record"/"no copy" index
+
+/**
+ * @brief Called for every entry of a page directory that changed (once per virtual
+ * address range the directory translates), once the reverse map follows it.
+ * @param context the context given to rmap_listen()
+ * @param level the level of the page directory
+ * @param vaddr64 the first virtual address the entry covers
+ * @param entry the new value of the entry
+ */
+typedef void (*rmap_listener_t)(void* context, page_level_t level, uint64_t vaddr64, pte_t entry);
+
+typedef struct {
+	uint64_t vaddr64; // the virtual page mapped (DATA_LEVEL), or the first virtual address covered
+	uint32_t next; // index of the next record of the same frame, RMAP_NONE at the end
+	uint8_t level; // page_level_t of the frame
+} rmap_record_t;
+
+typedef struct {
+	void* memory;
+	size_t mem_capacity_in_bytes;
+	size_t nb_frames;
+	uint32_t* heads; // per frame: index of its first record, RMAP_NONE if none
+	rmap_record_t* records; // records[0] is unused (RMAP_NONE)
+	size_t nb_records; // including the free ones and records[0]
+	size_t allocated_records;
+	uint32_t free_records; // chained through next
+	uint32_t* copies; // per frame: index of the copy of the page directory it holds, RMAP_NONE if none
+	pte_t* tables; // the copies, PD_ENTRIES entries each; copy 0 is unused (RMAP_NONE)
+	size_t nb_tables; // including the free ones and copy 0
+	size_t allocated_tables;
+	uint32_t free_tables; // chained through their first entry
+	size_t nb_mappings; // number of virtual pages mapped
+	uint64_t nb_updates; // number of entries of page directories changed since rmap_init()
+	rmap_listener_t listener; // NULL if none
+	void* listener_context;
+	int error; // first error met while following the writes (ERR_NONE if none)
+} rmap_t;
+
+/**
+ * @brief "Constructor" for rmap_t: walk the page tables of a memory, and follow its writes.
+ * @param rmap (modified) the map to build
+ * @param memory the memory (the PGD at physical address 0)
+ * @param mem_capacity_in_bytes its size
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int rmap_init(rmap_t* rmap, void* memory, size_t mem_capacity_in_bytes);
+
+/**
+ * @brief Stop following the writes to the memory, and release the map (not the memory).
+ * @param rmap (modified) the map to release
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int rmap_free(rmap_t* rmap);
+
+/**
+ * @brief Tell a listener of the entries of page directories that change (replaces the previous one).
+ * @param rmap the map
+ * @param listener the function to call, NULL for none
+ * @param context passed to listener
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int rmap_listen(rmap_t* rmap, rmap_listener_t listener, void* context);
+
+/**
+ * @brief The first record of a frame (see rmap_next()).
+ * @param rmap the map
+ * @param paddr any physical address in the frame
+ * @return the record, NULL if the frame is not a page directory nor mapped
+ */
+const rmap_record_t* rmap_first(const rmap_t* rmap, uint32_t paddr);
+
+/**
+ * @brief The record following one of a frame.
+ * @param rmap the map
+ * @param record a record of the frame
+ * @return the next record, NULL if there is none
+ */
+const rmap_record_t* rmap_next(const rmap_t* rmap, const rmap_record_t* record);
+
+/**
+ * @brief Tell at which virtual pages a frame is mapped.
+ * @param rmap the map
+ * @param paddr any physical address in the frame
+ * @param vaddrs (modified) the first virtual address of each of the pages (at most max of them)
+ * @param max the room in vaddrs
+ * @return the number of virtual pages the frame is mapped at (possibly more than max)
+ */
+size_t rmap_vpages(const rmap_t* rmap, uint32_t paddr, uint64_t* vaddrs, size_t max);
+
+#define rmap_for_each(rmap, paddr, record) \
+	for (const rmap_record_t* record = rmap_first(rmap, paddr); record != NULL; record = rmap_next(rmap, record))
@@ -0,0 +1,64 @@
+/**
+ * @file sampling.c
+ * @brief Interval sampling of long programs, and the statistics of the samples
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <math.h> // sqrt()
+
+#include "sampling.h"
+#include "error.h"
+
+int sampling_init(sampling_t* sampling, size_t period, size_t window){
+	M_REQUIRE_NON_NULL(sampling);
+	if(period != 0){
+		M_REQUIRE(window > 0, ERR_BAD_PARAMETER, "%s", "Sampling window must not be empty");
+		M_REQUIRE(window <= period, ERR_BAD_PARAMETER,
+		          "Window (%zu) does not fit in the sampling period (%zu)", window, period);
+	}
+
+	sampling->period = period;
+	sampling->window = window;
+	return ERR_NONE;
+}
+
+sampling_phase_t sampling_phase(const sampling_t* sampling, size_t index){
+	if(sampling->period == 0) return PHASE_DETAILED;
+
+	const size_t pos = index % sampling->period;
+	return pos >= sampling->period - sampling->window ? PHASE_DETAILED : PHASE_FAST_FORWARD;
+}
+
+size_t sampling_run_length(const sampling_t* sampling, size_t index){
+	if(sampling->period == 0) return SIZE_MAX;
+
+	const size_t pos = index % sampling->period;
+	const size_t detailed = sampling->period - sampling->window;
+	return pos >= detailed ? sampling->period - pos : detailed - pos;
+}
+
+int sampling_window_end(const sampling_t* sampling, size_t index){
+	return sampling->period != 0 && index % sampling->period == sampling->period - 1;
+}
+
+void sample_stat_add(sample_stat_t* stat, double value){
+	++stat->nb_samples;
+	stat->sum += value;
+	stat->sum_sq += value * value;
+}
+
+double sample_stat_mean(const sample_stat_t* stat){
+	return stat->nb_samples == 0 ? 0.0 : stat->sum / (double) stat->nb_samples;
+}
+
+double sample_stat_ci95(const sample_stat_t* stat){
+	if(stat->nb_samples < 2) return 0.0;
+
+	const double n = (double) stat->nb_samples;
+	const double mean = stat->sum / n;
+	double variance = (stat->sum_sq - n * mean * mean) / (n - 1.0);
+	if(variance < 0.0) variance = 0.0; // rounding errors
+	return SAMPLING_Z_95 * sqrt(variance / n);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ * @file sampling.h
+ * @brief Interval sampling of long programs, and the statistics of the samples
+ *
+ * A program is cut in sampling units of `period` commands. The end of every unit,
+ * a measured window of `window` commands, is simulated in detail. The beginning of the
+ * unit is only fast-forwarded, with functional warming of the TLBs and caches (their
+ * state is kept up to date, nothing is measured), so no warmup is needed before a window.
+ * Each measured window gives one sample of every rate, from which the mean rate
+ * and its confidence interval are estimated.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint64_t
+
+#define SAMPLING_Z_95 1.96 // normal quantile for a 95% confidence interval
+
+typedef enum {
+	PHASE_FAST_FORWARD,
+	PHASE_DETAILED
+} sampling_phase_t;
+
+typedef struct {
+	size_t period; // number of commands per sampling unit; 0 to simulate everything in detail
+	size_t window; // number of measured commands at the end of each unit
+} sampling_t;
+
+typedef struct {
+	size_t nb_samples;
+	double sum;
+	double sum_sq; // sum of the squares
+} sample_stat_t;
+
+/**
+ * @brief "Constructor" for sampling_t.
+ * @param sampling (modified) the sampling to be initialized
+ * @param period number of commands per sampling unit (0 for no sampling at all)
+ * @param window number of measured commands per unit; must be positive, and not exceed period, if period is
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int sampling_init(sampling_t* sampling, size_t period, size_t window);
+
+/**
+ * @brief Tell how a command has to be simulated.
+ * @param sampling the sampling
+ * @param index the index of the command in the program (starting at 0)
+ * @return the phase of the command
+ */
+sampling_phase_t sampling_phase(const sampling_t* sampling, size_t index);
+
+/**
+ * @brief Number of consecutive commands, from a given one, in the same phase
+ * (and thus in the same measured window, if any).
+ * @param sampling the sampling
+ * @param index the index of the first command (starting at 0)
+ * @return the number of commands, SIZE_MAX if there is no sampling
+ */
+size_t sampling_run_length(const sampling_t* sampling, size_t index);
+
+/**
+ * @brief Tell whether a command is the last one of a measured window.
+ * @param sampling the sampling
+ * @param index the index of the command in the program (starting at 0)
+ * @return 1 if it is, 0 otherwise
+ */
+int sampling_window_end(const sampling_t* sampling, size_t index);
+
+/**
+ * @brief Add one sample to a statistic. A zero-initialized sample_stat_t is empty.
+ * @param stat (modified) the statistic
+ * @param value the value of the sample
+ */
+void sample_stat_add(sample_stat_t* stat, double value);
+
+/**
+ * @brief Mean of the samples of a statistic.
+ * @param stat the statistic
+ * @return the mean, 0 if there is no sample
+ */
+double sample_stat_mean(const sample_stat_t* stat);
+
+/**
+ * @brief Half-width of the 95% confidence interval of the mean of a statistic
+ * (normal approximation, with the unbiased sample variance).
+ * @param stat the statistic
+ * @return the half-width, 0 with less than 2 samples
+ */
+double sample_stat_ci95(const sample_stat_t* stat);
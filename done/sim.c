@@ -0,0 +1,536 @@
+/**
+ * @file sim.c
+ * @brief Trace-driven simulation of the TLB and cache hierarchies, optionally sampled
+ *
+ * Without sampling, every command goes through the TLB and cache hierarchies and the
+ * exact miss rates are reported. With sampling (see sampling.h), only the end of every
+ * sampling unit is simulated in detail; the rest is fast-forwarded with functional
+ * warming: every command still goes through the TLB and cache hierarchies (so their
+ * contents and LRU ages are kept up to date), but nothing is probed nor counted. The
+ * reported rates are then the means over the measured windows, with their 95%
+ * confidence intervals, and the number of misses is extrapolated to the whole program.
+ * Optionally (-c), consecutive reads of the same line are coalesced (see coalesce.h):
+ * the repeats are accounted as hits without going through the hierarchies.
+ * Optionally (-k), the memory pages written are saved every given number of commands,
+ * and at the end, in incremental checkpoints (see mem_checkpoint()).
+ * Optionally (-p), the L2 TLB misses are translated through page-walk caches (see pwc.h),
+ * and the number of page directory entries read per walk is reported.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "addr_mng.h"
+#include "commands.h"
+#include "command_stream.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "tlb_hrchy.h"
+#include "tlb_hrchy_mng.h"
+#include "cache_mng.h"
+#include "sampling.h"
+#include "coalesce.h"
+#include "pwc.h"
+
+#include <stdio.h>
+#include <stdlib.h> // strtoull()
+#include <string.h>
+#include <inttypes.h> // for PRIu64
+#include <assert.h>
+
+typedef enum {
+    M_L1_ITLB,
+    M_L1_DTLB,
+    M_L2_TLB,
+    M_L1_ICACHE,
+    M_L1_DCACHE,
+    M_L2_CACHE,
+    NB_METRICS
+} metric_t;
+
+static const char* const metric_names[NB_METRICS] = {
+    "L1 ITLB", "L1 DTLB", "L2 TLB (walks)", "L1 ICACHE", "L1 DCACHE", "L2 CACHE (memory)"
+};
+
+typedef struct {
+    uint64_t accesses; // in the whole program
+    uint64_t window_accesses; // in the current measured window
+    uint64_t window_misses;
+    sample_stat_t rate; // one miss rate sample per measured window
+} metric_stat_t;
+
+typedef struct {
+    void* mem_space;
+    size_t mem_size;
+    l1_itlb_entry_t l1_itlb[L1_ITLB_LINES];
+    l1_dtlb_entry_t l1_dtlb[L1_DTLB_LINES];
+    l2_tlb_entry_t l2_tlb[L2_TLB_LINES];
+    l1_icache_entry_t l1_icache[L1_ICACHE_LINES * L1_ICACHE_WAYS];
+    l1_dcache_entry_t l1_dcache[L1_DCACHE_LINES * L1_DCACHE_WAYS];
+    l2_cache_entry_t l2_cache[L2_CACHE_LINES * L2_CACHE_WAYS];
+    metric_stat_t metrics[NB_METRICS];
+    uint64_t nb_phase[PHASE_DETAILED + 1]; // number of commands per phase
+    size_t checkpoint_period; // number of commands between checkpoints, 0 if none
+    const char* checkpoint_prefix; // checkpoints are written to checkpoint_prefix.N.ckpt
+    mem_checkpointer_t checkpointer;
+    int cached_walks; // whether L2 TLB misses go through the page-walk caches
+    pwc_t pwc;
+} sim_t;
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-c] [-k period prefix] [-H thp|tlb] [-p pwc_geometry] (dump|desc|image) mem_filename command_filename [period window]\n", pgm);
+    fprintf(stderr, "          (image: mem_filename is a description, compiled to mem_filename" MEM_IMAGE_SUFFIX " if needed)\n");
+    fprintf(stderr, "          (every command is simulated in detail if no period is given;\n");
+    fprintf(stderr, "           -c coalesces consecutive reads of the same line;\n");
+    fprintf(stderr, "           -k saves the memory written every period commands, and at the end, to prefix.N.ckpt;\n");
+    fprintf(stderr, "           -H backs the memory with transparent (thp) or reserved (tlb) huge pages;\n");
+    fprintf(stderr, "           -p caches the PGD, PUD and PMD entries read by page walks, the geometry being\n");
+    fprintf(stderr, "              SETSxWAYS,SETSxWAYS,SETSxWAYS for the three levels, e.g. 1x4,4x4,16x4)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin commands01.txt\n", pgm);
+    fprintf(stderr, "          %s desc memory_description.txt commands01.bin 100000 10000\n", pgm);
+}
+
+// ======================================================================
+/**
+ * @brief Records accesses of the current measured window to a metric.
+ * @param stat (modified) the metric
+ * @param accesses the number of accesses
+ * @param misses how many of them missed
+ */
+static void count(metric_stat_t* stat, uint64_t accesses, uint64_t misses)
+{
+    stat->window_accesses += accesses;
+    stat->window_misses += misses;
+}
+
+// ======================================================================
+/**
+ * @brief Closes a measured window: adds its miss rates to the samples.
+ */
+static void end_window(sim_t* sim)
+{
+    for (int m = 0; m < NB_METRICS; ++m) {
+        metric_stat_t* stat = &sim->metrics[m];
+        if (stat->window_accesses > 0) {
+            sample_stat_add(&stat->rate, (double) stat->window_misses / (double) stat->window_accesses);
+        }
+        stat->window_accesses = 0;
+        stat->window_misses = 0;
+    }
+}
+
+// ======================================================================
+/**
+ * @brief Translates an address through the TLB hierarchy (and the page walk on a miss).
+ * @param sim (modified) the simulator
+ * @param vaddr the address to translate
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param paddr (modified) the translation
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int translate(sim_t* sim, virt_addr64_t vaddr, mem_access_t access, phy_addr_t* paddr)
+{
+    int hit = 0;
+    if (sim->cached_walks) {
+        M_EXIT_IF_ERR(tlb_search_cached64(&sim->pwc, vaddr, paddr, access,
+                                          sim->l1_itlb, sim->l1_dtlb, sim->l2_tlb, &hit),
+                      "Error translating address");
+    } else {
+        M_EXIT_IF_ERR(tlb_search64(sim->mem_space, vaddr, paddr, access,
+                                   sim->l1_itlb, sim->l1_dtlb, sim->l2_tlb, &hit),
+                      "Error translating address");
+    }
+    return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Reads or writes the data of a command through the cache hierarchy.
+ * @param sim (modified) the simulator
+ * @param command the command
+ * @param paddr the translation of its address
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int access_caches(sim_t* sim, const command_t* command, phy_addr_t* paddr)
+{
+    void* l1_cache = command->type == INSTRUCTION ? (void*) sim->l1_icache : (void*) sim->l1_dcache;
+    word_t word = 0;
+    uint8_t byte = 0;
+    if (command->order == READ) {
+        if (command->data_size == sizeof(word_t)) {
+            M_EXIT_IF_ERR(cache_read(sim->mem_space, paddr, command->type, l1_cache, sim->l2_cache, &word, LRU),
+                          "Error reading word");
+        } else {
+            M_EXIT_IF_ERR(cache_read_byte(sim->mem_space, paddr, command->type, l1_cache, sim->l2_cache, &byte, LRU),
+                          "Error reading byte");
+        }
+    } else {
+        if (command->data_size == sizeof(word_t)) {
+            M_EXIT_IF_ERR(cache_write(sim->mem_space, paddr, sim->l1_dcache, sim->l2_cache, &command->write_data, LRU),
+                          "Error writing word");
+        } else {
+            M_EXIT_IF_ERR(cache_write_byte(sim->mem_space, paddr, sim->l1_dcache, sim->l2_cache,
+                                           (uint8_t) command->write_data, LRU),
+                          "Error writing byte");
+        }
+    }
+    return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Simulates a command (of a measured window) through the TLB and cache hierarchies.
+ * @param sim (modified) the simulator
+ * @param command the command to simulate
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int simulate(sim_t* sim, const command_t* command)
+{
+    const int instr = command->type == INSTRUCTION;
+    phy_addr_t paddr;
+    // packed once: the TLBs and the page walk then only extract its fields
+    const virt_addr64_t vaddr = virt_addr64_pack(&command->vaddr);
+
+    // TLBs: probe before searching, tlb_search() does not tell which level hit
+    const int l1_tlb_hit = instr
+        ? tlb_hit64(vaddr, &paddr, sim->l1_itlb, L1_ITLB) == HIT
+        : tlb_hit64(vaddr, &paddr, sim->l1_dtlb, L1_DTLB) == HIT;
+    const int l2_tlb_hit = l1_tlb_hit || tlb_hit64(vaddr, &paddr, sim->l2_tlb, L2_TLB) == HIT;
+    M_EXIT_IF_ERR(translate(sim, vaddr, command->type, &paddr), "Error translating address");
+    count(&sim->metrics[instr ? M_L1_ITLB : M_L1_DTLB], 1, !l1_tlb_hit);
+    count(&sim->metrics[M_L2_TLB], 1, !l2_tlb_hit);
+
+    // caches: same, cache_hit() updates the ages
+    const void* l1_cache = instr ? (const void*) sim->l1_icache : (const void*) sim->l1_dcache;
+    const cache_t l1_type = instr ? L1_ICACHE : L1_DCACHE;
+    uint8_t way;
+    uint16_t index;
+    M_EXIT_IF_ERR(cache_probe(l1_cache, &paddr, &way, &index, l1_type), "Error probing L1 cache");
+    int l1_cache_hit = way != HIT_WAY_MISS;
+    int l2_cache_hit = l1_cache_hit;
+    if (!l1_cache_hit) {
+        M_EXIT_IF_ERR(cache_probe(sim->l2_cache, &paddr, &way, &index, L2_CACHE), "Error probing L2 cache");
+        l2_cache_hit = way != HIT_WAY_MISS;
+    }
+    count(&sim->metrics[instr ? M_L1_ICACHE : M_L1_DCACHE], 1, !l1_cache_hit);
+    count(&sim->metrics[M_L2_CACHE], 1, !l2_cache_hit);
+
+    return access_caches(sim, command, &paddr);
+}
+
+// ======================================================================
+/**
+ * @brief Executes a command with functional warming: the TLBs, the caches (contents
+ * and LRU ages) and the memory are updated as by simulate(), but nothing is probed
+ * nor counted, so that the next measured window starts from up-to-date state.
+ * @param sim (modified) the simulator
+ * @param command the command to execute
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int fast_forward(sim_t* sim, const command_t* command)
+{
+    phy_addr_t paddr;
+    M_EXIT_IF_ERR(translate(sim, virt_addr64_pack(&command->vaddr), command->type, &paddr),
+                  "Error translating address");
+    return access_caches(sim, command, &paddr);
+}
+
+// ======================================================================
+/**
+ * @brief Accounts for reads (of a measured window) that hit at every level
+ * (repeats of a coalesced group).
+ * @param sim (modified) the simulator
+ * @param command the first command of the group
+ * @param nb_hits the number of repeats
+ */
+static void repeat_hits(sim_t* sim, const command_t* command, uint64_t nb_hits)
+{
+    const int instr = command->type == INSTRUCTION;
+    count(&sim->metrics[instr ? M_L1_ITLB : M_L1_DTLB], nb_hits, 0);
+    count(&sim->metrics[M_L2_TLB], nb_hits, 0);
+    count(&sim->metrics[instr ? M_L1_ICACHE : M_L1_DCACHE], nb_hits, 0);
+    count(&sim->metrics[M_L2_CACHE], nb_hits, 0);
+}
+
+// ======================================================================
+/**
+ * @brief Runs a group of commands, split into runs of the same sampling phase.
+ * The first command of the group that is simulated (or fast-forwarded) brings its line
+ * in the L1 cache (and its translation in the L1 TLB): the following ones are plain hits.
+ * @param sim (modified) the simulator
+ * @param group the group to run
+ * @param index (modified) the index of the first command of the group; moved past it
+ * @param sampling how to sample the program
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int run_group(sim_t* sim, const access_group_t* group, uint64_t* index, const sampling_t* sampling)
+{
+    const int instr = group->command.type == INSTRUCTION;
+    const uint64_t size = (uint64_t) group->repeat + 1;
+    sim->metrics[instr ? M_L1_ITLB : M_L1_DTLB].accesses += size;
+    sim->metrics[instr ? M_L1_ICACHE : M_L1_DCACHE].accesses += size;
+    sim->metrics[M_L2_TLB].accesses += size;
+    sim->metrics[M_L2_CACHE].accesses += size;
+
+    int cached = 0;
+    for (uint64_t done = 0; done < size; ) {
+        const sampling_phase_t phase = sampling_phase(sampling, *index);
+        uint64_t n = sampling_run_length(sampling, *index);
+        if (n > size - done) n = size - done;
+
+        sim->nb_phase[phase] += n;
+        if (phase == PHASE_FAST_FORWARD) {
+            // repeats are reads of the same line: warming with the first command is enough
+            if (!cached) {
+                M_EXIT_IF_ERR(fast_forward(sim, &group->command), "Error fast-forwarding command");
+                cached = 1;
+            }
+        } else {
+            uint64_t nb_hits = n;
+            if (!cached) {
+                M_EXIT_IF_ERR(simulate(sim, &group->command), "Error simulating command");
+                cached = 1;
+                --nb_hits;
+            }
+            repeat_hits(sim, &group->command, nb_hits);
+        }
+
+        done += n;
+        *index += n;
+        if (sampling_window_end(sampling, *index - 1)) end_window(sim);
+    }
+    return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Saves the memory pages written since the previous checkpoint.
+ * @param sim (modified) the simulator
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int checkpoint(sim_t* sim)
+{
+    char filename[FILENAME_MAX];
+    const int len = snprintf(filename, sizeof(filename), "%s.%" PRIu64 ".ckpt", sim->checkpoint_prefix,
+                             sim->checkpointer.nb_checkpoints + 1);
+    M_REQUIRE(len > 0 && len < FILENAME_MAX, ERR_BAD_PARAMETER, "%s", "Checkpoint prefix too long");
+    return mem_checkpoint(&sim->checkpointer, filename);
+}
+
+// ======================================================================
+/**
+ * @brief Runs a whole program.
+ * @param sim (modified) the simulator
+ * @param coalescer the program to run
+ * @param sampling how to sample the program
+ * @return ERR_NONE if ok, appropriate error code otherwise
+ */
+static int run(sim_t* sim, coalescer_t* coalescer, const sampling_t* sampling)
+{
+    uint64_t index = 0;
+    access_group_t group;
+    while (coalescer_next(coalescer, &group) == ERR_NONE) {
+        M_EXIT_IF_ERR(run_group(sim, &group, &index, sampling), "Error running command");
+        if (sim->checkpoint_period != 0
+            && index >= (sim->checkpointer.nb_checkpoints + 1) * sim->checkpoint_period) {
+            M_EXIT_IF_ERR(checkpoint(sim), "Error taking checkpoint");
+        }
+    }
+    M_EXIT_IF_ERR(command_stream_status(coalescer->stream), "Error reading program");
+    // the last checkpoint holds the memory at the end of the program
+    if (sim->checkpoint_period != 0 && (sim->checkpointer.nb_dirty != 0 || sim->checkpointer.nb_checkpoints == 0)) {
+        M_EXIT_IF_ERR(checkpoint(sim), "Error taking checkpoint");
+    }
+
+    // a last, incomplete window is not a sample of the same size: it is dropped, unless nothing is sampled
+    if (sampling->period == 0) end_window(sim);
+    return ERR_NONE;
+}
+
+// ======================================================================
+static void report(FILE* output, const sim_t* sim, const sampling_t* sampling, const coalescer_t* coalescer)
+{
+    const uint64_t total = sim->nb_phase[PHASE_FAST_FORWARD] + sim->nb_phase[PHASE_DETAILED];
+    fprintf(output, "commands: %" PRIu64 " (detailed: %" PRIu64 ", fast-forwarded: %" PRIu64 ")\n",
+            total, sim->nb_phase[PHASE_DETAILED], sim->nb_phase[PHASE_FAST_FORWARD]);
+    if (sampling->period == 0) {
+        fputs("sampling: none (exact rates)\n", output);
+    } else {
+        fprintf(output, "sampling: period %zu, window %zu (%zu windows)\n",
+                sampling->period, sampling->window, sim->metrics[M_L2_TLB].rate.nb_samples);
+    }
+    if (coalescer->enabled) {
+        fprintf(output, "coalesced: %zu\n", coalescer->nb_merged);
+    }
+    if (sim->checkpoint_period != 0) {
+        fprintf(output, "checkpoints: %" PRIu64 "\n", sim->checkpointer.nb_checkpoints);
+    }
+    if (sim->cached_walks) {
+        static const char* const pwc_names[PWC_LEVELS] = { "PGD", "PUD", "PMD" };
+        const pwc_t* pwc = &sim->pwc;
+        fprintf(output, "page walks: %" PRIu64 " (%.3f entries read per walk, %" PRIu64 " invalidated)\n",
+                pwc->nb_walks, pwc->nb_walks == 0 ? 0.0 : (double) pwc->nb_reads / (double) pwc->nb_walks,
+                pwc->nb_invalidations);
+        for (size_t level = 0; level < PWC_LEVELS; ++level) {
+            const pwc_level_t* cache = &pwc->levels[level];
+            if (cache->nb_sets == 0) continue;
+            fprintf(output, "  %s cache %zux%zu: %" PRIu64 " hits / %" PRIu64 " lookups\n", pwc_names[level],
+                    cache->nb_sets, cache->nb_ways, cache->hits, cache->lookups);
+        }
+    }
+    size_t resident = 0;
+    size_t huge = 0;
+    if (mem_resident_size(sim->mem_space, sim->mem_size, &resident) == ERR_NONE
+        && mem_huge_size(sim->mem_space, sim->mem_size, &huge) == ERR_NONE) {
+        fprintf(output, "memory: %zu bytes (%zu resident, %zu on huge pages)\n", sim->mem_size, resident, huge);
+    }
+
+    fprintf(output, "%-18s %12s %10s %10s %14s\n", "level", "accesses", "miss rate", "+/- (95%)", "misses");
+    for (int m = 0; m < NB_METRICS; ++m) {
+        const metric_stat_t* stat = &sim->metrics[m];
+        const double rate = sample_stat_mean(&stat->rate);
+        fprintf(output, "%-18s %12" PRIu64 " %10.6f %10.6f %14.0f\n", metric_names[m], stat->accesses,
+                rate, sample_stat_ci95(&stat->rate), rate * (double) stat->accesses);
+    }
+}
+
+// ======================================================================
+static int parse_size(const char* arg, size_t* value)
+{
+    char* end = NULL;
+    const unsigned long long v = strtoull(arg, &end, 10);
+    M_REQUIRE(end != arg && *end == '\0' && arg[0] != '-', ERR_BAD_PARAMETER, "Invalid number \"%s\"", arg);
+    *value = (size_t) v;
+    return ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    const char* pgm_name = argv[0];
+    int coalesce = 0;
+    size_t checkpoint_period = 0;
+    const char* checkpoint_prefix = NULL;
+    const char* pwc_geometry = NULL;
+    size_t pwc_sets[PWC_LEVELS] = { 0 };
+    size_t pwc_ways[PWC_LEVELS] = { 0 };
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-c")) {
+            coalesce = 1;
+            ++argv;
+            --argc;
+        } else if (!strcmp(argv[1], "-k") && argc > 3
+                   && parse_size(argv[2], &checkpoint_period) == ERR_NONE && checkpoint_period != 0) {
+            checkpoint_prefix = argv[3];
+            argv += 3;
+            argc -= 3;
+        } else if (!strcmp(argv[1], "-H") && argc > 2
+                   && (!strcmp(argv[2], "thp") || !strcmp(argv[2], "tlb"))) {
+            mem_set_huge_pages(!strcmp(argv[2], "thp") ? MEM_HUGE_TRANSPARENT : MEM_HUGE_TLB);
+            argv += 2;
+            argc -= 2;
+        } else if (!strcmp(argv[1], "-p") && argc > 2 && pwc_parse(argv[2], pwc_sets, pwc_ways) == ERR_NONE) {
+            pwc_geometry = argv[2];
+            argv += 2;
+            argc -= 2;
+        } else {
+            error(pgm_name, "invalid option.");
+            return 1;
+        }
+    }
+
+    if (argc != 4 && argc != 6) {
+        error(pgm_name, "please provide memory format, memory file, program file, and optionally the sampling:");
+        return 1;
+    }
+    enum { DUMP, DESC, IMAGE } format = DUMP;
+    if (!strcmp(argv[1], "desc")) {
+        format = DESC;
+    } else if (!strcmp(argv[1], "image")) {
+        format = IMAGE;
+    } else if (strcmp(argv[1], "dump")) {
+        error(pgm_name, "unknown command.");
+        return 1;
+    }
+
+    size_t period = 0, window = 0;
+    sampling_t sampling;
+    if ((argc > 4 && (parse_size(argv[4], &period) != ERR_NONE || parse_size(argv[5], &window) != ERR_NONE))
+        || sampling_init(&sampling, period, window) != ERR_NONE) {
+        error(pgm_name, "invalid sampling.");
+        return 1;
+    }
+
+    sim_t* sim = calloc(1, sizeof(sim_t));
+    if (sim == NULL) {
+        error(pgm_name, "cannot allocate simulator.");
+        return 1;
+    }
+
+    int err = format == DUMP ? mem_init_from_dumpfile_mapped(argv[2], &sim->mem_space, &sim->mem_size)
+              : format == DESC ? mem_init_from_description(argv[2], &sim->mem_space, &sim->mem_size)
+              : mem_init_from_image(argv[2], NULL, &sim->mem_space, &sim->mem_size);
+    if (err != ERR_NONE) {
+        error(pgm_name, "cannot read memory.");
+        free(sim);
+        return 1;
+    }
+
+    command_stream_t pgm;
+    if (command_stream_open(argv[3], &pgm) != ERR_NONE) {
+        error(pgm_name, "cannot open program.");
+        mem_release(sim->mem_space, sim->mem_size);
+        free(sim);
+        return 1;
+    }
+
+    sim->checkpoint_period = checkpoint_period;
+    sim->checkpoint_prefix = checkpoint_prefix;
+    if (checkpoint_period != 0
+        && mem_checkpointer_init(&sim->checkpointer, sim->mem_space, sim->mem_size) != ERR_NONE) {
+        error(pgm_name, "cannot track memory writes.");
+        command_stream_close(&pgm);
+        mem_release(sim->mem_space, sim->mem_size);
+        free(sim);
+        return 1;
+    }
+
+    sim->cached_walks = pwc_geometry != NULL;
+    if (sim->cached_walks && pwc_init(&sim->pwc, sim->mem_space, pwc_sets, pwc_ways) != ERR_NONE) {
+        error(pgm_name, "cannot allocate page-walk caches.");
+        if (checkpoint_period != 0) mem_checkpointer_free(&sim->checkpointer);
+        command_stream_close(&pgm);
+        mem_release(sim->mem_space, sim->mem_size);
+        free(sim);
+        return 1;
+    }
+
+    tlb_flush(sim->l1_itlb, L1_ITLB);
+    tlb_flush(sim->l1_dtlb, L1_DTLB);
+    tlb_flush(sim->l2_tlb, L2_TLB);
+    cache_flush(sim->l1_icache, L1_ICACHE);
+    cache_flush(sim->l1_dcache, L1_DCACHE);
+    cache_flush(sim->l2_cache, L2_CACHE);
+
+    coalescer_t coalescer;
+    err = coalescer_init(&coalescer, &pgm, coalesce);
+    if (err == ERR_NONE) err = run(sim, &coalescer, &sampling);
+    command_stream_close(&pgm);
+    if (err == ERR_NONE) {
+        report(stdout, sim, &sampling, &coalescer);
+    } else {
+        fprintf(stderr, "ERROR: simulation failed: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+    }
+
+    if (sim->cached_walks) pwc_free(&sim->pwc);
+    if (checkpoint_period != 0) mem_checkpointer_free(&sim->checkpointer);
+    mem_release(sim->mem_space, sim->mem_size);
+    free(sim);
+    return err == ERR_NONE ? 0 : 1;
+}
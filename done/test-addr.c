@@ -280,6 +280,39 @@ START_TEST(init_phy_addr_test)
 }
 END_TEST
 
+// ===================== TC6 ===================== 
+START_TEST(virt_addr64_fields_test)
+{
+    virt_addr_t vaddr;
+    zero_init_var(vaddr);
+    uint64_t in = 0;
+
+    srand(time(NULL) ^ getpid() ^ (int)pthread_self());
+#pragma GCC diagnostic pop
+
+    // check reserved bits are ignored
+    in = 0xFFFFFFFFFFFFFFFF; //all ones
+    ck_assert_int_eq(virt_addr64_pgd_entry(in), 0x1FF);
+    ck_assert_int_eq(virt_addr64_page_offset(in), 0xFFF);
+    ck_assert(virt_addr64_virtual_page_number(in) == 0xFFFFFFFFF);
+
+    // check packed fields are the ones of the bitfield, and packing is identity
+    REPEAT(100) {
+        in = (uint64_t) generate_Nbit_random(48);
+
+        (void) init_virt_addr64(&vaddr, in);
+
+        ck_assert_int_eq(virt_addr64_pgd_entry(in), vaddr.pgd_entry);
+        ck_assert_int_eq(virt_addr64_pud_entry(in), vaddr.pud_entry);
+        ck_assert_int_eq(virt_addr64_pmd_entry(in), vaddr.pmd_entry);
+        ck_assert_int_eq(virt_addr64_pte_entry(in), vaddr.pte_entry);
+        ck_assert_int_eq(virt_addr64_page_offset(in), vaddr.page_offset);
+        ck_assert(virt_addr64_virtual_page_number(in) == virt_addr_t_to_virtual_page_number(&vaddr));
+        ck_assert(virt_addr64_pack(&vaddr) == in);
+    }
+}
+END_TEST
+
 // ======================================================================
 Suite* addr_test_suite()
 {
@@ -302,6 +335,9 @@ Suite* addr_test_suite()
     Add_Case(s, tc5, "PHY ADDR");
     tcase_add_test(tc5, init_phy_addr_test);
     
+    Add_Case(s, tc6, "PACKED VIRT ADDR");
+    tcase_add_test(tc6, virt_addr64_fields_test);
+    
 
     return s;
 }
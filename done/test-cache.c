@@ -17,8 +17,10 @@
 
 #include "cache_mng.h"
 #include "commands.h"
+#include "command_stream.h"
 #include "memory.h"
 #include "page_walk.h"
+#include "vpn_map.h"
 
 // #include <stdio.h>
 #include <assert.h>
@@ -39,13 +41,14 @@ static void error(const char* pgm, const char* msg)
 
 // ======================================================================
 void execute_command(void *mem_space,
+                     const vpn_map_t* map,
                      const command_t* command,
                      l1_icache_entry_t *l1_icache,
                      l1_icache_entry_t *l1_dcache,
                      l2_cache_entry_t *l2_cache)
 {
     phy_addr_t paddr;
-    assert(page_walk(mem_space, &command->vaddr, &paddr) == ERR_NONE);
+    assert(vpn_map_translate(map, &command->vaddr, &paddr) == ERR_NONE);
     uint8_t byte;
     uint32_t word;
     void *l1_cache;
@@ -93,14 +96,18 @@ int main(int argc, char *argv[])
     size_t mem_size = 0;
     int err = ERR_NONE;
     if (dump)
-        err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+        err = mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size);
     else
         err = mem_init_from_description(argv[2], &mem_space, &mem_size);
 
 
-    program_t pgm;
+    // one flat map instead of a page walk per command
+    vpn_map_t map;
+    if (err == ERR_NONE) err = vpn_map_init(&map, mem_space, mem_size);
+
+    command_stream_t pgm;
     if (err == ERR_NONE) {
-        if(program_read(argv[3], &pgm) == ERR_NONE) {
+        if(command_stream_open(argv[3], &pgm) == ERR_NONE) {
             l1_icache_entry_t l1_icache[L1_ICACHE_LINES * L1_ICACHE_WAYS];
             l1_icache_entry_t l1_dcache[L1_DCACHE_LINES * L1_DCACHE_WAYS];
             l2_cache_entry_t l2_cache[L2_CACHE_LINES * L2_CACHE_WAYS];
@@ -113,9 +120,9 @@ int main(int argc, char *argv[])
             assert(cache_flush(l1_dcache, L1_DCACHE) == ERR_NONE);
             assert(cache_flush(l2_cache, L2_CACHE) == ERR_NONE);
 
-            for_all_lines(line, &pgm) {
+            for_all_stream_lines(line, &pgm) {
                 //printf("executing command %d\n", *line);
-                execute_command(mem_space, line, l1_icache, l1_dcache, l2_cache);
+                execute_command(mem_space, &map, &line, l1_icache, l1_dcache, l2_cache);
 
                 printf("L1_ICACHE: \n\n");
                 cache_dump(stdout, l1_icache, L1_ICACHE);
@@ -131,6 +138,11 @@ int main(int argc, char *argv[])
                 cache_dump(stdout, l2_cache, L2_CACHE);
                 printf("\n=======================================\n\n");
             }
+            if (command_stream_status(&pgm) != ERR_NONE) {
+                error(argv[0], "problem reading program from provided file.");
+                (void)command_stream_close(&pgm);
+                return 3;
+            }
         } else {
             error(argv[0], "problem initializing program from provided file.");
             return 3;
@@ -140,7 +152,8 @@ int main(int argc, char *argv[])
         return 3;
     }
 
-    (void)program_free(&pgm);
-    free(mem_space);
+    (void)command_stream_close(&pgm);
+    vpn_map_free(&map);
+    mem_release(mem_space, mem_size);
     return 0;
 }
@@ -1,6 +1,8 @@
 #include "error.h"
 #include "commands.h"
+#include "commands_parallel.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 int main(int argc, char *argv[])
 {
@@ -10,8 +12,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // optional number of parsing threads (0 for one per processor)
     program_t pgm;
-    if (program_read(argv[1], &pgm) == ERR_NONE) {
+    const int err = argc < 3 ? program_read(argv[1], &pgm)
+                    : program_read_parallel(argv[1], &pgm, strtoul(argv[2], NULL, 10));
+    if (err == ERR_NONE) {
         (void)program_print(stdout, &pgm);
     }
     (void)program_free(&pgm);
@@ -27,7 +27,7 @@ static void error(const char* pgm, const char* msg)
     assert(msg != NULL);
     fputs("ERROR: ", stderr);
     fputs(msg, stderr);
-    fprintf(stderr, "\nusage:    %s (dump|desc) filename (p|o|u|n) spacer "\
+    fprintf(stderr, "\nusage:    %s (dump|desc|image) filename (p|o|u|n) spacer "\
             "[list of VA to print]\n", pgm);
     fprintf(stderr, "examples: %s dump memory_dump.bin o , 0xff000\n", pgm);
     fprintf(stderr, "          %s desc memory_description.txt o , 0xff000 0xfe000\n", pgm);
@@ -40,22 +40,25 @@ int main(int argc, char *argv[])
         error(argv[0], "please provide command, format, spacer and filename to read from:");
         return 1;
     }
-    int dump = 1;
-    if (strcmp(argv[1], "dump")) {
-        if (strcmp(argv[1], "desc")) {
-            error(argv[0], "unknown command.");
-            return 1;
-        }
-        dump = 0;
+    enum { DUMP, DESC, IMAGE } format = DUMP;
+    if (!strcmp(argv[1], "desc")) {
+        format = DESC;
+    } else if (!strcmp(argv[1], "image")) {
+        format = IMAGE;
+    } else if (strcmp(argv[1], "dump")) {
+        error(argv[0], "unknown command.");
+        return 1;
     }
 
     void* mem_space = NULL;
     size_t mem_size = 0;
     int err = ERR_NONE;
-    if (dump)
-        err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
-    else
+    if (format == DUMP)
+        err = mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size);
+    else if (format == DESC)
         err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    else
+        err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
 
     addr_fmt_t t_fmt;
     switch(argv[3][0]) {
@@ -91,7 +94,7 @@ int main(int argc, char *argv[])
             const int error = init_virt_addr64(&vaddr, vaddr64);
             if (error != ERR_NONE) {
                 puts("Mauvaise adresse ==> Abandon");
-                free(mem_space);
+                mem_release(mem_space, mem_size);
                 return 2;
             }
 
@@ -105,6 +108,6 @@ int main(int argc, char *argv[])
         return 3;
     }
 
-    free(mem_space);
+    mem_release(mem_space, mem_size);
     return 0;
 }
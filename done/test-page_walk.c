@@ -0,0 +1,172 @@
+/**
+ * @file test-page_walk.c
+ * @brief black-box testing of the batched page walk and of the flat translation map, against page_walk()
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#define _POSIX_C_SOURCE 200809L // for clock_gettime()
+
+#include "error.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "vpn_map.h"
+#include "commands.h"
+#include "command_stream.h"
+#include "addr.h"
+#include "addr_mng.h"
+
+#include <stdio.h>
+#include <stdlib.h> // realloc(), calloc(), free()
+#include <string.h>
+#include <time.h> // clock_gettime()
+#include <assert.h>
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s [-t] (dump|desc|image) mem_filename command_filename\n", pgm);
+    fprintf(stderr, "          (the addresses of all the commands are translated at once, and through a flat map,\n");
+    fprintf(stderr, "           and checked against page_walk(); -t also times the three)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin commands01.txt\n", pgm);
+    fprintf(stderr, "          %s -t desc memory_description.txt commands01.bin\n", pgm);
+}
+
+// ======================================================================
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// ======================================================================
+/**
+ * @brief Reads the virtual addresses of all the commands of a program.
+ */
+static int read_vaddrs(const char* filename, virt_addr_t** vaddrs, size_t* nb_vaddrs)
+{
+    command_stream_t stream;
+    M_EXIT_IF_ERR(command_stream_open(filename, &stream), "Error opening program");
+
+    size_t allocated = 0;
+    *vaddrs = NULL;
+    *nb_vaddrs = 0;
+    for_all_stream_lines(line, &stream) {
+        if (*nb_vaddrs == allocated) {
+            allocated = allocated == 0 ? 1024 : 2 * allocated;
+            virt_addr_t* bigger = realloc(*vaddrs, allocated * sizeof(virt_addr_t));
+            if (bigger == NULL) {
+                command_stream_close(&stream);
+                M_EXIT(ERR_MEM, "%s", "Cannot grow address array");
+            }
+            *vaddrs = bigger;
+        }
+        (*vaddrs)[(*nb_vaddrs)++] = line.vaddr;
+    }
+    const int err = command_stream_status(&stream);
+    command_stream_close(&stream);
+    return err;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    const char* pgm_name = argv[0];
+    int timed = 0;
+    if (argc > 1 && !strcmp(argv[1], "-t")) {
+        timed = 1;
+        ++argv;
+        --argc;
+    }
+    if (argc != 4) {
+        error(pgm_name, "please provide memory format, memory file and program file:");
+        return 1;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_BAD_PARAMETER;
+    if (!strcmp(argv[1], "dump")) err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "desc")) err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "image")) err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(pgm_name, "cannot read memory.");
+        return 1;
+    }
+
+    virt_addr_t* vaddrs = NULL;
+    size_t nb_vaddrs = 0;
+    if (read_vaddrs(argv[3], &vaddrs, &nb_vaddrs) != ERR_NONE) {
+        error(pgm_name, "cannot read program.");
+        free(vaddrs);
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+
+    phy_addr_t* paddrs = calloc(2 * nb_vaddrs + 1, sizeof(phy_addr_t));
+    int* errors = calloc(2 * nb_vaddrs + 1, sizeof(int));
+    err = paddrs == NULL || errors == NULL ? ERR_MEM : ERR_NONE;
+    phy_addr_t* walked = paddrs + nb_vaddrs;
+    int* walked_errors = errors + nb_vaddrs;
+
+    const double batch_start = now();
+    if (err == ERR_NONE) err = page_walk_batch(mem_space, vaddrs, paddrs, errors, nb_vaddrs);
+    const double batch_time = now() - batch_start;
+
+    const double single_start = now();
+    for (size_t i = 0; i < nb_vaddrs && err == ERR_NONE; ++i) {
+        walked_errors[i] = page_walk(mem_space, &vaddrs[i], &walked[i]);
+    }
+    const double single_time = now() - single_start;
+
+    size_t nb_unmapped = 0;
+    size_t nb_mismatches = 0;
+    for (size_t i = 0; i < nb_vaddrs && err == ERR_NONE; ++i) {
+        nb_unmapped += errors[i] != ERR_NONE;
+        if (walked_errors[i] != errors[i]
+            || (errors[i] == ERR_NONE && phy_addr_t_to_uint32_t(&walked[i]) != phy_addr_t_to_uint32_t(&paddrs[i]))) {
+            if (nb_mismatches++ == 0) printf("MISMATCH at address %zu\n", i);
+        }
+    }
+
+    // the map is timed from its construction
+    vpn_map_t map;
+    const double map_start = now();
+    if (err == ERR_NONE) err = vpn_map_init(&map, mem_space, mem_size);
+    for (size_t i = 0; i < nb_vaddrs && err == ERR_NONE; ++i) {
+        errors[i] = vpn_map_translate(&map, &vaddrs[i], &paddrs[i]);
+    }
+    const double map_time = now() - map_start;
+    if (err == ERR_NONE) vpn_map_free(&map);
+
+    for (size_t i = 0; i < nb_vaddrs && err == ERR_NONE; ++i) {
+        if (walked_errors[i] != errors[i]
+            || (errors[i] == ERR_NONE && phy_addr_t_to_uint32_t(&walked[i]) != phy_addr_t_to_uint32_t(&paddrs[i]))) {
+            if (nb_mismatches++ == 0) printf("MISMATCH in map at address %zu\n", i);
+        }
+    }
+
+    if (err == ERR_NONE) {
+        printf("addresses: %zu\n", nb_vaddrs);
+        printf("unmapped: %zu\n", nb_unmapped);
+        puts(nb_mismatches == 0 ? "consistent" : "INCONSISTENT");
+        if (timed && nb_vaddrs != 0) {
+            printf("page_walk_batch: %.1f ns per address\n", batch_time * 1e9 / (double) nb_vaddrs);
+            printf("page_walk: %.1f ns per address\n", single_time * 1e9 / (double) nb_vaddrs);
+            printf("vpn_map: %.1f ns per address\n", map_time * 1e9 / (double) nb_vaddrs);
+        }
+    } else {
+        fprintf(stderr, "ERROR: translation failed: %s\n", ERR_MESSAGES[err - ERR_NONE]);
+    }
+
+    free(errors);
+    free(paddrs);
+    free(vaddrs);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE && nb_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file test-pwc.c
+ * @brief black-box testing of the page-walk caches, and of their invalidation
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "pwc.h"
+#include "addr.h"
+#include "addr_mng.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h> // for SCNx64, PRIX32, PRIX64, PRIu64
+#include <assert.h>
+
+static const char* const level_names[PWC_LEVELS] = { "PGD", "PUD", "PMD" };
+static const char* const level_args[] = { "pgd", "pud", "pmd", "pte" };
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (dump|desc|image) mem_filename SETSxWAYS,SETSxWAYS,SETSxWAYS (vaddr | (pgd|pud|pmd|pte):vaddr=entry) ...\n", pgm);
+    fprintf(stderr, "          (each vaddr is translated through the caches, and checked against page_walk();\n");
+    fprintf(stderr, "           each entry argument writes an entry of the page directory of the given level translating vaddr)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin 1x4,4x4,16x4 0x40000000 0x40001000\n", pgm);
+    fprintf(stderr, "          %s desc memory_description.txt 0x0,0x0,1x1 0x40000000 pmd:0x40000000=0x3000 0x40000000\n", pgm);
+}
+
+// ======================================================================
+/**
+ * @brief Writes the entry of the page directory of the given level translating vaddr64,
+ * the way a program would (the memory is told about it).
+ */
+static int entry_write(void* memory, size_t mem_size, page_level_t level, uint64_t vaddr64, pte_t value)
+{
+    static const unsigned SHIFTS[] = {
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY,
+        PAGE_OFFSET
+    };
+
+    pte_t table = 0; // PGD
+    for (page_level_t l = PGD_LEVEL; ; ++l) {
+        const uint32_t paddr = table + (uint32_t) (((vaddr64 >> SHIFTS[l]) & (PD_ENTRIES - 1)) * sizeof(pte_t));
+        M_REQUIRE(paddr < mem_size, ERR_ADDR, "%s", "Page directory out of the memory");
+        pte_t* entry = (pte_t*) ((uint8_t*) memory + paddr);
+        if (l == level) {
+            *entry = value;
+            mem_written(memory, paddr, sizeof(pte_t));
+            return ERR_NONE;
+        }
+        M_REQUIRE(*entry != 0, ERR_ADDR, "%s", "Virtual address not mapped");
+        table = *entry;
+    }
+}
+
+// ======================================================================
+/**
+ * @brief Translates vaddr64 through the caches and by page_walk(), and prints the result.
+ * @return ERR_NONE if both agree, appropriate error code otherwise
+ */
+static int translate(pwc_t* pwc, uint64_t vaddr64)
+{
+    virt_addr_t vaddr;
+    M_EXIT_IF_ERR(init_virt_addr64(&vaddr, vaddr64), "Invalid virtual address");
+
+    phy_addr_t cached, walked;
+    const int err_cached = page_walk_cached(pwc, &vaddr, &cached, NULL);
+    const int err_walked = page_walk(pwc->mem_space, &vaddr, &walked);
+    printf("0x%016" PRIX64 " -> ", vaddr64);
+    if (err_cached != err_walked
+        || (err_cached == ERR_NONE && phy_addr_t_to_uint32_t(&cached) != phy_addr_t_to_uint32_t(&walked))) {
+        puts("MISMATCH");
+        return ERR_ADDR;
+    }
+    if (err_cached != ERR_NONE) puts("unmapped");
+    else printf("0x%08" PRIX32 "\n", phy_addr_t_to_uint32_t(&cached));
+    return ERR_NONE;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 4) {
+        error(argv[0], "please provide memory format, memory file and geometry:");
+        return 1;
+    }
+
+    size_t nb_sets[PWC_LEVELS], nb_ways[PWC_LEVELS];
+    if (pwc_parse(argv[3], nb_sets, nb_ways) != ERR_NONE) {
+        error(argv[0], "invalid geometry.");
+        return 1;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_BAD_PARAMETER;
+    if (!strcmp(argv[1], "dump")) err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "desc")) err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "image")) err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(argv[0], "cannot read memory.");
+        return 1;
+    }
+
+    pwc_t pwc;
+    if (pwc_init(&pwc, mem_space, nb_sets, nb_ways) != ERR_NONE) {
+        error(argv[0], "cannot build caches.");
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+
+    for (int i = 4; i < argc && err == ERR_NONE; ++i) {
+        char name[4] = "";
+        uint64_t vaddr64 = 0;
+        uint64_t value = 0;
+        int end = 0;
+        if (sscanf(argv[i], "%" SCNx64 "%n", &vaddr64, &end) == 1 && argv[i][end] == '\0') {
+            err = translate(&pwc, vaddr64);
+            continue;
+        }
+        page_level_t level = DATA_LEVEL;
+        if (sscanf(argv[i], "%3[a-z]:%" SCNx64 "=%" SCNx64, name, &vaddr64, &value) == 3) {
+            for (page_level_t l = PGD_LEVEL; l < DATA_LEVEL; ++l) {
+                if (!strcmp(name, level_args[l])) level = l;
+            }
+        }
+        if (level == DATA_LEVEL || value > UINT32_MAX) {
+            error(argv[0], "invalid argument.");
+            err = ERR_BAD_PARAMETER;
+        } else {
+            err = entry_write(mem_space, mem_size, level, vaddr64, (pte_t) value);
+        }
+    }
+
+    if (err == ERR_NONE) {
+        printf("walks: %" PRIu64 ", reads: %" PRIu64 ", invalidations: %" PRIu64 "\n",
+               pwc.nb_walks, pwc.nb_reads, pwc.nb_invalidations);
+        for (size_t level = 0; level < PWC_LEVELS; ++level) {
+            printf("%s: %" PRIu64 " hits / %" PRIu64 " lookups\n", level_names[level],
+                   pwc.levels[level].hits, pwc.levels[level].lookups);
+        }
+    }
+
+    pwc_free(&pwc);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
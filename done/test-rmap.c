@@ -0,0 +1,149 @@
+/**
+ * @file test-rmap.c
+ * @brief black-box testing of the reverse translation map, and of its updates
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+#include "rmap.h"
+#include "addr.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h> // for SCNx64, PRIX32, PRIX64
+#include <assert.h>
+
+static const char* const level_names[] = { "PGD", "PUD", "PMD", "PTE", "DATA" };
+static const char* const level_args[] = { "pgd", "pud", "pmd", "pte" };
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (dump|desc|image) mem_filename [(pgd|pud|pmd|pte):vaddr=entry ...]\n", pgm);
+    fprintf(stderr, "          (each argument writes an entry of the page directory of the given level\n");
+    fprintf(stderr, "           translating vaddr; the map is then printed, and checked against a new one)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin\n", pgm);
+    fprintf(stderr, "          %s desc memory_description.txt pte:0x40000000=0x5000 pmd:0x40000000=0\n", pgm);
+}
+
+// ======================================================================
+/**
+ * @brief Writes the entry of the page directory of the given level translating vaddr64,
+ * the way a program would (the memory is told about it).
+ */
+static int entry_write(void* memory, size_t mem_size, page_level_t level, uint64_t vaddr64, pte_t value)
+{
+    static const unsigned SHIFTS[] = {
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY,
+        PAGE_OFFSET
+    };
+
+    pte_t table = 0; // PGD
+    for (page_level_t l = PGD_LEVEL; ; ++l) {
+        const uint32_t paddr = table + (uint32_t) (((vaddr64 >> SHIFTS[l]) & (PD_ENTRIES - 1)) * sizeof(pte_t));
+        M_REQUIRE(paddr < mem_size, ERR_ADDR, "%s", "Page directory out of the memory");
+        pte_t* entry = (pte_t*) ((uint8_t*) memory + paddr);
+        if (l == level) {
+            *entry = value;
+            mem_written(memory, paddr, sizeof(pte_t));
+            return ERR_NONE;
+        }
+        M_REQUIRE(*entry != 0, ERR_ADDR, "%s", "Virtual address not mapped");
+        table = *entry;
+    }
+}
+
+// ======================================================================
+/**
+ * @brief Whether two maps hold the same records, frame by frame.
+ */
+static int rmap_same(const rmap_t* a, const rmap_t* b)
+{
+    if (a->nb_frames != b->nb_frames || a->nb_mappings != b->nb_mappings) return 0;
+    for (size_t frame = 0; frame < a->nb_frames; ++frame) {
+        const uint32_t paddr = (uint32_t) (frame * PAGE_SIZE);
+        const rmap_record_t* ra = rmap_first(a, paddr);
+        const rmap_record_t* rb = rmap_first(b, paddr);
+        for (; ra != NULL && rb != NULL; ra = rmap_next(a, ra), rb = rmap_next(b, rb)) {
+            if (ra->level != rb->level || ra->vaddr64 != rb->vaddr64) return 0;
+        }
+        if (ra != rb) return 0; // one of them has more records
+    }
+    return 1;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        error(argv[0], "please provide memory format and memory file:");
+        return 1;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_BAD_PARAMETER;
+    if (!strcmp(argv[1], "dump")) err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "desc")) err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "image")) err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(argv[0], "cannot read memory.");
+        return 1;
+    }
+
+    rmap_t rmap;
+    if (rmap_init(&rmap, mem_space, mem_size) != ERR_NONE) {
+        error(argv[0], "cannot build map.");
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+
+    for (int i = 3; i < argc && err == ERR_NONE; ++i) {
+        char name[4] = "";
+        uint64_t vaddr64 = 0;
+        uint64_t value = 0;
+        page_level_t level = DATA_LEVEL;
+        if (sscanf(argv[i], "%3[a-z]:%" SCNx64 "=%" SCNx64, name, &vaddr64, &value) == 3) {
+            for (page_level_t l = PGD_LEVEL; l < DATA_LEVEL; ++l) {
+                if (!strcmp(name, level_args[l])) level = l;
+            }
+        }
+        if (level == DATA_LEVEL || value > UINT32_MAX) {
+            error(argv[0], "invalid entry to write.");
+            err = ERR_BAD_PARAMETER;
+        } else {
+            err = entry_write(mem_space, mem_size, level, vaddr64, (pte_t) value);
+        }
+    }
+    if (err == ERR_NONE) err = rmap.error;
+
+    if (err == ERR_NONE) {
+        for (size_t frame = 0; frame < rmap.nb_frames; ++frame) {
+            const uint32_t paddr = (uint32_t) (frame * PAGE_SIZE);
+            rmap_for_each(&rmap, paddr, record) {
+                printf("0x%08" PRIX32 " %s 0x%016" PRIX64 "\n", paddr, level_names[record->level], record->vaddr64);
+            }
+        }
+        printf("mappings: %zu\n", rmap.nb_mappings);
+        printf("updates: %" PRIu64 "\n", rmap.nb_updates);
+
+        rmap_t fresh;
+        err = rmap_init(&fresh, mem_space, mem_size);
+        if (err == ERR_NONE) {
+            puts(rmap_same(&rmap, &fresh) ? "consistent" : "INCONSISTENT");
+            rmap_free(&fresh);
+        }
+    }
+
+    rmap_free(&rmap);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
@@ -15,6 +15,7 @@
 #include "util.h"
 #include "addr_mng.h"
 #include "commands.h"
+#include "command_stream.h"
 #include "memory.h"
 #include "tlb_hrchy.h"
 #include "tlb_hrchy_mng.h"
@@ -55,8 +56,8 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    program_t pgm;
-    if (program_read(argv[1], &pgm) != ERR_NONE) {
+    command_stream_t pgm;
+    if (command_stream_open(argv[1], &pgm) != ERR_NONE) {
         fprintf(stderr, "Cannot open \"%s\" for reading commands.\n", argv[1]);
         return 2;
     }
@@ -70,7 +71,7 @@ int main(int argc, char* argv[])
 
     void* mem_space = NULL;
     size_t mem_size = 0;
-    if (mem_init_from_dumpfile(argv[2], &mem_space, &mem_size) != ERR_NONE) {
+    if (mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size) != ERR_NONE) {
         fclose(f_out);
         fprintf(stderr, "Cannot read memory dump from \"%s\".\n", argv[2]);
         return 4;
@@ -95,16 +96,17 @@ int main(int argc, char* argv[])
     phy_addr_t paddr;
     zero_init_var(paddr);
 
-    for (size_t prog_line_index = 0; prog_line_index < pgm.nb_lines; prog_line_index++) {
+    size_t prog_line_index = 0;
+    for_all_stream_lines(line, &pgm) {
 
         int hit = 0;
-        fprintf(f_out, "\n" SIZE_T_FMT ": DATA/INSTRUCTION = %d\n", prog_line_index, pgm.listing[prog_line_index].type == DATA ? DATA : INSTRUCTION);
-        tlb_search(mem_space, &(pgm.listing[prog_line_index].vaddr), &paddr, pgm.listing[prog_line_index].type == DATA ? DATA : INSTRUCTION, l1_itlb, l1_dtlb, l2_tlb, &hit);
+        fprintf(f_out, "\n" SIZE_T_FMT ": DATA/INSTRUCTION = %d\n", prog_line_index, line.type == DATA ? DATA : INSTRUCTION);
+        tlb_search(mem_space, &(line.vaddr), &paddr, line.type == DATA ? DATA : INSTRUCTION, l1_itlb, l1_dtlb, l2_tlb, &hit);
 
         fprintf(f_out, "-------------------------------------------------------------------\n");
         fprintf(f_out, "After program line " SIZE_T_FMT "...\n\n", prog_line_index);
         fprintf(f_out, "VA = ");
-        print_virtual_address(f_out, &(pgm.listing[prog_line_index].vaddr));
+        print_virtual_address(f_out, &(line.vaddr));
         fprintf(f_out, "; PA  = ");
         print_physical_address(f_out, &paddr);
         fprintf(f_out, "\n\n");
@@ -122,15 +124,23 @@ int main(int argc, char* argv[])
 #pragma GCC diagnostic pop
 
         fprintf(f_out, "-------------------------------------------------------------------\n");
+        ++prog_line_index;
+    }
+
+    const int stream_err = command_stream_status(&pgm);
+    if (stream_err != ERR_NONE) {
+        fprintf(stderr, "Error reading commands from \"%s\" (line " SIZE_T_FMT "): %s\n",
+                argv[1], prog_line_index + 1, ERR_MESSAGES[stream_err - ERR_NONE]);
     }
 
     /**
      * Garbage collecting
      */
     fclose(f_out);
-    free(mem_space);
+    mem_release(mem_space, mem_size);
+    (void)command_stream_close(&pgm);
 
-    return EXIT_SUCCESS;
+    return stream_err == ERR_NONE ? EXIT_SUCCESS : 2;
 }
 
 
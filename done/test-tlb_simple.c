@@ -15,6 +15,7 @@
 #include "util.h"
 #include "addr_mng.h"
 #include "commands.h"
+#include "command_stream.h"
 #include "memory.h"
 #include "list.h"
 #include "tlb.h"
@@ -32,8 +33,8 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    program_t pgm;
-    if (program_read(argv[1], &pgm) != ERR_NONE) {
+    command_stream_t pgm;
+    if (command_stream_open(argv[1], &pgm) != ERR_NONE) {
         fprintf(stderr, "Cannot open \"%s\" for reading commands.", argv[1]);
         return 2;
     }
@@ -47,7 +48,7 @@ int main(int argc, char* argv[])
 
     void* mem_space = NULL;
     size_t mem_size = 0;
-    if (mem_init_from_dumpfile(argv[2], &mem_space, &mem_size) != ERR_NONE) {
+    if (mem_init_from_dumpfile_mapped(argv[2], &mem_space, &mem_size) != ERR_NONE) {
         fclose(f_out);
         fprintf(stderr, "Cannot read memory dump from \"%s\".", argv[2]);
         return 4;
@@ -77,14 +78,15 @@ int main(int argc, char* argv[])
     phy_addr_t paddr;
     zero_init_var(paddr);
 
-    for (size_t prog_line_index = 0; prog_line_index < pgm.nb_lines; prog_line_index++) {
+    size_t prog_line_index = 0;
+    for_all_stream_lines(line, &pgm) {
 
         int hit = 0;
-        int err = tlb_search(mem_space, &(pgm.listing[prog_line_index].vaddr), &paddr, tlb, &replacement_policy, &hit);
+        int err = tlb_search(mem_space, &line.vaddr, &paddr, tlb, &replacement_policy, &hit);
         fprintf(f_out, "-------------------------------------------------------------------\n");
         fprintf(f_out, "After program line " SIZE_T_FMT "...\n\n", prog_line_index);
         fprintf(f_out, "VA = ");
-        print_virtual_address(f_out, &(pgm.listing[prog_line_index].vaddr));
+        print_virtual_address(f_out, &line.vaddr);
         if (err == ERR_NONE) {
             fprintf(f_out, "; PA  = ");
             print_physical_address(f_out, &paddr);
@@ -104,6 +106,13 @@ int main(int argc, char* argv[])
             fprintf(f_out, "error with tlb_search(): %s\n", ERR_MESSAGES[err - ERR_NONE]);
         }
         fprintf(f_out, "-------------------------------------------------------------------\n");
+        ++prog_line_index;
+    }
+
+    const int stream_err = command_stream_status(&pgm);
+    if (stream_err != ERR_NONE) {
+        fprintf(stderr, "Error reading commands from \"%s\" (line " SIZE_T_FMT "): %s\n",
+                argv[1], prog_line_index + 1, ERR_MESSAGES[stream_err - ERR_NONE]);
     }
 
     /**
@@ -111,7 +120,8 @@ int main(int argc, char* argv[])
      */
     fclose(f_out);
     clear_list(&ll);
-    free(mem_space);
+    mem_release(mem_space, mem_size);
+    (void)command_stream_close(&pgm);
 
-    return EXIT_SUCCESS;
+    return stream_err == ERR_NONE ? EXIT_SUCCESS : 2;
 }
@@ -0,0 +1,177 @@
+/**
+ * @file test-vpn_map.c
+ * @brief black-box testing of the flat translation map, and of its updates
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include "error.h"
+#include "memory.h"
+#include "page_walk.h"
+#include "vpn_map.h"
+#include "addr.h"
+#include "addr_mng.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h> // for SCNx64, PRIX32, PRIX64, PRIu64
+#include <assert.h>
+
+static const char* const level_args[] = { "pgd", "pud", "pmd", "pte" };
+
+// ======================================================================
+static void error(const char* pgm, const char* msg)
+{
+    assert(msg != NULL);
+    fputs("ERROR: ", stderr);
+    fputs(msg, stderr);
+    fprintf(stderr, "\nusage:    %s (dump|desc|image) mem_filename (vaddr | (pgd|pud|pmd|pte):vaddr=entry) ...\n", pgm);
+    fprintf(stderr, "          (each vaddr is translated through the map, and checked against page_walk();\n");
+    fprintf(stderr, "           each entry argument writes an entry of the page directory of the given level translating vaddr;\n");
+    fprintf(stderr, "           the map is then checked against a new one)\n");
+    fprintf(stderr, "examples: %s dump memory_dump.bin 0x40000000 0x40001000\n", pgm);
+    fprintf(stderr, "          %s desc memory_description.txt pte:0x40000000=0x5000 0x40000000\n", pgm);
+}
+
+// ======================================================================
+/**
+ * @brief Writes the entry of the page directory of the given level translating vaddr64,
+ * the way a program would (the memory is told about it).
+ */
+static int entry_write(void* memory, size_t mem_size, page_level_t level, uint64_t vaddr64, pte_t value)
+{
+    static const unsigned SHIFTS[] = {
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY,
+        PAGE_OFFSET + PTE_ENTRY,
+        PAGE_OFFSET
+    };
+
+    pte_t table = 0; // PGD
+    for (page_level_t l = PGD_LEVEL; ; ++l) {
+        const uint32_t paddr = table + (uint32_t) (((vaddr64 >> SHIFTS[l]) & (PD_ENTRIES - 1)) * sizeof(pte_t));
+        M_REQUIRE(paddr < mem_size, ERR_ADDR, "%s", "Page directory out of the memory");
+        pte_t* entry = (pte_t*) ((uint8_t*) memory + paddr);
+        if (l == level) {
+            *entry = value;
+            mem_written(memory, paddr, sizeof(pte_t));
+            return ERR_NONE;
+        }
+        M_REQUIRE(*entry != 0, ERR_ADDR, "%s", "Virtual address not mapped");
+        table = *entry;
+    }
+}
+
+// ======================================================================
+/**
+ * @brief Translates vaddr64 through the map and by page_walk(), and prints the result.
+ * @return ERR_NONE if both agree, appropriate error code otherwise
+ */
+static int translate(const vpn_map_t* map, uint64_t vaddr64)
+{
+    virt_addr_t vaddr;
+    M_EXIT_IF_ERR(init_virt_addr64(&vaddr, vaddr64), "Invalid virtual address");
+
+    phy_addr_t mapped, walked;
+    const int err_mapped = vpn_map_translate(map, &vaddr, &mapped);
+    const int err_walked = page_walk(map->memory, &vaddr, &walked);
+    printf("0x%016" PRIX64 " -> ", vaddr64);
+    if (err_mapped != err_walked
+        || (err_mapped == ERR_NONE && phy_addr_t_to_uint32_t(&mapped) != phy_addr_t_to_uint32_t(&walked))) {
+        puts("MISMATCH");
+        return ERR_ADDR;
+    }
+    if (err_mapped != ERR_NONE) puts("unmapped");
+    else printf("0x%08" PRIX32 "\n", phy_addr_t_to_uint32_t(&mapped));
+    return ERR_NONE;
+}
+
+// ======================================================================
+/**
+ * @brief Whether two maps hold the same translations.
+ */
+static int vpn_map_same(const vpn_map_t* a, const vpn_map_t* b)
+{
+    if (a->usable != b->usable) return 0;
+    if (!a->usable) return 1; // both use page_walk()
+    if (a->nb_entries != b->nb_entries) return 0;
+    for (size_t i = 0; i < b->capacity; ++i) {
+        if (b->slots[i] == 0) continue;
+        const uint64_t vpn = (b->slots[i] >> PHY_PAGE_NUM) - 1;
+        virt_addr_t vaddr;
+        phy_addr_t pa, pb;
+        if (init_virt_addr64(&vaddr, vpn << PAGE_OFFSET) != ERR_NONE
+            || vpn_map_translate(a, &vaddr, &pa) != ERR_NONE
+            || vpn_map_translate(b, &vaddr, &pb) != ERR_NONE
+            || phy_addr_t_to_uint32_t(&pa) != phy_addr_t_to_uint32_t(&pb)) return 0;
+    }
+    return 1;
+}
+
+// ======================================================================
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        error(argv[0], "please provide memory format and memory file:");
+        return 1;
+    }
+
+    void* mem_space = NULL;
+    size_t mem_size = 0;
+    int err = ERR_BAD_PARAMETER;
+    if (!strcmp(argv[1], "dump")) err = mem_init_from_dumpfile(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "desc")) err = mem_init_from_description(argv[2], &mem_space, &mem_size);
+    else if (!strcmp(argv[1], "image")) err = mem_init_from_image(argv[2], NULL, &mem_space, &mem_size);
+    if (err != ERR_NONE) {
+        error(argv[0], "cannot read memory.");
+        return 1;
+    }
+
+    vpn_map_t map;
+    if (vpn_map_init(&map, mem_space, mem_size) != ERR_NONE) {
+        error(argv[0], "cannot build map.");
+        mem_release(mem_space, mem_size);
+        return 1;
+    }
+
+    for (int i = 3; i < argc && err == ERR_NONE; ++i) {
+        char name[4] = "";
+        uint64_t vaddr64 = 0;
+        uint64_t value = 0;
+        int end = 0;
+        if (sscanf(argv[i], "%" SCNx64 "%n", &vaddr64, &end) == 1 && argv[i][end] == '\0') {
+            err = translate(&map, vaddr64);
+            continue;
+        }
+        page_level_t level = DATA_LEVEL;
+        if (sscanf(argv[i], "%3[a-z]:%" SCNx64 "=%" SCNx64, name, &vaddr64, &value) == 3) {
+            for (page_level_t l = PGD_LEVEL; l < DATA_LEVEL; ++l) {
+                if (!strcmp(name, level_args[l])) level = l;
+            }
+        }
+        if (level == DATA_LEVEL || value > UINT32_MAX) {
+            error(argv[0], "invalid argument.");
+            err = ERR_BAD_PARAMETER;
+        } else {
+            err = entry_write(mem_space, mem_size, level, vaddr64, (pte_t) value);
+        }
+    }
+
+    if (err == ERR_NONE) {
+        printf("entries: %zu\n", map.nb_entries);
+        printf("updates: %" PRIu64 "\n", map.nb_updates);
+        puts(map.usable ? "usable" : "unusable (page_walk() used)");
+
+        vpn_map_t fresh;
+        err = vpn_map_init(&fresh, mem_space, mem_size);
+        if (err == ERR_NONE) {
+            puts(vpn_map_same(&map, &fresh) ? "consistent" : "INCONSISTENT");
+            vpn_map_free(&fresh);
+        }
+    }
+
+    vpn_map_free(&map);
+    mem_release(mem_space, mem_size);
+    return err == ERR_NONE ? 0 : 1;
+}
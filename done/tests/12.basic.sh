@@ -0,0 +1,40 @@
+#!/bin/bash
+
+## Basic tests for program formats (binary commands)
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: converts a text program to binary and back, and checks
+# that the result is the same as printing the text program directly
+check_round_trip() {
+
+    checkX "Test Commands" test-commands
+    checkX "Convert Commands" convert-commands
+
+    cmdfile="tests/files/$1"
+    [ -f "$cmdfile" ] || error "Expected command file \"$cmdfile\" not found."
+
+    binfile="$(new_tmp_file)"
+    txtfile="$(new_tmp_file)"
+    convert-commands txt2bin "$cmdfile" "$binfile" \
+        && convert-commands bin2txt "$binfile" "$txtfile" \
+        || (echo "FAIL"; exit 1)
+
+    diff <(test-commands "$cmdfile") "$txtfile" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (binary round trip, commands01): " $((++test))
+check_round_trip commands01.txt
+
+printf "Test %1d (binary round trip, commands02): " $((++test))
+check_round_trip commands02.txt
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,77 @@
+#!/bin/bash
+
+## Basic tests for multi-threaded program reading
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: checks that reading $1 with $2 threads gives the same
+# program as the (single-threaded) program_read()
+check_same_program() {
+
+    checkX "Test Commands" test-commands
+
+    diff <(test-commands "$1") <(test-commands "$1" "$2") \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# a program large enough to be split in several chunks
+bigfile="$(new_tmp_file)"
+for i in $(seq 1000); do cat tests/files/commands02.txt; done > "$bigfile"
+
+# the same, with one faulty line in the middle
+badfile="$(new_tmp_file)"
+{ cat "$bigfile"; echo "R X @0x0000000000000000"; cat "$bigfile"; } > "$badfile"
+
+# ======================================================================
+for n in 1 2 3 8 0; do
+    printf "Test %1d (parallel read, %d threads): " $((++test)) $n
+    check_same_program "$bigfile" $n
+done
+
+printf "Test %1d (parallel read, small file): " $((++test))
+check_same_program tests/files/commands01.txt 4
+
+# the faulty line is reported once, as a line of the file (not of a chunk)
+for n in "" 4; do
+    printf "Test %1d (faulty line, %s): " $((++test)) "${n:-program_read}"
+    errors="$(test-commands "$badfile" $n 2>&1 >/dev/null)"
+    [ -z "$(test-commands "$badfile" $n 2>/dev/null)" ] \
+        && [ "$(grep -c ":16001:" <<< "$errors")" -eq 1 ] \
+        && ! grep -q "line 8000" <<< "$errors" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+done
+
+# ======================================================================
+# the last line has no '\n': it is a command nevertheless
+nonl="$(new_tmp_file)"
+printf 'R I         @0x0000000000000000\nR DW        @0x0000000040200000' > "$nonl"
+
+for n in "" 4; do
+    printf "Test %1d (last line without newline, %s): " $((++test)) "${n:-program_read}"
+    [ "$(test-commands "$nonl" $n | wc -l)" -eq 2 ] \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+done
+
+# a line longer than MAX_COMMAND_LENGTH (36) is an error, not split
+long="$(new_tmp_file)"
+printf 'R I         @0x0000000000000000                 \nR I @0x0000000000000000\n' > "$long"
+
+printf "Test %1d (too long line): " $((++test))
+output="$(test-commands "$long" 2>&1)" \
+    && grep -q "Line too long" <<< "$output" \
+    && ! grep -q "^R " <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        exit 1)
+
+# ======================================================================
+echo "SUCCESS"
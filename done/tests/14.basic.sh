@@ -0,0 +1,69 @@
+#!/bin/bash
+
+## Basic tests for program formats (packed commands)
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: packs a text program and unpacks it back, and checks
+# that the result is the same as printing the text program directly
+check_round_trip() {
+
+    checkX "Test Commands" test-commands
+    checkX "Convert Commands" convert-commands
+
+    packfile="$(new_tmp_file)"
+    txtfile="$(new_tmp_file)"
+    convert-commands txt2pack "$1" "$packfile" \
+        && convert-commands pack2txt "$packfile" "$txtfile" \
+        || (echo "FAIL"; exit 1)
+
+    diff <(test-commands "$1") "$txtfile" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+# tool function: checks that the TLB hierarchy simulation gives the same
+# result when streaming the packed program as with the text one
+check_stream() {
+
+    checkX "Test TLB hierarchy" test-tlb_hrchy
+
+    ref='tests/files'
+    packfile="$(new_tmp_file)"
+    convert-commands txt2pack "${ref}/$1" "$packfile" || (echo "FAIL"; exit 1)
+
+    mytmp="$(new_tmp_file)"
+    test-tlb_hrchy "$packfile" "${ref}/$2" "$mytmp" 2>/dev/null
+
+    diff -w "$mytmp" "${ref}/$3" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# a program made of two interleaved strided streams
+stridedfile="$(new_tmp_file)"
+for i in $(seq 0 999); do
+    printf "R DW @0x%016X\nW DB 0x%02X @0x%016X\n" $((0x40000000 + 64 * i)) $((i % 256)) $((0x80000000 + 64 * i))
+done > "$stridedfile"
+
+# ======================================================================
+printf "Test %1d (packed round trip, commands01): " $((++test))
+check_round_trip tests/files/commands01.txt
+
+printf "Test %1d (packed round trip, commands02): " $((++test))
+check_round_trip tests/files/commands02.txt
+
+printf "Test %1d (packed round trip, strided): " $((++test))
+check_round_trip "$stridedfile"
+
+printf "Test %1d (packed stream, test-tlb_hrchy): " $((++test))
+check_stream commands02.txt memory-dump-01.mem output/tlb-hrchy-01-out.txt
+
+# ======================================================================
+echo "SUCCESS"
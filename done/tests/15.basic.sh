@@ -0,0 +1,62 @@
+#!/bin/bash
+
+## Basic tests for program printing and dumping
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: checks (byte for byte) that dumping $1 gives $2
+check_dump() {
+
+    checkX "Dump Commands" dump-commands
+
+    cmp <(dump-commands "$1") "$2" \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+checkX "Test Commands" test-commands
+checkX "Convert Commands" convert-commands
+
+# exact expected output (trailing spaces included)
+expected="$(new_tmp_file)"
+printf "%s\n" \
+"R I             @0x0000000000000000" \
+"R DW            @0x0000000040200000" \
+"R DB            @0x0000000040200002" \
+"W DB 0xAA       @0x0000000040000005" \
+"W DW 0x0000BEEF @0x0000000040000010" > "$expected"
+
+binfile="$(new_tmp_file)"
+packfile="$(new_tmp_file)"
+convert-commands txt2bin tests/files/commands01.txt "$binfile"
+convert-commands txt2pack tests/files/commands01.txt "$packfile"
+
+# a program larger than the print buffers
+bigfile="$(new_tmp_file)"
+for i in $(seq 5000); do cat tests/files/commands02.txt; done > "$bigfile"
+bigexpected="$(new_tmp_file)"
+test-commands "$bigfile" > "$bigexpected"
+
+# ======================================================================
+printf "Test %1d (program_print, exact output): " $((++test))
+cmp <(test-commands tests/files/commands01.txt) "$expected" \
+    && echo "PASS" || (echo "FAIL"; exit 1)
+
+printf "Test %1d (dump text program): " $((++test))
+check_dump tests/files/commands01.txt "$expected"
+
+printf "Test %1d (dump binary program): " $((++test))
+check_dump "$binfile" "$expected"
+
+printf "Test %1d (dump packed program): " $((++test))
+check_dump "$packfile" "$expected"
+
+printf "Test %1d (dump large program): " $((++test))
+check_dump "$bigfile" "$bigexpected"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,61 @@
+#!/bin/bash
+
+## Basic tests for the workload generator
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+# ======================================================================
+# tool function: generates a workload with pattern $1 (and options $2)
+# and checks that:
+#  - the program can be read back;
+#  - every address of it can be translated (no tlb_search() error);
+#  - the memory description and the memory dump hold the same memory.
+check_workload() {
+
+    checkX "Workload Generator" gen-workload
+    checkX "Dump Commands" dump-commands
+    checkX "Test TLB" test-tlb_simple
+    checkX "Test Memory" test-memory
+
+    outdir="$(mktemp -d)"
+    mytmp="$(new_tmp_file)"
+
+    ok=0
+    gen-workload $2 "$1" 500 "$outdir" \
+        && [ "$(dump-commands "$outdir"/commands.* | wc -l)" -eq 500 ] \
+        && test-tlb_simple "$outdir"/commands.* "$outdir/memory.mem" "$mytmp" \
+        && ! grep -q "error" "$mytmp" \
+        && diff <(test-memory dump "$outdir/memory.mem" o , 0x40000000 0x40001000) \
+                <(test-memory desc "$outdir/memory-desc.txt" o , 0x40000000 0x40001000) >/dev/null \
+        && ok=1
+    rm -rf "$outdir"
+
+    [ $ok -eq 1 ] \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (generator, seq): " $((++test))
+check_workload seq "-f 16384"
+
+printf "Test %1d (generator, stride): " $((++test))
+check_workload stride "-f 65536 -S 192 -w 0.5 -o bin"
+
+printf "Test %1d (generator, uniform): " $((++test))
+check_workload uniform "-f 1048576 -b 0.3 -o pack"
+
+printf "Test %1d (generator, zipf): " $((++test))
+check_workload zipf "-f 4194304 -z 1.2 -s 42"
+
+printf "Test %1d (generator, chase): " $((++test))
+check_workload chase "-f 65536"
+
+printf "Test %1d (generator, mixed): " $((++test))
+check_workload mixed "-f 262144 -c 32768 -i 0.5"
+
+# ======================================================================
+echo "SUCCESS"
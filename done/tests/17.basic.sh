@@ -0,0 +1,76 @@
+#!/bin/bash
+
+## Basic tests for the (sampled) simulation of the TLB and cache hierarchies
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Workload Generator" gen-workload
+
+DATA_DIR="$(dirname ${BASH_SOURCE[0]})/files"
+
+# ======================================================================
+# tool function: prints the miss rates reported by sim (one per line)
+miss_rates() {
+    sim "$@" | sed -n '/^level/,$p' | tail -n +2 | awk '{ print $(NF-2) }'
+}
+
+# ======================================================================
+printf "Test %1d (simulator, exact rates): " $((++test))
+mytmp="$(new_tmp_file)"
+sim dump "$DATA_DIR/memory-dump-01.mem" "$DATA_DIR/commands01.txt" > "$mytmp" \
+    && grep -q "^commands: 5 (detailed: 5, fast-forwarded: 0)$" "$mytmp" \
+    && [ "$(miss_rates dump "$DATA_DIR/memory-dump-01.mem" "$DATA_DIR/commands01.txt" | tr '\n' ' ')" \
+         = "1.000000 0.500000 0.600000 1.000000 0.750000 0.800000 " ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        exit 1)
+
+printf "Test %1d (simulator, bad sampling): " $((++test))
+! sim dump "$DATA_DIR/memory-dump-01.mem" "$DATA_DIR/commands01.txt" 100 160 >/dev/null 2>&1 \
+    && ! sim dump "$DATA_DIR/memory-dump-01.mem" "$DATA_DIR/commands01.txt" 100 0 >/dev/null 2>&1 \
+    && ! sim dump "$DATA_DIR/memory-dump-01.mem" "$DATA_DIR/commands01.txt" 100 10 5 >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        exit 1)
+
+outdir="$(mktemp -d)"
+gen-workload -f 1048576 -s 3 mixed 100000 "$outdir" >/dev/null
+
+printf "Test %1d (simulator, sampling every command): " $((++test))
+sim dump "$outdir/memory.mem" "$outdir/commands.txt" 1000 1000 > "$mytmp" \
+    && grep -q "^commands: 100000 (detailed: 100000, fast-forwarded: 0)$" "$mytmp" \
+    && grep -q "(100 windows)$" "$mytmp" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (simulator, sampled rates close to exact ones): " $((++test))
+paste <(miss_rates dump "$outdir/memory.mem" "$outdir/commands.txt") \
+      <(miss_rates desc "$outdir/memory-desc.txt" "$outdir/commands.txt" 5000 500) \
+    | awk '{ d = $1 - $2; if (d < 0) d = -d; if (d > 0.03) bad = 1 } END { exit bad }' \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+rm -rf "$outdir"
+
+# a working set that fits in the L2 cache but not in the L1 cache: windows starting
+# from stale caches (no warming while fast-forwarding) would see far more L2 misses
+gen-workload -f 32768 -s 3 uniform 200000 "$outdir" >/dev/null
+
+printf "Test %1d (simulator, fast-forward warms the caches): " $((++test))
+paste <(miss_rates dump "$outdir/memory.mem" "$outdir/commands.txt") \
+      <(miss_rates dump "$outdir/memory.mem" "$outdir/commands.txt" 20000 1000) \
+    | awk '{ d = $1 - $2; if (d < 0) d = -d; if (d > 0.01) bad = 1 } END { exit bad }' \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+## Basic tests for the coalescing of same-line reads in the simulator
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Workload Generator" gen-workload
+
+# ======================================================================
+# tool function: generates a workload with pattern $1 (and options $2)
+# and checks that coalescing changes nothing to what sim reports
+# (but the number of coalesced commands), with and without sampling.
+check_coalescing() {
+    outdir="$(mktemp -d)"
+    gen-workload $2 "$1" 50000 "$outdir" >/dev/null
+
+    ok=1
+    for sampling in "" "5000 500 1000" "777 100 13"; do
+        diff <(sim dump "$outdir/memory.mem" "$outdir"/commands.* $sampling | grep -v "^memory: ") \
+             <(sim -c dump "$outdir/memory.mem" "$outdir"/commands.* $sampling | grep -v "^coalesced: \|^memory: ") \
+             >/dev/null || ok=0
+    done
+    [ "$(sim -c dump "$outdir/memory.mem" "$outdir"/commands.* | grep "^coalesced: ")" != "coalesced: 0" ] || ok=0
+    rm -rf "$outdir"
+
+    [ $ok -eq 1 ] \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (coalescing, sequential reads): " $((++test))
+check_coalescing seq "-f 65536 -w 0 -o pack"
+
+printf "Test %1d (coalescing, sequential reads and writes): " $((++test))
+check_coalescing seq "-f 65536 -w 0.3 -b 0.5"
+
+printf "Test %1d (coalescing, mixed): " $((++test))
+check_coalescing mixed "-f 262144 -c 32768 -i 0.5 -o bin"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+## Basic tests for the L1 filter
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "L1 Filter" filter-l1
+checkX "Simulator" sim
+checkX "Workload Generator" gen-workload
+
+# ======================================================================
+# tool function: generates a workload with pattern $1 (and options $2)
+# and checks that replaying its L1 events gives exactly the L1 and L2
+# misses of the full simulation.
+check_filter() {
+    outdir="$(mktemp -d)"
+    gen-workload $2 "$1" 20000 "$outdir" >/dev/null
+
+    full="$(sim dump "$outdir/memory.mem" "$outdir"/commands.*)"
+    l1_misses=$(echo "$full" | awk '/^L1 [ID]CACHE/ { n += $NF } END { print n }')
+    l2_misses=$(echo "$full" | awk '/^L2 CACHE/ { print $NF }')
+
+    ok=0
+    filter-l1 dump "$outdir/memory.mem" "$outdir"/commands.* "$outdir/events" >/dev/null \
+        && replay="$(filter-l1 replay "$outdir/events")" \
+        && echo "$replay" | grep -q "^commands: 20000$" \
+        && echo "$replay" | grep -q "^L2 accesses: $l1_misses$" \
+        && echo "$replay" | grep -q "^L2 misses: $l2_misses " \
+        && ok=1
+    rm -rf "$outdir"
+
+    [ $ok -eq 1 ] \
+        && echo "PASS" \
+        || (echo "FAIL"; \
+            exit 1)
+}
+
+# ======================================================================
+printf "Test %1d (L1 filter, sequential): " $((++test))
+check_filter seq "-f 65536 -w 0.3 -b 0.3"
+
+printf "Test %1d (L1 filter, zipf): " $((++test))
+check_filter zipf "-f 1048576 -z 1.2 -w 0.3 -o pack"
+
+printf "Test %1d (L1 filter, mixed): " $((++test))
+check_filter mixed "-f 262144 -c 32768 -i 0.5 -w 0.2 -b 0.5 -o bin"
+
+printf "Test %1d (L1 filter, bad event file): " $((++test))
+mytmp="$(new_tmp_file)"
+echo "not an event file" > "$mytmp"
+! filter-l1 replay "$mytmp" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        exit 1)
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+## Basic tests for the mapped loading of memory dumps
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Test Memory" test-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 65536 -w 0.5 -s 11 uniform 20000 "$outdir" >/dev/null
+before="$(md5sum < "$outdir/memory.mem")"
+
+# ======================================================================
+printf "Test %1d (mapped dump, same content as description): " $((++test))
+diff <(test-memory dump "$outdir/memory.mem" o , 0x40000000 0x40008000) \
+     <(test-memory desc "$outdir/memory-desc.txt" o , 0x40000000 0x40008000) >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (mapped dump, same simulation as description): " $((++test))
+# (only the resident size may differ: a dump is mapped whole)
+diff <(sim dump "$outdir/memory.mem" "$outdir/commands.txt" | grep -v "^memory: ") \
+     <(sim desc "$outdir/memory-desc.txt" "$outdir/commands.txt" | grep -v "^memory: ") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (mapped dump, file untouched by writes): " $((++test))
+[ "$(md5sum < "$outdir/memory.mem")" = "$before" ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
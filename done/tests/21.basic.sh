@@ -0,0 +1,54 @@
+#!/bin/bash
+
+## Basic tests for the sparse memories created from descriptions
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Test Memory" test-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 65536 -w 0.5 -s 21 uniform 20000 "$outdir" >/dev/null
+# same pages in a 4 GiB physical memory
+sed '1s/.*/4294967296/' "$outdir/memory-desc.txt" > "$outdir/memory-desc-4g.txt"
+
+# ======================================================================
+printf "Test %1d (4 GiB description, same content): " $((++test))
+diff <(test-memory desc "$outdir/memory-desc.txt" o , 0x40000000 0x40008000) \
+     <(test-memory desc "$outdir/memory-desc-4g.txt" o , 0x40000000 0x40008000) >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (4 GiB description, same simulation): " $((++test))
+diff <(sim desc "$outdir/memory-desc.txt" "$outdir/commands.txt" | grep -v "^memory: ") \
+     <(sim desc "$outdir/memory-desc-4g.txt" "$outdir/commands.txt" | grep -v "^memory: ") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (4 GiB description, only used pages resident): " $((++test))
+sim desc "$outdir/memory-desc-4g.txt" "$outdir/commands.txt" \
+    | awk '/^memory: / { sub(/\(/, "", $4); exit !($2 == 4294967296 && $4 + 0 < 64 * 1048576) }' \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (too large description, error): " $((++test))
+sed '1s/.*/4294971392/' "$outdir/memory-desc.txt" > "$outdir/memory-desc-big.txt"
+! sim desc "$outdir/memory-desc-big.txt" "$outdir/commands.txt" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
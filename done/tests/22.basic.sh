@@ -0,0 +1,51 @@
+#!/bin/bash
+
+## Basic tests for the (concurrent) loading of the pages of a description
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Test Memory" test-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+# 4096 data pages
+gen-workload -f 16777216 -w 0.5 -s 22 uniform 20000 "$outdir" >/dev/null
+pages="$outdir/pages"
+
+# ======================================================================
+printf "Test %1d (many pages, same simulation as the dump): " $((++test))
+diff <(sim dump "$outdir/memory.mem" "$outdir/commands.txt" | grep -v "^memory: ") \
+     <(sim desc "$outdir/memory-desc.txt" "$outdir/commands.txt" | grep -v "^memory: ") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (page listed twice, the last one wins): " $((++test))
+sed "s|$pages/data_40000000.bin|$pages/data_40001000.bin|" "$outdir/memory-desc.txt" > "$outdir/replaced.txt"
+cp "$outdir/memory-desc.txt" "$outdir/twice.txt"
+echo "0x0000000040000000 $pages/data_40001000.bin" >> "$outdir/twice.txt"
+diff <(test-memory desc "$outdir/replaced.txt" o , 0x40000000 2>/dev/null) \
+     <(test-memory desc "$outdir/twice.txt" o , 0x40000000 2>/dev/null) >/dev/null \
+    && ! diff <(test-memory desc "$outdir/memory-desc.txt" o , 0x40000000 2>/dev/null) \
+              <(test-memory desc "$outdir/twice.txt" o , 0x40000000 2>/dev/null) >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (missing page file, error): " $((++test))
+rm "$pages/data_40002000.bin"
+! sim desc "$outdir/memory-desc.txt" "$outdir/commands.txt" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
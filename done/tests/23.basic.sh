@@ -0,0 +1,80 @@
+#!/bin/bash
+
+## Basic tests for the compiled memory images
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Memory Compiler" compile-memory
+checkX "Simulator" sim
+checkX "Test Memory" test-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 1048576 -w 0.5 -s 23 uniform 20000 "$outdir" >/dev/null
+desc="$outdir/memory-desc.txt"
+pages="$outdir/pages"
+
+# ======================================================================
+printf "Test %1d (compiled image, same content as description): " $((++test))
+compile-memory "$desc" "$outdir/explicit.img" \
+    && [ -f "$outdir/explicit.img" ] \
+    && diff <(test-memory desc "$desc" o , 0x40000000 0x40008000 2>/dev/null) \
+            <(test-memory image "$desc" o , 0x40000000 0x40008000 2>/dev/null) >/dev/null \
+    && [ -f "$desc.img" ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (compiled image, same simulation as description): " $((++test))
+diff <(sim desc "$desc" "$outdir/commands.txt" | grep -v "^memory: ") \
+     <(sim image "$desc" "$outdir/commands.txt" | grep -v "^memory: ") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (up-to-date image, not rebuilt): " $((++test))
+before="$(stat -c %Y.%i "$desc.img")"
+sleep 1
+test-memory image "$desc" o , 0x40000000 >/dev/null 2>&1 \
+    && [ "$(stat -c %Y.%i "$desc.img")" = "$before" ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (page file changed, image rebuilt): " $((++test))
+cp "$pages/data_40001000.bin" "$pages/data_40000000.bin"
+diff <(test-memory desc "$desc" o , 0x40000000 2>/dev/null) \
+     <(test-memory image "$desc" o , 0x40000000 2>/dev/null) >/dev/null \
+    && [ "$(stat -c %Y.%i "$desc.img")" != "$before" ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (invalid image, rebuilt): " $((++test))
+echo "not an image" > "$desc.img"
+diff <(test-memory desc "$desc" o , 0x40000000 2>/dev/null) \
+     <(test-memory image "$desc" o , 0x40000000 2>/dev/null) >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (missing page file, error): " $((++test))
+rm "$pages/data_40002000.bin"
+! compile-memory "$desc" >/dev/null 2>&1 \
+    && ! test-memory image "$desc" o , 0x40000000 >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
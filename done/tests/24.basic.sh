@@ -0,0 +1,75 @@
+#!/bin/bash
+
+## Basic tests for the incremental checkpoints of the memory
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Memory Restorer" restore-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 262144 -w 0.5 -s 24 uniform 20000 "$outdir" >/dev/null
+mem="$outdir/memory.mem"
+cmds="$outdir/commands.txt"
+
+# ======================================================================
+printf "Test %1d (no checkpoint restored, same memory): " $((++test))
+restore-memory dump "$mem" "$outdir/none.mem" \
+    && cmp -s "$mem" "$outdir/none.mem" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (checkpoint every 5000 commands, and at the end): " $((++test))
+sim -k 5000 "$outdir/often" dump "$mem" "$cmds" | grep -q "^checkpoints: 4$" \
+    && [ $(ls "$outdir"/often.*.ckpt | wc -l) -eq 4 ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (chain of checkpoints, same memory as one final checkpoint): " $((++test))
+sim -k 1000000 "$outdir/once" dump "$mem" "$cmds" | grep -q "^checkpoints: 1$" \
+    && restore-memory dump "$mem" "$outdir/often.mem" "$outdir"/often.{1,2,3,4}.ckpt \
+    && restore-memory dump "$mem" "$outdir/once.mem" "$outdir/once.1.ckpt" \
+    && cmp -s "$outdir/often.mem" "$outdir/once.mem" \
+    && ! cmp -s "$mem" "$outdir/once.mem" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (incremental: later checkpoints hold fewer pages than the memory): " $((++test))
+[ $(stat -c %s "$outdir/often.4.ckpt") -lt $(stat -c %s "$mem") ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (fast-forwarded writes tracked too): " $((++test))
+sim -k 3000 "$outdir/sampled" dump "$mem" "$cmds" 1000 100 >/dev/null \
+    && sim -k 1000000 "$outdir/sampled-once" dump "$mem" "$cmds" 1000 100 >/dev/null \
+    && restore-memory desc "$outdir/memory-desc.txt" "$outdir/sampled.mem" $(ls -v "$outdir"/sampled.*.ckpt) \
+    && restore-memory desc "$outdir/memory-desc.txt" "$outdir/sampled-once.mem" "$outdir/sampled-once.1.ckpt" \
+    && cmp -s "$outdir/sampled.mem" "$outdir/sampled-once.mem" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (checkpoint of another memory size, error): " $((++test))
+head -c 4096 "$mem" > "$outdir/small.mem"
+! restore-memory dump "$outdir/small.mem" "$outdir/bad.mem" "$outdir/once.1.ckpt" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
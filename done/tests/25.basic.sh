@@ -0,0 +1,56 @@
+#!/bin/bash
+
+## Basic tests for the memories backed by huge pages
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Simulator" sim
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 4096 -w 0.3 -s 25 uniform 20000 "$outdir" >/dev/null
+
+# ======================================================================
+for format in dump desc image; do
+    mem="$outdir/memory.mem"
+    [ $format = dump ] || mem="$outdir/memory-desc.txt"
+    for huge in thp tlb; do
+        printf "Test %1d (%s, -H %s, same results as small pages): " $((++test)) $format $huge
+        diff <(sim $format "$mem" "$outdir/commands.txt" | grep -v "^memory: ") \
+             <(sim -H $huge $format "$mem" "$outdir/commands.txt" | grep -v "^memory: ") >/dev/null \
+            && echo "PASS" \
+            || (echo "FAIL"; \
+                rm -rf "$outdir"; \
+                exit 1)
+    done
+done
+
+printf "Test %1d (no huge pages unless asked for): " $((++test))
+sim dump "$outdir/memory.mem" "$outdir/commands.txt" \
+    | grep -q "^memory: .* 0 on huge pages)$" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (huge pages reported, never more than the memory): " $((++test))
+sim -H thp dump "$outdir/memory.mem" "$outdir/commands.txt" \
+    | awk '/^memory: / { exit !($0 ~ / on huge pages\)$/ && $6 + 0 <= $2) }' \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (invalid huge page kind, error): " $((++test))
+! sim -H big dump "$outdir/memory.mem" "$outdir/commands.txt" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+## Basic tests for the dumps of the memory
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Memory Dumper" dump-memory
+checkX "Test Memory" test-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 16384 -w 0.3 -s 26 uniform 1000 "$outdir" >/dev/null
+mem="$outdir/memory.mem"
+vaddr=$(head -1 "$outdir/commands.txt" | awk '{ sub(/^@/, "", $NF); print $NF }')
+
+# ======================================================================
+printf "Test %1d (raw dump of the whole memory, same as the memory): " $((++test))
+dump-memory -r dump "$mem" > "$outdir/raw.mem" \
+    && cmp -s "$mem" "$outdir/raw.mem" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (hexadecimal dump of the whole memory, same bytes): " $((++test))
+dump-memory desc "$outdir/memory-desc.txt" > "$outdir/hex.txt" \
+    && [ $(wc -l < "$outdir/hex.txt") -eq $(( $(stat -c %s "$mem") / 16 )) ] \
+    && cmp -s <(cut -d: -f2 "$outdir/hex.txt" | tr -d ' \n') <(od -An -v -tx1 "$mem" | tr -d ' \n' | tr a-f A-F) \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (one virtual page, same as vmem_page_dump()): " $((++test))
+cmp -s <(dump-memory dump "$mem" "$vaddr") <(test-memory dump "$mem" o " " "$vaddr") \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (raw range of virtual pages): " $((++test))
+dump-memory -r image "$outdir/memory-desc.txt" 0x40000000 3 > "$outdir/pages.bin" \
+    && cat "$outdir"/pages/data_4000{0,1,2}000.bin | cmp -s - "$outdir/pages.bin" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (invalid virtual address, error): " $((++test))
+! dump-memory dump "$mem" zz >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (page beyond the end of the memory, error): " $((++test))
+# the page tables come first: the data pages are cut off
+head -c 16384 "$mem" > "$outdir/short.mem"
+! dump-memory -r dump "$outdir/short.mem" 0x40000000 1 > "$outdir/short.bin" 2>/dev/null \
+    && [ ! -s "$outdir/short.bin" ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
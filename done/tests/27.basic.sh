@@ -0,0 +1,79 @@
+#!/bin/bash
+
+## Basic tests for the comparison of memories
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Memory Comparator" diff-memory
+checkX "Simulator" sim
+checkX "Memory Restorer" restore-memory
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 65536 -w 0.5 -s 27 uniform 2000 "$outdir" >/dev/null
+mem="$outdir/memory.mem"
+
+# ======================================================================
+printf "Test %1d (same memory as dump and description, no difference): " $((++test))
+diff-memory dump "$mem" desc "$outdir/memory-desc.txt" | grep -q "differing: 0, words: 0$" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (one word changed, found at its physical and virtual addresses): " $((++test))
+size=$(stat -c %s "$mem")
+cp "$mem" "$outdir/changed.mem"
+printf '\xDE\xAD\xBE\xEF' | dd of="$outdir/changed.mem" bs=1 seek=$((size - 4096 + 16)) conv=notrunc 2>/dev/null
+status=0
+output="$(diff-memory dump "$mem" dump "$outdir/changed.mem")" || status=$?
+[ $status -eq 1 ] \
+    && grep -q "differing: 1, words: 1$" <<< "$output" \
+    && grep -q "^    $(printf '0x%08X' $((size - 4096 + 16))) (0x0000000040.*0xEFBEADDE$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (memory after a run, only data pages differ): " $((++test))
+status=0
+sim -k 1000000 "$outdir/run" dump "$mem" "$outdir/commands.txt" >/dev/null \
+    && restore-memory dump "$mem" "$outdir/run.mem" "$outdir/run.1.ckpt" \
+    && { diff-memory -q dump "$mem" dump "$outdir/run.mem" > "$outdir/diff.txt" || status=$?; }
+[ $status -eq 1 ] \
+    && grep -q "^page 0x.* (0x0000000040" "$outdir/diff.txt" \
+    && ! grep -q "PGD\|PUD\|PMD\|PTE\|^    " "$outdir/diff.txt" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (memories of different sizes): " $((++test))
+head -c $((size - 4096)) "$mem" > "$outdir/small.mem"
+status=0
+output="$(diff-memory dump "$mem" dump "$outdir/small.mem")" || status=$?
+[ $status -eq 1 ] \
+    && grep -q "^sizes differ: $size $((size - 4096))$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (difference in a last, partial page): " $((++test))
+head -c $((size - 4096 + 18)) "$outdir/changed.mem" > "$outdir/partial.mem"
+status=0
+output="$(diff-memory dump "$mem" dump "$outdir/partial.mem")" || status=$?
+[ $status -eq 1 ] \
+    && grep -q "differing: 1, words: 1$" <<< "$output" \
+    && grep -q "^    $(printf '0x%08X' $((size - 4096 + 16))) .*0x0000ADDE$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
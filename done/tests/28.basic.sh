@@ -0,0 +1,94 @@
+#!/bin/bash
+
+## Basic tests for the reverse translation map
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Test Reverse Map" test-rmap
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 65536 -w 0.5 -s 28 uniform 100 "$outdir" >/dev/null
+desc="$outdir/memory-desc.txt"
+nb_pages=$(grep -c " .*/data_" "$desc")
+
+# ======================================================================
+# map_check expected_mappings [entries to write]: the map is right, and as a new one
+map_check() {
+    expected=$1
+    shift
+    output="$(test-rmap desc "$desc" "$@")" \
+        && grep -q "^mappings: $expected$" <<< "$output" \
+        && grep -q "^consistent$" <<< "$output"
+}
+
+printf "Test %1d (every data page of the description mapped once): " $((++test))
+map_check $nb_pages \
+    && [ $(test-rmap desc "$desc" | grep -c " DATA ") -eq $nb_pages ] \
+    && test-rmap desc "$desc" | grep -q "^0x00000000 PGD 0x0000000000000000$" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (same map from a dump): " $((++test))
+diff <(test-rmap desc "$desc") <(test-rmap dump "$outdir/memory.mem") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+frame=$(test-rmap desc "$desc" | awk '$3 == "0x0000000040001000" { print $1 }')
+printf "Test %1d (PTE entry changed: frame mapped twice): " $((++test))
+map_check $nb_pages pte:0x40000000=$frame \
+    && [ $(test-rmap desc "$desc" pte:0x40000000=$frame | grep -c "^$frame DATA ") -eq 2 ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PTE entry cleared: page unmapped): " $((++test))
+map_check $((nb_pages - 1)) pte:0x40000000=0 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PMD entry cleared, then restored: whole subtree forgotten, then back): " $((++test))
+pte=$(test-rmap desc "$desc" | awk '$2 == "PTE" { print $1; exit }')
+map_check 0 pmd:0x40000000=0 \
+    && ! test-rmap desc "$desc" pmd:0x40000000=0 | grep -q " PTE " \
+    && map_check $nb_pages pmd:0x40000000=0 pmd:0x40000000=$pte \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PMD shared by a second PUD entry: every page mapped twice): " $((++test))
+pmd=$(test-rmap desc "$desc" | awk '$2 == "PMD" { print $1; exit }')
+map_check $((2 * nb_pages)) pud:0x80000000=$pmd \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PGD entry cleared: nothing mapped): " $((++test))
+map_check 0 pgd:0x0=0 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (entry out of the memory, error): " $((++test))
+! test-rmap desc "$desc" pte:0x40000000=0xFFFFF000 >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
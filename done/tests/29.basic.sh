@@ -0,0 +1,105 @@
+#!/bin/bash
+
+## Basic tests for the page-walk caches
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Test Page-Walk Caches" test-pwc
+checkX "Simulator" sim
+checkX "Test Reverse Map" test-rmap
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 65536 -w 0.3 -s 29 uniform 20000 "$outdir" >/dev/null
+desc="$outdir/memory-desc.txt"
+cmds="$outdir/commands.txt"
+geometry="1x4,4x4,16x4"
+
+# ======================================================================
+printf "Test %1d (same simulation with and without page-walk caches): " $((++test))
+diff <(sim desc "$desc" "$cmds") <(sim -p $geometry desc "$desc" "$cmds" | grep -v "^page walks: \|^  P.D cache ") >/dev/null \
+    && diff <(sim desc "$desc" "$cmds" 1000 100) \
+            <(sim -p $geometry desc "$desc" "$cmds" 1000 100 | grep -v "^page walks: \|^  P.D cache ") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (fewer entries read per walk with the caches): " $((++test))
+uncached=$(sim -p 0x0,0x0,0x0 desc "$desc" "$cmds" | awk '/^page walks:/ { print $4 }' | tr -d '(')
+cached=$(sim -p $geometry desc "$desc" "$cmds" | awk '/^page walks:/ { print $4 }' | tr -d '(')
+[ "$uncached" = "4.000" ] \
+    && awk -v c="$cached" 'BEGIN { exit !(c < 2) }' \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (same translations as page_walk(), every level cached): " $((++test))
+vaddrs=$(awk 'NR <= 200 { print $NF }' "$cmds" | tr -d '@')
+output="$(test-pwc desc "$desc" $geometry $vaddrs)" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && grep -q "^PMD: [1-9][0-9]* hits" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PMD entry rewritten: cached entry dropped, new translations seen): " $((++test))
+pte=$(test-rmap desc "$desc" | awk '$2 == "PTE" { print $1; exit }')
+output="$(test-pwc desc "$desc" 1x1,1x1,1x1 0x40000000 0x40001000 pmd:0x40000000=0x0 0x40000000 \
+          pmd:0x40000000=$pte 0x40001000 2>/dev/null)" \
+    && grep -q "invalidations: 1$" <<< "$output" \
+    && [ "$(sed -n 3p <<< "$output")" = "0x0000000040000000 -> unmapped" ] \
+    && [ "$(sed -n 4p <<< "$output")" = "$(sed -n 2p <<< "$output")" ] \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PUD, then PGD entry cleared: entries cached below them dropped too): " $((++test))
+output="$(test-pwc desc "$desc" 1x4,1x4,1x4 0x40000000 pud:0x40000000=0x0 0x40000000 \
+          pgd:0x0=0x0 0x40000000 2>/dev/null)" \
+    && [ $(grep -c "^0x0000000040000000 -> unmapped$" <<< "$output") -eq 2 ] \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+DATA_DIR="$(dirname ${BASH_SOURCE[0]})/files"
+
+printf "Test %1d (PUD entry rewritten, not cached itself: PMD entries read under it dropped): " $((++test))
+output="$(test-pwc desc "$DATA_DIR/memory-desc-01.txt" 0x0,0x0,1x1 0x40000000 pud:0x40000000=0x2000 0x40000000 2>/dev/null)" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && grep -q "invalidations: 1$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PUD entry rewritten after its eviction: PMD entries read under it dropped): " $((++test))
+output="$(test-pwc desc "$DATA_DIR/memory-desc-01.txt" 1x1,1x1,4x1 0x40000000 0x200000 pud:0x40000000=0x2000 \
+          0x40000000 2>/dev/null)" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (invalid geometries, errors): " $((++test))
+! test-pwc desc "$desc" 3x1,1x1,1x1 >/dev/null 2>&1 \
+    && ! test-pwc desc "$desc" 1x1,1x1 >/dev/null 2>&1 \
+    && ! sim -p 1x1 desc "$desc" "$cmds" >/dev/null 2>&1 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+## Basic tests for the batched page walk
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Test Batched Page Walk" test-page_walk
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 4194304 -w 0.3 -s 30 uniform 50000 "$outdir" >/dev/null
+desc="$outdir/memory-desc.txt"
+
+# ======================================================================
+printf "Test %1d (same translations as page_walk() on a whole program): " $((++test))
+output="$(test-page_walk desc "$desc" "$outdir/commands.txt")" \
+    && grep -q "^addresses: 50000$" <<< "$output" \
+    && grep -q "^unmapped: 0$" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (same translations from a dump, with timings): " $((++test))
+output="$(test-page_walk -t dump "$outdir/memory.mem" "$outdir/commands.txt")" \
+    && grep -q "^consistent$" <<< "$output" \
+    && grep -q "^page_walk_batch: .* ns per address$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+# addresses missing at the PGD, PUD and PMD levels, between mapped ones (the footprint is 2 PMD entries)
+cat > "$outdir/holes.txt" <<HOLES
+R DW @0x0000000040000000
+R DW @0x0000008000000000
+R DW @0x0000000040001004
+R DW @0x00000000C0000000
+R DW @0x0000000040200000
+R DW @0x0000000040000008
+R DW @0x0000000040400000
+R DW @0x00000000403FF000
+R DW @0x0000000040002FFC
+HOLES
+printf "Test %1d (addresses not mapped at the PGD, PUD and PMD levels, between mapped ones): " $((++test))
+output="$(test-page_walk desc "$desc" "$outdir/holes.txt" 2>/dev/null)" \
+    && grep -q "^addresses: 9$" <<< "$output" \
+    && grep -q "^unmapped: 3$" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (empty program): " $((++test))
+: > "$outdir/empty.txt"
+output="$(test-page_walk desc "$desc" "$outdir/empty.txt")" \
+    && grep -q "^addresses: 0$" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
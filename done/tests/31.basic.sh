@@ -0,0 +1,97 @@
+#!/bin/bash
+
+## Basic tests for the flat translation map
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Test Translation Map" test-vpn_map
+checkX "Test Batched Page Walk" test-page_walk
+checkX "Simulator" sim
+checkX "Workload Generator" gen-workload
+
+outdir="$(mktemp -d)"
+gen-workload -f 4194304 -w 0.3 -s 31 uniform 20000 "$outdir" >/dev/null
+desc="$outdir/memory-desc.txt"
+
+# ======================================================================
+# map_check expected_entries [arguments]: every translation as page_walk(), and the map as a new one
+map_check() {
+    expected=$1
+    shift
+    output="$(test-vpn_map desc "$desc" "$@" 2>/dev/null)" \
+        && grep -q "^entries: $expected$" <<< "$output" \
+        && grep -q "^usable$" <<< "$output" \
+        && ! grep -q "MISMATCH" <<< "$output" \
+        && grep -q "^consistent$" <<< "$output"
+}
+
+printf "Test %1d (every page of the program mapped, same translations as page_walk()): " $((++test))
+map_check 1024 0x40000000 0x403FFFFC 0x40400000 \
+    && output="$(test-page_walk dump "$outdir/memory.mem" "$outdir/commands.txt")" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PTE entries changed and cleared): " $((++test))
+map_check 1023 pte:0x40000000=0x5000 pte:0x40001000=0 0x40000000 0x40001000 0x40002000 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PTE entry written again with the same value: updated once): " $((++test))
+output="$(test-vpn_map desc "$desc" pte:0x40000000=0x5000 pte:0x40000000=0x5000 0x40000000 2>/dev/null)" \
+    && grep -q "^updates: 1$" <<< "$output" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PMD entry cleared: its 512 pages forgotten): " $((++test))
+map_check 512 pmd:0x40200000=0 0x40200000 0x40000000 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PMD shared by a second PUD entry, then one of its entries cleared): " $((++test))
+map_check 1024 pud:0x80000000=0x2000 0x80000000 0x80201000 pmd:0x40200000=0 0x80200000 0x40200000 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (PGD entry cleared: nothing mapped): " $((++test))
+map_check 0 pgd:0x0=0 0x40000000 \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (entry out of the memory: page_walk() used instead): " $((++test))
+output="$(test-vpn_map desc "$desc" pte:0x40000000=0xFFFFF000 0x40001000 2>/dev/null)" \
+    && grep -q "^unusable" <<< "$output" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (sampled simulation of the same memory): " $((++test))
+output="$(sim desc "$desc" "$outdir/commands.txt" 1000 100)" \
+    && grep -q "^commands: 20000 (detailed: 2000, fast-forwarded: 18000)$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
@@ -0,0 +1,102 @@
+#!/bin/bash
+
+## Basic tests for the large pages (2 MiB PMD and 1 GiB PUD entries)
+
+source $(dirname ${BASH_SOURCE[0]})/test_env.sh
+
+test=0
+
+checkX "Workload Generator" gen-workload
+checkX "Simulator" sim
+checkX "Test TLB Simple" test-tlb_simple
+checkX "Test TLB Hierarchy" test-tlb_hrchy
+checkX "Test Batched Page Walk" test-page_walk
+checkX "Test Translation Map" test-vpn_map
+checkX "Test Reverse Map" test-rmap
+checkX "Test Page-Walk Caches" test-pwc
+checkX "Memory Diff" diff-memory
+
+outdir="$(mktemp -d)"
+mkdir "$outdir/small" "$outdir/large"
+gen-workload -f 4194304 -s 32 uniform 20000 "$outdir/small" >/dev/null
+gen-workload -f 4194304 -s 32 -P 2m uniform 20000 "$outdir/large" >/dev/null
+desc="$outdir/large/memory-desc.txt"
+dump="$outdir/large/memory.mem"
+
+# ======================================================================
+# walks_of dir: the number of page walks (L2 TLB misses) simulating a generated program
+walks_of() {
+    sim desc "$1/memory-desc.txt" "$1/commands.txt" | awk '/^L2 TLB \(walks\)/ { print $NF }'
+}
+
+printf "Test %1d (data mapped by 2 MiB pages, translated as page_walk() does): " $((++test))
+output="$(test-page_walk dump "$dump" "$outdir/large/commands.txt")" \
+    && grep -q "^unmapped: 0$" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && diff-memory -q dump "$dump" desc "$desc" >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (one TLB entry per 2 MiB page: one walk per page only): " $((++test))
+small_walks="$(walks_of "$outdir/small")" \
+    && large_walks="$(walks_of "$outdir/large")" \
+    && [ "$large_walks" -eq 2 ] \
+    && [ "$small_walks" -gt 1000 ] \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (fully-associative TLB and TLB hierarchy agree on large pages): " $((++test))
+awk 'NR <= 500' "$outdir/large/commands.txt" > "$outdir/commands500.txt"
+test-tlb_simple "$outdir/commands500.txt" "$dump" "$outdir/simple.out" \
+    && test-tlb_hrchy "$outdir/commands500.txt" "$dump" "$outdir/hrchy.out" \
+    && [ "$(grep -c "^MISS" "$outdir/simple.out")" -eq 2 ] \
+    && ! grep -q "error with" "$outdir/simple.out" "$outdir/hrchy.out" \
+    && diff <(grep -o "PA .*" "$outdir/simple.out") <(grep -o "PA .*" "$outdir/hrchy.out") >/dev/null \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (large PMD entries moved and cleared: maps followed): " $((++test))
+output="$(test-vpn_map desc "$desc" pmd:0x40000000=0x00400080 0x40000010 pmd:0x40200000=0 0x40200000 2>/dev/null)" \
+    && grep -q "^0x0000000040000010 -> 0x00400010$" <<< "$output" \
+    && grep -q "^entries: 512$" <<< "$output" \
+    && grep -q "^usable$" <<< "$output" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && output="$(test-rmap desc "$desc" pmd:0x40000000=0x00400080 pmd:0x40200000=0 2>/dev/null)" \
+    && grep -q "^mappings: 512$" <<< "$output" \
+    && grep -q "^consistent$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (cached large-page entries invalidated, 1 GiB page at the PUD): " $((++test))
+output="$(test-pwc desc "$desc" 1x4,4x4,16x4 0x40000010 0x40000010 pmd:0x40000000=0x00400080 0x40000010 \
+          pud:0x40000000=0x40000080 0x40234567 2>/dev/null)" \
+    && grep -q "^0x0000000040000010 -> 0x00200010$" <<< "$output" \
+    && grep -q "^0x0000000040000010 -> 0x00400010$" <<< "$output" \
+    && grep -q "^0x0000000040234567 -> 0x40234567$" <<< "$output" \
+    && ! grep -q "MISMATCH" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+printf "Test %1d (large page not aligned on its size: not translated): " $((++test))
+output="$(test-pwc desc "$desc" 1x4,4x4,16x4 pmd:0x40000000=0x00201080 0x40000010 2>/dev/null)" \
+    && grep -q "^0x0000000040000010 -> unmapped$" <<< "$output" \
+    && echo "PASS" \
+    || (echo "FAIL"; \
+        rm -rf "$outdir"; \
+        exit 1)
+
+rm -rf "$outdir"
+
+# ======================================================================
+echo "SUCCESS"
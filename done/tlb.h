@@ -14,8 +14,13 @@
 
 #define TLB_LINES 128 // the number of entries
 
+/*
+ * An entry maps a page of any size (see page_size_t): its tag is the virtual page
+ * number of that size, and phy_page_num the first frame of the page.
+ */
 typedef struct __tlb_entry__ {
   uint64_t tag          : VIRT_PAGE_NUM;
   uint32_t phy_page_num : PHY_PAGE_NUM;
   uint8_t v             : 1;
+  uint8_t size          : 2; // page_size_t
 } tlb_entry_t;
@@ -28,10 +28,16 @@
 #define L2_TLB_LINES    64  // 64, Do not modify this!
 #define L2_TLB_LINES_BITS 6  // log_2(L2_TLB_LINES)
 
+/*
+ * An entry maps a page of any size (see page_size_t): its tag and line index are
+ * taken from the virtual page number of that size, and phy_page_num is the first
+ * frame of the page.
+ */
 typedef struct {
     uint32_t tag            : VIRT_PAGE_NUM - L1_ITLB_LINES_BITS;
     uint32_t phy_page_num   : PHY_PAGE_NUM;
     uint8_t v               : 1;
+    uint8_t size            : 2; // page_size_t
 } l1_itlb_entry_t;
 
 typedef l1_itlb_entry_t l1_dtlb_entry_t;
@@ -40,6 +46,7 @@ typedef struct {
     uint32_t tag            : VIRT_PAGE_NUM - L2_TLB_LINES_BITS;
     uint32_t phy_page_num   : PHY_PAGE_NUM;
     uint8_t v               : 1;
+    uint8_t size            : 2; // page_size_t
 } l2_tlb_entry_t;
 
 typedef enum {
@@ -9,12 +9,13 @@
 #include "tlb_hrchy_mng.h"
 #include "tlb_hrchy.h"
 #include "page_walk.h"
+#include "pwc.h"
 #include "addr_mng.h"
 #include "error.h"
 #include "addr.h"
 
-static inline uint64_t tag_and_index_from_vaddr(const virt_addr_t* vaddr){
-    return virt_addr_t_to_uint64_t(vaddr)>>PAGE_OFFSET;
+static inline uint64_t tag_and_index_from_vaddr(virt_addr64_t vaddr){
+    return virt_addr64_virtual_page_number(vaddr);
 }
 
 static inline uint32_t tag_from_tag_and_index(uint64_t tag_and_index, const size_t tlb_lines){
@@ -25,6 +26,16 @@ static inline uint8_t index_from_tag_and_index(uint64_t tag_and_index, const siz
     return tag_and_index % tlb_lines;
 }
 
+// tag and index of the pages of a size: the virtual page number without its lower bits
+static inline uint64_t tag_and_index_sized(uint64_t tag_and_index, page_size_t size){
+    return tag_and_index >> (PAGE_SIZE_BITS(size) - PAGE_OFFSET);
+}
+
+// the bits of a (4 kiB) page number selecting a frame in a page of a size
+static inline uint32_t frames_mask(page_size_t size){
+    return (UINT32_C(1) << (PAGE_SIZE_BITS(size) - PAGE_OFFSET)) - 1;
+}
+
 #define FLUSH(tlb_entry_type, TLB_LINES) \
     (void)memset(tlb, 0, TLB_LINES * sizeof(tlb_entry_type))
 
@@ -55,28 +66,35 @@ int tlb_flush(void *tlb, tlb_t tlb_type){
 
 #define HIT_TLB(tlb_entry_type, TLB_LINES) \
     do { \
-        uint64_t tag_and_index = tag_and_index_from_vaddr(vaddr); \
-        uint32_t tag = tag_from_tag_and_index(tag_and_index, TLB_LINES); \
-        uint8_t index = index_from_tag_and_index(tag_and_index, TLB_LINES); \
-        \
-        tlb_entry_type tlb_entry = ((tlb_entry_type*)tlb)[index]; \
-        \
-        if (tlb_entry.v == VALID && tlb_entry.tag == tag){ \
-            /*Entry was found in TLB*/ \
-            paddr->phy_page_num = tlb_entry.phy_page_num; \
-            paddr->page_offset = vaddr->page_offset; \
-            return HIT; \
-        }else{ \
-            return MISS; \
+        uint64_t page_number = tag_and_index_from_vaddr(vaddr); \
+        for (page_size_t size = PAGE_4K; size <= PAGE_1G; ++size) { \
+            uint64_t tag_and_index = tag_and_index_sized(page_number, size); \
+            uint32_t tag = tag_from_tag_and_index(tag_and_index, TLB_LINES); \
+            uint8_t index = index_from_tag_and_index(tag_and_index, TLB_LINES); \
+            \
+            tlb_entry_type tlb_entry = ((tlb_entry_type*)tlb)[index]; \
+            \
+            if (tlb_entry.v == VALID && tlb_entry.size == size && tlb_entry.tag == tag){ \
+                /*Entry was found in TLB: the lower bits of the page number select the frame*/ \
+                paddr->phy_page_num = tlb_entry.phy_page_num | (page_number & frames_mask(size)); \
+                paddr->page_offset = virt_addr64_page_offset(vaddr); \
+                if (hit_size != NULL) *hit_size = size; \
+                return HIT; \
+            } \
         } \
+        return MISS; \
     } while(0)
 
-int tlb_hit( const virt_addr_t * vaddr,
-             phy_addr_t * paddr,
-             const void  * tlb,
-             tlb_t tlb_type){
+/**
+ * @brief tlb_hit64(), also telling the size of the page hit (hit_size may be NULL)
+ */
+static int tlb_hit64_sized( virt_addr64_t vaddr,
+                            phy_addr_t * paddr,
+                            const void  * tlb,
+                            tlb_t tlb_type,
+                            page_size_t * hit_size){
 
-    if(vaddr == NULL || paddr == NULL || tlb == NULL) {
+    if(paddr == NULL || tlb == NULL) {
         return MISS;
     }
 
@@ -99,6 +117,23 @@ int tlb_hit( const virt_addr_t * vaddr,
 
 #undef HIT_TLB
 
+int tlb_hit( const virt_addr_t * vaddr,
+             phy_addr_t * paddr,
+             const void  * tlb,
+             tlb_t tlb_type){
+    if(vaddr == NULL) {
+        return MISS;
+    }
+    return tlb_hit64_sized(virt_addr64_pack(vaddr), paddr, tlb, tlb_type, NULL);
+}
+
+int tlb_hit64( virt_addr64_t vaddr,
+               phy_addr_t * paddr,
+               const void  * tlb,
+               tlb_t tlb_type){
+    return tlb_hit64_sized(vaddr, paddr, tlb, tlb_type, NULL);
+}
+
 
 #define INSERT(tlb_entry_type, number_lines) \
   do { \
@@ -139,17 +174,35 @@ int tlb_insert( uint32_t line_index,
     do { \
         tlb_entry_type* entry = (tlb_entry_type*)tlb_entry; \
         entry->v = VALID; \
-        entry->tag = virt_addr_t_to_virtual_page_number(vaddr)>>TLB_LINES_BITS; \
-        entry->phy_page_num = paddr->phy_page_num; \
+        entry->size = size; \
+        entry->tag = tag_and_index_sized(tag_and_index_from_vaddr(vaddr), size)>>TLB_LINES_BITS; \
+        entry->phy_page_num = paddr->phy_page_num & ~frames_mask(size); \
     } while(0)
 
 int tlb_entry_init( const virt_addr_t * vaddr,
                     const phy_addr_t * paddr,
                     void * tlb_entry,
                     tlb_t tlb_type){
+    return tlb_entry_init_sized(vaddr, paddr, PAGE_4K, tlb_entry, tlb_type);
+}
+
+int tlb_entry_init_sized( const virt_addr_t * vaddr,
+                          const phy_addr_t * paddr,
+                          page_size_t size,
+                          void * tlb_entry,
+                          tlb_t tlb_type){
     M_REQUIRE_NON_NULL(vaddr);
+    return tlb_entry_init64(virt_addr64_pack(vaddr), paddr, size, tlb_entry, tlb_type);
+}
+
+int tlb_entry_init64( virt_addr64_t vaddr,
+                      const phy_addr_t * paddr,
+                      page_size_t size,
+                      void * tlb_entry,
+                      tlb_t tlb_type){
     M_REQUIRE_NON_NULL(paddr);
     M_REQUIRE_NON_NULL(tlb_entry);
+    M_REQUIRE(size <= PAGE_1G, ERR_BAD_PARAMETER, "%s", "Unrecognized page size");
 
     switch (tlb_type)
     {
@@ -177,9 +230,9 @@ int tlb_entry_init( const virt_addr_t * vaddr,
 #define INSERT(tlb_entry_type, TLB_TYPE, TLB_LINES, tlb) \
     do { \
         tlb_entry_type new_entry; \
-        tlb_entry_init(vaddr, paddr, &new_entry, TLB_TYPE); \
+        tlb_entry_init64(vaddr, paddr, size, &new_entry, TLB_TYPE); \
         \
-        uint64_t tag_and_index = tag_and_index_from_vaddr(vaddr); \
+        uint64_t tag_and_index = tag_and_index_sized(tag_and_index_from_vaddr(vaddr), size); \
         uint8_t index = index_from_tag_and_index(tag_and_index, TLB_LINES); \
         tlb_insert(index, &new_entry, tlb, TLB_TYPE); \
     } while(0)
@@ -188,8 +241,8 @@ int tlb_entry_init( const virt_addr_t * vaddr,
     do { \
         /*Create and init. a new L2 tlb entry*/ \
         l2_tlb_entry_t new_entry; \
-        tlb_entry_init(vaddr, paddr, &new_entry, L2_TLB); \
-        uint64_t tag_and_index = tag_and_index_from_vaddr(vaddr); \
+        tlb_entry_init64(vaddr, paddr, size, &new_entry, L2_TLB); \
+        uint64_t tag_and_index = tag_and_index_sized(tag_and_index_from_vaddr(vaddr), size); \
         uint8_t index = index_from_tag_and_index(tag_and_index, L2_TLB_LINES); \
         \
         /*If l2 entry was also in the other l1 tlb, invalidate it*/ \
@@ -206,40 +259,48 @@ int tlb_entry_init( const virt_addr_t * vaddr,
         /*Get the previous entry in L2 TLB*/\
         l2_tlb_entry_t old_entry = l2_tlb[index];\
         if(old_entry.v == VALID){ \
-            /*Convert l2 entry tag and index into l1 entry tag and index*/\
+            /*Convert l2 entry tag and index into l1 entry tag and index (for pages of its size)*/\
             uint8_t old_l1_index = index & MASK4 ;\
             uint32_t old_l1_tag = (old_entry.tag << (L2_TLB_LINES_BITS - L1_TLB_LINES_BITS));\
             old_l1_tag |= (index >> L1_TLB_LINES_BITS) & MASK2;\
-            /*Search the l1 tlb and invalidate if tag matches*/\
-            if(l1_tlb[old_l1_index].tag == old_l1_tag){ l1_tlb[old_l1_index].v = INVALID; }\
+            /*Search the l1 tlb and invalidate if tag and size match*/\
+            if(l1_tlb[old_l1_index].tag == old_l1_tag && l1_tlb[old_l1_index].size == old_entry.size){ \
+                l1_tlb[old_l1_index].v = INVALID; \
+            }\
         } \
     } while(0)
 
-int tlb_search( const void * mem_space,
-                const virt_addr_t * vaddr,
-                phy_addr_t * paddr,
-                mem_access_t access,
-                l1_itlb_entry_t * l1_itlb,
-                l1_dtlb_entry_t * l1_dtlb,
-                l2_tlb_entry_t * l2_tlb,
-                int* hit_or_miss){
+/**
+ * @brief tlb_search64(), translating L2 TLB misses through the page-walk caches pwc if not NULL
+ */
+static int tlb_search_walk( const void * mem_space,
+                            pwc_t * pwc,
+                            virt_addr64_t vaddr,
+                            phy_addr_t * paddr,
+                            mem_access_t access,
+                            l1_itlb_entry_t * l1_itlb,
+                            l1_dtlb_entry_t * l1_dtlb,
+                            l2_tlb_entry_t * l2_tlb,
+                            int* hit_or_miss){
 
     M_REQUIRE_NON_NULL(mem_space);
-    M_REQUIRE_NON_NULL(vaddr);
     M_REQUIRE_NON_NULL(paddr);
     M_REQUIRE_NON_NULL(l1_itlb);
     M_REQUIRE_NON_NULL(l1_dtlb);
     M_REQUIRE_NON_NULL(l2_tlb);
     M_REQUIRE_NON_NULL(hit_or_miss);
 
+    //Size of the page translating vaddr, once known
+    page_size_t size = PAGE_4K;
+
     //Search in appropriate L1 TLB
     switch (access)
     {
     case INSTRUCTION:
-        *hit_or_miss = tlb_hit(vaddr, paddr, l1_itlb, L1_ITLB);
+        *hit_or_miss = tlb_hit64_sized(vaddr, paddr, l1_itlb, L1_ITLB, &size);
         break;
     case DATA:
-        *hit_or_miss = tlb_hit(vaddr, paddr, l1_dtlb, L1_DTLB);
+        *hit_or_miss = tlb_hit64_sized(vaddr, paddr, l1_dtlb, L1_DTLB, &size);
         break;
     default:
         M_EXIT(ERR_BAD_PARAMETER, "%s", "Unrecognized memory access type");
@@ -248,7 +309,7 @@ int tlb_search( const void * mem_space,
 
     if(*hit_or_miss == MISS){
         //Search in L2 TLB
-        *hit_or_miss = tlb_hit(vaddr, paddr, l2_tlb, L2_TLB);
+        *hit_or_miss = tlb_hit64_sized(vaddr, paddr, l2_tlb, L2_TLB, &size);
         if(*hit_or_miss == HIT){
 
             //Update appropriate L1 TLB with data found in L2 TLB
@@ -266,7 +327,11 @@ int tlb_search( const void * mem_space,
             }
         }else{ //L2 MISS
             //Translate the virtual address
-            M_EXIT_IF_ERR(page_walk(mem_space, vaddr, paddr), "Problem translating virtual address");
+            if(pwc == NULL){
+                M_EXIT_IF_ERR(page_walk64_sized(mem_space, vaddr, paddr, &size), "Problem translating virtual address");
+            }else{
+                M_EXIT_IF_ERR(page_walk_cached64(pwc, vaddr, paddr, &size), "Problem translating virtual address");
+            }
 
             //Insert a new entry in the L2 tlb and appropriate L1 TLB for this translation
             //Invalidate corresp. entry in the other L1 TLB (if it was previously valid)
@@ -289,6 +354,53 @@ int tlb_search( const void * mem_space,
     return ERR_NONE;
 }
 
+int tlb_search( const void * mem_space,
+                const virt_addr_t * vaddr,
+                phy_addr_t * paddr,
+                mem_access_t access,
+                l1_itlb_entry_t * l1_itlb,
+                l1_dtlb_entry_t * l1_dtlb,
+                l2_tlb_entry_t * l2_tlb,
+                int* hit_or_miss){
+    M_REQUIRE_NON_NULL(vaddr);
+    return tlb_search_walk(mem_space, NULL, virt_addr64_pack(vaddr), paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss);
+}
+
+int tlb_search64( const void * mem_space,
+                  virt_addr64_t vaddr,
+                  phy_addr_t * paddr,
+                  mem_access_t access,
+                  l1_itlb_entry_t * l1_itlb,
+                  l1_dtlb_entry_t * l1_dtlb,
+                  l2_tlb_entry_t * l2_tlb,
+                  int* hit_or_miss){
+    return tlb_search_walk(mem_space, NULL, vaddr, paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss);
+}
+
+int tlb_search_cached( pwc_t * pwc,
+                       const virt_addr_t * vaddr,
+                       phy_addr_t * paddr,
+                       mem_access_t access,
+                       l1_itlb_entry_t * l1_itlb,
+                       l1_dtlb_entry_t * l1_dtlb,
+                       l2_tlb_entry_t * l2_tlb,
+                       int* hit_or_miss){
+    M_REQUIRE_NON_NULL(vaddr);
+    return tlb_search_cached64(pwc, virt_addr64_pack(vaddr), paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss);
+}
+
+int tlb_search_cached64( pwc_t * pwc,
+                         virt_addr64_t vaddr,
+                         phy_addr_t * paddr,
+                         mem_access_t access,
+                         l1_itlb_entry_t * l1_itlb,
+                         l1_dtlb_entry_t * l1_dtlb,
+                         l2_tlb_entry_t * l2_tlb,
+                         int* hit_or_miss){
+    M_REQUIRE_NON_NULL(pwc);
+    return tlb_search_walk(pwc->mem_space, pwc, vaddr, paddr, access, l1_itlb, l1_dtlb, l2_tlb, hit_or_miss);
+}
+
  #undef INSERT
  #undef INSERT_L2_AND_INVALIDATE_L1
  #undef INVALIDATE_IF_NECESSARY
@@ -11,6 +11,7 @@
 #include "tlb_hrchy.h"
 #include "mem_access.h"
 #include "addr.h"
+#include "pwc.h"
 
 #define HIT 1
 #define MISS 0
@@ -36,6 +37,7 @@ int tlb_flush(void *tlb, tlb_t tlb_type);
  *
  * On hit, return success (1) and update the physical page number passed as the pointer to the function.
  * On miss, return miss (0).
+ * The line of vaddr is looked at for each page size, 4 kiB first.
  *
  * @param vaddr pointer to virtual address
  * @param paddr (modified) pointer to physical address
@@ -49,6 +51,16 @@ int tlb_hit( const virt_addr_t * vaddr,
              const void  * tlb,
              tlb_t tlb_type);
 
+//=========================================================================
+/**
+ * @brief tlb_hit() of a packed virtual address (no reassembling of the address).
+ */
+
+int tlb_hit64( virt_addr64_t vaddr,
+               phy_addr_t * paddr,
+               const void  * tlb,
+               tlb_t tlb_type);
+
 //=========================================================================
 /**
  * @brief Insert an entry to a tlb. Eviction policy is simple since
@@ -80,6 +92,34 @@ int tlb_entry_init( const virt_addr_t * vaddr,
                     void * tlb_entry,
                     tlb_t tlb_type);
 
+//=========================================================================
+/**
+ * @brief Initialize a TLB entry for a page of a given size (tlb_entry_init() is for 4 kiB pages)
+ * @param vaddr pointer to virtual address, to extract tlb tag
+ * @param paddr pointer to physical address, to extract the first frame of the page
+ * @param size the size of the page
+ * @param tlb_entry pointer to the entry to be initialized
+ * @param tlb_type to distinguish between different TLBs
+ * @return  error code
+ */
+
+int tlb_entry_init_sized( const virt_addr_t * vaddr,
+                          const phy_addr_t * paddr,
+                          page_size_t size,
+                          void * tlb_entry,
+                          tlb_t tlb_type);
+
+//=========================================================================
+/**
+ * @brief tlb_entry_init_sized() of a packed virtual address.
+ */
+
+int tlb_entry_init64( virt_addr64_t vaddr,
+                      const phy_addr_t * paddr,
+                      page_size_t size,
+                      void * tlb_entry,
+                      tlb_t tlb_type);
+
 //=========================================================================
 /**
  * @brief Ask TLB for the translation.
@@ -103,3 +143,56 @@ int tlb_search( const void * mem_space,
                 l1_dtlb_entry_t * l1_dtlb,
                 l2_tlb_entry_t * l2_tlb,
                 int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief tlb_search() of a packed virtual address: the address is never reassembled,
+ * from the TLB lookups to the page walk.
+ */
+
+int tlb_search64( const void * mem_space,
+                  virt_addr64_t vaddr,
+                  phy_addr_t * paddr,
+                  mem_access_t access,
+                  l1_itlb_entry_t * l1_itlb,
+                  l1_dtlb_entry_t * l1_dtlb,
+                  l2_tlb_entry_t * l2_tlb,
+                  int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief Ask TLB for the translation, L2 TLB misses being translated through page-walk caches.
+ *
+ * @param pwc the page-walk caches of the memory space (see pwc_init())
+ * @param vaddr pointer to virtual address
+ * @param paddr (modified) pointer to physical address (returned from TLB)
+ * @param access to distinguish between fetching instructions and reading/writing data
+ * @param l1_itlb pointer to the beginning of L1 ITLB
+ * @param l1_dtlb pointer to the beginning of L1 DTLB
+ * @param l2_tlb pointer to the beginning of L2 TLB
+ * @param hit_or_miss (modified) hit (1) or miss (0)
+ * @return error code
+ */
+
+int tlb_search_cached( pwc_t * pwc,
+                       const virt_addr_t * vaddr,
+                       phy_addr_t * paddr,
+                       mem_access_t access,
+                       l1_itlb_entry_t * l1_itlb,
+                       l1_dtlb_entry_t * l1_dtlb,
+                       l2_tlb_entry_t * l2_tlb,
+                       int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief tlb_search_cached() of a packed virtual address.
+ */
+
+int tlb_search_cached64( pwc_t * pwc,
+                         virt_addr64_t vaddr,
+                         phy_addr_t * paddr,
+                         mem_access_t access,
+                         l1_itlb_entry_t * l1_itlb,
+                         l1_dtlb_entry_t * l1_dtlb,
+                         l2_tlb_entry_t * l2_tlb,
+                         int* hit_or_miss);
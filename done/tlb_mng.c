@@ -15,6 +15,11 @@
 #include "error.h"
 
 
+// the bits of a (4 kiB) page number selecting a frame in a page of a size
+static inline uint64_t frames_mask(page_size_t size){
+  return (UINT64_C(1) << (PAGE_SIZE_BITS(size) - PAGE_OFFSET)) - 1;
+}
+
 int tlb_flush(tlb_entry_t * tlb) {
   M_REQUIRE_NON_NULL(tlb);
   (void)memset(tlb, 0, TLB_LINES * sizeof(tlb_entry_t));
@@ -25,16 +30,28 @@ int tlb_hit(const virt_addr_t * vaddr,
             phy_addr_t * paddr,
             const tlb_entry_t * tlb,
             replacement_policy_t * replacement_policy){
+  if(vaddr == NULL) {
+    return MISS;
+  }
+  return tlb_hit64(virt_addr64_pack(vaddr), paddr, tlb, replacement_policy);
+}
+
+int tlb_hit64(virt_addr64_t vaddr,
+              phy_addr_t * paddr,
+              const tlb_entry_t * tlb,
+              replacement_policy_t * replacement_policy){
 
-  if(vaddr == NULL || paddr == NULL || tlb == NULL || replacement_policy == NULL) {
+  if(paddr == NULL || tlb == NULL || replacement_policy == NULL) {
     return MISS;
   }
 
-  uint64_t tag = virt_addr_t_to_virtual_page_number(vaddr);
+  uint64_t page_number = virt_addr64_virtual_page_number(vaddr);
   node_t* m = NULL;
 
+  //the tag of an entry is the page number without the bits selecting a frame in its page
   for_all_nodes_reverse(n, replacement_policy->ll) {
-      if(tlb[n->value].tag == tag && tlb[n->value].v == VALID) {
+      const tlb_entry_t* entry = &tlb[n->value];
+      if(entry->v == VALID && entry->tag == page_number >> (PAGE_SIZE_BITS(entry->size) - PAGE_OFFSET)) {
         m = n;
         break;
       }
@@ -44,8 +61,8 @@ int tlb_hit(const virt_addr_t * vaddr,
   if(m != NULL) {
     hit_or_miss = HIT;
     //set paddr
-    paddr->phy_page_num = tlb[m->value].phy_page_num;
-    paddr->page_offset = vaddr->page_offset;
+    paddr->phy_page_num = tlb[m->value].phy_page_num | (page_number & frames_mask(tlb[m->value].size));
+    paddr->page_offset = virt_addr64_page_offset(vaddr);
     //update replacement policy
     replacement_policy->move_back(replacement_policy->ll, m);
   }else{
@@ -69,13 +86,29 @@ int tlb_insert( uint32_t line_index,
 int tlb_entry_init( const virt_addr_t * vaddr,
                     const phy_addr_t * paddr,
                     tlb_entry_t * tlb_entry) {
+  return tlb_entry_init_sized(vaddr, paddr, PAGE_4K, tlb_entry);
+}
+
+int tlb_entry_init_sized( const virt_addr_t * vaddr,
+                          const phy_addr_t * paddr,
+                          page_size_t size,
+                          tlb_entry_t * tlb_entry) {
   M_REQUIRE_NON_NULL(vaddr);
+  return tlb_entry_init64(virt_addr64_pack(vaddr), paddr, size, tlb_entry);
+}
+
+int tlb_entry_init64( virt_addr64_t vaddr,
+                      const phy_addr_t * paddr,
+                      page_size_t size,
+                      tlb_entry_t * tlb_entry) {
   M_REQUIRE_NON_NULL(paddr);
   M_REQUIRE_NON_NULL(tlb_entry);
+  M_REQUIRE(size <= PAGE_1G, ERR_BAD_PARAMETER, "%s", "Unrecognized page size");
 
   tlb_entry->v = VALID;
-  tlb_entry->tag = virt_addr_t_to_virtual_page_number(vaddr);
-  tlb_entry->phy_page_num = paddr->phy_page_num;
+  tlb_entry->size = size;
+  tlb_entry->tag = virt_addr64_virtual_page_number(vaddr) >> (PAGE_SIZE_BITS(size) - PAGE_OFFSET);
+  tlb_entry->phy_page_num = paddr->phy_page_num & ~frames_mask(size);
 
   return ERR_NONE;
 }
@@ -87,23 +120,33 @@ int tlb_search( const void * mem_space,
                 tlb_entry_t * tlb,
                 replacement_policy_t * replacement_policy,
                 int* hit_or_miss) {
-  M_REQUIRE_NON_NULL(mem_space);
   M_REQUIRE_NON_NULL(vaddr);
+  return tlb_search64(mem_space, virt_addr64_pack(vaddr), paddr, tlb, replacement_policy, hit_or_miss);
+}
+
+int tlb_search64( const void * mem_space,
+                  virt_addr64_t vaddr,
+                  phy_addr_t * paddr,
+                  tlb_entry_t * tlb,
+                  replacement_policy_t * replacement_policy,
+                  int* hit_or_miss) {
+  M_REQUIRE_NON_NULL(mem_space);
   M_REQUIRE_NON_NULL(paddr);
   M_REQUIRE_NON_NULL(tlb);
   M_REQUIRE_NON_NULL(replacement_policy);
   M_REQUIRE_NON_NULL(hit_or_miss);
 
-  *hit_or_miss = tlb_hit(vaddr, paddr, tlb, replacement_policy);
+  *hit_or_miss = tlb_hit64(vaddr, paddr, tlb, replacement_policy);
 
   if(*hit_or_miss == MISS) {
 
       //translate vaddr
-      M_EXIT_IF_ERR(page_walk(mem_space, vaddr, paddr), "page fault!");
+      page_size_t size;
+      M_EXIT_IF_ERR(page_walk64_sized(mem_space, vaddr, paddr, &size), "page fault!");
 
       //init tlb_entry
       tlb_entry_t new_entry;
-      M_EXIT_IF_ERR(tlb_entry_init(vaddr, paddr, &new_entry), "Error calling tlb_entry_init");
+      M_EXIT_IF_ERR(tlb_entry_init64(vaddr, paddr, size, &new_entry), "Error calling tlb_entry_init");
 
       //insert in tlb at the front's line index
       node_t* lru = replacement_policy->ll->front;
@@ -54,6 +54,15 @@ int tlb_hit(const virt_addr_t * vaddr,
             const tlb_entry_t * tlb,
             replacement_policy_t * replacement_policy);
 
+//=========================================================================
+/**
+ * @brief tlb_hit() of a packed virtual address (no reassembling of the address).
+ */
+int tlb_hit64(virt_addr64_t vaddr,
+              phy_addr_t * paddr,
+              const tlb_entry_t * tlb,
+              replacement_policy_t * replacement_policy);
+
 //=========================================================================
 /**
  * @brief Insert an entry to a tlb.
@@ -80,6 +89,29 @@ int tlb_entry_init( const virt_addr_t * vaddr,
                     const phy_addr_t * paddr,
                     tlb_entry_t * tlb_entry);
 
+//=========================================================================
+/**
+ * @brief Initialize a TLB entry for a page of a given size (tlb_entry_init() is for 4 kiB pages)
+ * @param vaddr pointer to virtual address, to extract tlb tag
+ * @param paddr pointer to physical address, to extract the first frame of the page
+ * @param size the size of the page
+ * @param tlb_entry pointer to the entry to be initialized
+ * @return  error code
+ */
+int tlb_entry_init_sized( const virt_addr_t * vaddr,
+                          const phy_addr_t * paddr,
+                          page_size_t size,
+                          tlb_entry_t * tlb_entry);
+
+//=========================================================================
+/**
+ * @brief tlb_entry_init_sized() of a packed virtual address.
+ */
+int tlb_entry_init64( virt_addr64_t vaddr,
+                      const phy_addr_t * paddr,
+                      page_size_t size,
+                      tlb_entry_t * tlb_entry);
+
 //=========================================================================
 /**
  * @brief Ask TLB for the translation.
@@ -97,3 +129,15 @@ int tlb_search( const void * mem_space,
                 tlb_entry_t * tlb,
                 replacement_policy_t * replacement_policy,
                 int* hit_or_miss);
+
+//=========================================================================
+/**
+ * @brief tlb_search() of a packed virtual address: the address is never reassembled,
+ * from the TLB lookup to the page walk.
+ */
+int tlb_search64( const void * mem_space,
+                  virt_addr64_t vaddr,
+                  phy_addr_t * paddr,
+                  tlb_entry_t * tlb,
+                  replacement_policy_t * replacement_policy,
+                  int* hit_or_miss);
@@ -0,0 +1,225 @@
+/**
+ * @file vpn_map.c
+ * @brief Flat translation map: from virtual page numbers to physical page numbers
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdlib.h> // calloc(), free()
+#include <string.h> // memset()
+
+#include "vpn_map.h"
+#include "page_walk.h"
+#include "error.h"
+
+#define MIN_CAPACITY 64
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ull
+#define PPN_MASK ((UINT64_C(1) << PHY_PAGE_NUM) - 1)
+
+// shift of the virtual address bits indexing a page directory, per level
+static const unsigned SHIFTS[] = {
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY + PUD_ENTRY, // PGD entry
+	PAGE_OFFSET + PTE_ENTRY + PMD_ENTRY, // PUD entry
+	PAGE_OFFSET + PTE_ENTRY, // PMD entry
+	PAGE_OFFSET // PTE entry
+};
+
+static inline size_t slot_home(const vpn_map_t* map, uint64_t vpn){
+	return (size_t) ((vpn * HASH_MULTIPLIER) >> map->shift);
+}
+
+static inline uint64_t slot_vpn(uint64_t slot){
+	return (slot >> PHY_PAGE_NUM) - 1;
+}
+
+/**
+ * @brief Index of the slot of a virtual page, or of the empty slot where it would go
+ */
+static size_t slot_find(const vpn_map_t* map, uint64_t vpn){
+	const size_t mask = map->capacity - 1;
+	size_t i = slot_home(map, vpn);
+	while(map->slots[i] != 0 && slot_vpn(map->slots[i]) != vpn) i = (i + 1) & mask;
+	return i;
+}
+
+/**
+ * @brief Allocates empty slots (at least twice as many as entries)
+ */
+static int slots_alloc(vpn_map_t* map, size_t nb_entries){
+	size_t capacity = MIN_CAPACITY;
+	unsigned bits = 6;
+	while(capacity < 2 * nb_entries){
+		capacity *= 2;
+		++bits;
+	}
+	uint64_t* slots = calloc(capacity, sizeof(uint64_t));
+	M_EXIT_IF_NULL(slots, capacity * sizeof(uint64_t));
+	free(map->slots);
+	map->slots = slots;
+	map->capacity = capacity;
+	map->shift = 64 - bits;
+	map->nb_entries = 0;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Puts a virtual page in the map, growing it if needed
+ */
+static int entry_insert(vpn_map_t* map, uint64_t vpn, uint32_t ppn){
+	if(2 * (map->nb_entries + 1) > map->capacity){
+		const uint64_t* old = map->slots;
+		const size_t old_capacity = map->capacity;
+		map->slots = NULL;
+		const int err = slots_alloc(map, 2 * map->nb_entries + 2);
+		if(err != ERR_NONE){
+			map->slots = (uint64_t*) old;
+			map->capacity = old_capacity;
+			return err;
+		}
+		for(size_t i = 0; i < old_capacity; ++i){
+			if(old[i] != 0){
+				map->slots[slot_find(map, slot_vpn(old[i]))] = old[i];
+				++map->nb_entries;
+			}
+		}
+		free((uint64_t*) old);
+	}
+
+	const size_t i = slot_find(map, vpn);
+	if(map->slots[i] == 0) ++map->nb_entries;
+	map->slots[i] = (vpn + 1) << PHY_PAGE_NUM | ppn;
+	return ERR_NONE;
+}
+
+/**
+ * @brief Takes a virtual page out of the map (the following slots are shifted back,
+ * so that no probe sequence is broken)
+ */
+static void entry_remove(vpn_map_t* map, uint64_t vpn){
+	const size_t mask = map->capacity - 1;
+	size_t hole = slot_find(map, vpn);
+	if(map->slots[hole] == 0) return;
+	--map->nb_entries;
+
+	for(size_t i = (hole + 1) & mask; map->slots[i] != 0; i = (i + 1) & mask){
+		// the entry in i may move to the hole if its home is not between them
+		const size_t home = slot_home(map, slot_vpn(map->slots[i]));
+		if(((i - home) & mask) >= ((i - hole) & mask)){
+			map->slots[hole] = map->slots[i];
+			hole = i;
+		}
+	}
+	map->slots[hole] = 0;
+}
+
+/**
+ * @brief Takes the virtual pages from vpn to vpn + nb_pages - 1 out of the map
+ */
+static void range_remove(vpn_map_t* map, uint64_t vpn, uint64_t nb_pages){
+	if(nb_pages <= map->capacity){
+		for(uint64_t page = 0; page < nb_pages; ++page) entry_remove(map, vpn + page);
+		return;
+	}
+	// a large range: faster to look at every slot (entries may move back, so loop until stable)
+	for(size_t i = 0; i < map->capacity; ){
+		const uint64_t slot = map->slots[i];
+		if(slot != 0 && slot_vpn(slot) - vpn < nb_pages){
+			entry_remove(map, slot_vpn(slot));
+		}else{
+			++i;
+		}
+	}
+}
+
+/**
+ * @brief page_visitor_t putting the data pages in the map
+ */
+static int vpn_map_visit(void* ctx, page_level_t level, uint64_t vaddr64, uint32_t paddr){
+	if(level == DATA_LEVEL) return entry_insert(ctx, vaddr64 >> PAGE_OFFSET, paddr >> PAGE_OFFSET);
+	return ERR_NONE;
+}
+
+/**
+ * @brief Builds the map from the page tables (unusable if they cannot be mapped)
+ */
+static int vpn_map_rebuild(vpn_map_t* map){
+	M_EXIT_IF_ERR(slots_alloc(map, map->rmap.nb_mappings), "Error allocating slots");
+	map->usable = map->rmap.error == ERR_NONE
+	              && page_tables_walk(map->memory, map->mem_capacity_in_bytes, vpn_map_visit, map) == ERR_NONE;
+	return ERR_NONE;
+}
+
+/**
+ * @brief rmap_listener_t keeping the map in line with the page tables: an entry of a
+ * page directory translating vaddr64 at a level changed, so the pages under it are
+ * forgotten, and those under its new value are put in the map
+ */
+static void vpn_map_entry_changed(void* context, page_level_t level, uint64_t vaddr64, pte_t entry){
+	vpn_map_t* map = context;
+	if(!map->usable) return;
+
+	range_remove(map, vaddr64 >> PAGE_OFFSET, UINT64_C(1) << (SHIFTS[level] - PAGE_OFFSET));
+	++map->nb_updates;
+	if(entry != 0 && page_subtree_walk(map->memory, map->mem_capacity_in_bytes, level + 1, entry, vaddr64,
+	                                   vpn_map_visit, map) != ERR_NONE){
+		map->usable = 0;
+	}
+}
+
+// ======================================================================
+int vpn_map_init(vpn_map_t* map, void* memory, size_t mem_capacity_in_bytes){
+	M_REQUIRE_NON_NULL(map);
+	M_REQUIRE_NON_NULL(memory);
+
+	memset(map, 0, sizeof(*map));
+	map->memory = memory;
+	map->mem_capacity_in_bytes = mem_capacity_in_bytes;
+
+	// page tables that cannot be mapped are not an error: page_walk() is used
+	if(rmap_init(&map->rmap, memory, mem_capacity_in_bytes) != ERR_NONE) return ERR_NONE;
+
+	int err = vpn_map_rebuild(map);
+	if(err == ERR_NONE) err = rmap_listen(&map->rmap, vpn_map_entry_changed, map);
+	if(err != ERR_NONE){
+		rmap_free(&map->rmap);
+		free(map->slots);
+		memset(map, 0, sizeof(*map));
+	}
+	return err;
+}
+
+// ======================================================================
+int vpn_map_free(vpn_map_t* map){
+	M_REQUIRE_NON_NULL(map);
+
+	int err = ERR_NONE;
+	if(map->slots != NULL){
+		err = rmap_free(&map->rmap);
+		free(map->slots);
+	}
+	memset(map, 0, sizeof(*map));
+	return err;
+}
+
+// ======================================================================
+int vpn_map_translate(const vpn_map_t* map, const virt_addr_t* vaddr, phy_addr_t* paddr){
+	M_REQUIRE_NON_NULL(map);
+	M_REQUIRE_NON_NULL(vaddr);
+	M_REQUIRE_NON_NULL(paddr);
+
+	// the reverse map may have failed to follow a change
+	if(!map->usable || map->rmap.error != ERR_NONE) return page_walk(map->memory, vaddr, paddr);
+
+	// as page_walk(), the reserved bits are ignored
+	const uint64_t vpn = (uint64_t) vaddr->pgd_entry << (PUD_ENTRY + PMD_ENTRY + PTE_ENTRY)
+	                     | (uint64_t) vaddr->pud_entry << (PMD_ENTRY + PTE_ENTRY)
+	                     | (uint64_t) vaddr->pmd_entry << PTE_ENTRY
+	                     | vaddr->pte_entry;
+	const uint64_t slot = map->slots[slot_find(map, vpn)];
+	M_REQUIRE(slot != 0, ERR_ADDR, "%s", "Virtual address not mapped");
+
+	paddr->phy_page_num = (uint32_t) (slot & PPN_MASK);
+	paddr->page_offset = vaddr->page_offset;
+	return ERR_NONE;
+}
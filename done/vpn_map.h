@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * @file vpn_map.h
+ * @brief Flat translation map: from virtual page numbers to physical page numbers
+ *
+ * The page tables are walked once (see page_tables_walk()), and every virtual page
+ * mapped is put in an open-addressing hash table (linear probing), so that a
+ * translation costs one probe instead of the four reads of page_walk().
+ *
+ * The map then follows the changes of the page tables through the reverse map (see
+ * rmap.h and rmap_listen()), which finds the entries of page directories that changed
+ * and the virtual addresses they translate: the virtual pages under each changed entry
+ * are forgotten, and the pages under its new value are walked and put back. Entries
+ * written with their old value, and writes to data frames, cost nothing more than
+ * they cost the reverse map.
+ *
+ * If the page tables cannot be mapped (an entry out of the memory or not aligned on
+ * a page), translations fall back to page_walk(), so that results are always the same.
+ *
+ * @author Juillard Paul, Tafti Leo
+ * @date 2019
+ */
+
+#include <stdio.h> // for size_t
+#include <stdint.h> // for uint*_t
+
+#include "addr.h" // for virt_addr_t, phy_addr_t
+#include "rmap.h" // for rmap_t
+
+typedef struct {
+	void* memory;
+	size_t mem_capacity_in_bytes;
+	rmap_t rmap; // the virtual addresses translated by each page directory
+	uint64_t* slots; // ((vpn + 1) << PHY_PAGE_NUM) | ppn, 0 if empty
+	size_t capacity; // number of slots, a power of 2
+	unsigned shift; // 64 - log2(capacity), for hashing
+	size_t nb_entries; // number of virtual pages mapped
+	uint64_t nb_updates; // number of entries of page directories changed since vpn_map_init()
+	int usable; // 0 if the page tables could not be mapped (page_walk() is used)
+} vpn_map_t;
+
+/**
+ * @brief "Constructor" for vpn_map_t: walk the page tables of a memory, and follow their changes.
+ * The map must not move while in use (its reverse map refers to it).
+ * @param map (modified) the map to build
+ * @param memory the memory (the PGD at physical address 0)
+ * @param mem_capacity_in_bytes its size
+ * @return ERR_NONE if ok (even if translations fall back to page_walk()), appropriate error code otherwise.
+ */
+int vpn_map_init(vpn_map_t* map, void* memory, size_t mem_capacity_in_bytes);
+
+/**
+ * @brief Stop following the writes to the memory, and release the map (not the memory).
+ * @param map (modified) the map to release
+ * @return ERR_NONE if ok, appropriate error code otherwise.
+ */
+int vpn_map_free(vpn_map_t* map);
+
+/**
+ * @brief Virtual address to physical address conversion (same result as page_walk()).
+ * @param map the map
+ * @param vaddr virtual address to be converted
+ * @param paddr (modified) physical address
+ * @return error code (ERR_ADDR if the address is not mapped)
+ */
+int vpn_map_translate(const vpn_map_t* map, const virt_addr_t* vaddr, phy_addr_t* paddr);